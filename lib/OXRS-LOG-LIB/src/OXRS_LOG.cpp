@@ -1,13 +1,54 @@
 #include "OXRS_LOG.h"
+#include <sys/time.h>
+#include <WiFi.h>
 
 static const char *_LOG_PREFIX = "[OXRS_LOG] ";
 
+// earlier times mean the clock has not been set
+static const time_t CLOCK_VALID_EPOCH = 1672531200;     // 2023-01-01
+
+#ifndef __uninitialized_ram
+#define __uninitialized_ram(group) group                // not retained off target
+#endif
+
+// not zeroed at boot, so the previous boot's lines survive a warm reboot
+static OXRS_LOG_RETAINED::Region_t __uninitialized_ram(_retainedRegions)[2];
+
 OXRS_LOG& oxrsLog = OXRS_LOG::getInstance();
 
 OXRS_LOG::OXRS_LOG() : 
-    _currentLevel(DEBUG)
+    _currentLevel(DEBUG),
+    _floorLevel(DEBUG),
+    _moduleCount(0),
+    _levelGeneration(1),
+    _configGeneration(1),
+    _retained(_retainedRegions),
+#if defined(OXRS_LOG_BINARY) || defined(OXRS_LOG_BINARY_ONLY)
+    _binary(true),
+#else
+    _binary(false),
+#endif
+    _serialText(true),
+    _async(false),
+    _overflowPolicy(DROP_OLDEST),
+    _lost(0),
+    _pumping(false),
+    _pumpCore(0),
+    _repeated(0),
+    _repeatHash(0),
+    _repeatLevel(OFF),
+    _repeatPrefix(nullptr),
+    _repeatCount(0),
+    _repeatSince_ms(0)
 {
-    _loggers.push_back(&_serial);
+    for (uint8_t core = 0; core < LOG_CORES; core++)
+    {
+        _dropped[core].store(0, std::memory_order_relaxed);
+        _rateLimited[core].store(0, std::memory_order_relaxed);
+    }
+
+    _loggers[0] = &_serial;
+    _loggerCount = 1;
 };
 
 OXRS_LOG& OXRS_LOG::getInstance() {
@@ -22,64 +63,520 @@ OXRS_LOG::LogLevel_t OXRS_LOG::getLevel() const
 
 void OXRS_LOG::addLogger(AbstractLogger* pLogger)
 {
-    _loggers.push_back(pLogger);
+    if (_loggerCount == LOG_MAX_LOGGERS)
+    {
+        logf(ERROR, _LOG_PREFIX, "Too many loggers, increase LOG_MAX_LOGGERS (%u)", (unsigned)LOG_MAX_LOGGERS);
+        return;
+    }
+    _loggers[_loggerCount++] = pLogger;
+    _configGeneration++;
 }
 
 void OXRS_LOG::setLevel(LogLevel_t level)
 {
     _currentLevel = level;
-    String logLine("Changed log level to ");
-    logLine.concat(levelStr[_currentLevel]);
-    log(INFO, "[OXRS_LOG] ", logLine);
+    levelsChanged();
+    logf(INFO, _LOG_PREFIX, "Changed log level to %s", levelStr[_currentLevel]);
+}
+
+// True if prefix is "[module]", optionally followed by spaces
+static bool isModulePrefix(const char* prefix, const char* module)
+{
+    if (*prefix++ != '[')
+        return false;
+    while (*module && *prefix == *module)
+    {
+        prefix++;
+        module++;
+    }
+    return *module == '\0' && *prefix == ']';
 }
 
-// log lines over MAX_BUF_LEN will be truncated
+OXRS_LOG::LogLevel_t OXRS_LOG::getLevel(const char* prefix) const
+{
+    for (uint8_t i = 0; i < _moduleCount; i++)
+    {
+        if (isModulePrefix(prefix, _modules[i].name))
+            return _modules[i].level;
+    }
+    return _currentLevel;
+}
+
+bool OXRS_LOG::setModuleLevel(const char* module, LogLevel_t level)
+{
+    uint8_t i = 0;
+    while (i < _moduleCount && strcmp(_modules[i].name, module) != 0)
+        i++;
+
+    if (i == LOG_MODULES)
+    {
+        logf(WARN, _LOG_PREFIX, "Too many module log levels, ignoring %s", module);
+        return false;
+    }
+
+    if (i == _moduleCount)
+    {
+        strncpy(_modules[i].name, module, LOG_MODULE_LEN - 1);
+        _modules[i].name[LOG_MODULE_LEN - 1] = '\0';
+        _moduleCount++;
+    }
+    _modules[i].level = level;
+    levelsChanged();
+    logf(INFO, _LOG_PREFIX, "Changed %s log level to %s", module, levelStr[level]);
+    return true;
+}
+
+void OXRS_LOG::clearModuleLevels()
+{
+    _moduleCount = 0;
+    levelsChanged();
+}
+
+// Recompute the floor and invalidate every module's cached level
+void OXRS_LOG::levelsChanged()
+{
+    LogLevel_t floor = _currentLevel;
+    for (uint8_t i = 0; i < _moduleCount; i++)
+    {
+        if (_modules[i].level < floor)
+            floor = _modules[i].level;
+    }
+    _floorLevel = floor;
+
+    // single writer (config), a plain load and store is enough
+    _levelGeneration.store(_levelGeneration.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    _configGeneration++;
+}
+
+// log lines over MAX_BUF_LEN (LOG_RECORD_LEN if async) will be truncated
 void OXRS_LOG::logf(LogLevel_t level, const char* prefix, const char* fmt, ...)
 {
-   if (level < _currentLevel)
+    // the macros have applied the module level, this only catches direct calls
+    if (level < _floorLevel)
         return;
 
     va_list args;
     va_start(args, fmt);
-    size_t len = vsnprintf(_buffer, MAX_BUF_LEN, fmt, args);
+    if (_async)
+    {
+        // format straight into the record, no shared buffer between cores
+        uint8_t core = getCore();
+        if (reserve(core))
+        {
+            LogRecord_t record;
+            initRecord(record, level, prefix);
+            record.frameLen = 0;
+            vsnprintf(record.message, LOG_RECORD_LEN, fmt, args);
+            _rings[core].push(record);
+        }
+    }
+    else
+    {
+        // format straight after the header, no intermediate copy
+        size_t header = formatHeader(level, prefix);
+        size_t len = header;
+        int n = vsnprintf(_line + len, MAX_BUF_LEN - len, fmt, args);
+        if (n > 0)
+            len = min(len + n, (size_t)MAX_BUF_LEN - 1);
+        writeText(level, prefix, header, len, millis());
+    }
     va_end(args);
-    log(level, prefix, _buffer);
 }
 
 void OXRS_LOG::log(LogLevel_t level, const char* prefix, const __FlashStringHelper *logEvent)
 {
-    if (level >= _currentLevel) {
-        String logLine(prefix);
-        logLine.concat(levelStr[level]);
-        logLine.concat(logEvent);
-        for (std::list<AbstractLogger*>::iterator iter=_loggers.begin(); iter != _loggers.end(); ++iter) {
-            (*iter)->log(level, logLine);
+    log(level, prefix, reinterpret_cast<const char*>(logEvent));
+}
+
+void OXRS_LOG::log(LogLevel_t level, const char* prefix, String& logEvent)
+{
+    log(level, prefix, logEvent.c_str());
+}
+
+void OXRS_LOG::log(LogLevel_t level, const char* prefix, const char* logEvent)
+{
+    // the macros have applied the module level, this only catches direct calls
+    if (level < _floorLevel)
+        return;
+
+    if (_async)
+    {
+        uint8_t core = getCore();
+        if (reserve(core))
+        {
+            LogRecord_t record;
+            initRecord(record, level, prefix);
+            record.frameLen = 0;
+            strncpy(record.message, logEvent, LOG_RECORD_LEN - 1);
+            record.message[LOG_RECORD_LEN - 1] = '\0';
+            _rings[core].push(record);
         }
+        return;
     }
+
+    write(level, prefix, logEvent, millis());
 }
 
-void OXRS_LOG::log(LogLevel_t level, const char* prefix, char* logEvent)
+// Copy s into the line buffer at len, truncating, returns the new length
+static size_t appendLine(char* line, size_t len, const char* s)
 {
-    if (level >= _currentLevel) {
-        String logLine(prefix);
-        logLine.concat(levelStr[level]);
-        logLine.concat(logEvent);
-        for (std::list<AbstractLogger*>::iterator iter=_loggers.begin(); iter != _loggers.end(); ++iter) {
-            (*iter)->log(level, logLine);
-        }
+    while (*s && len < MAX_BUF_LEN - 1)
+        line[len++] = *s++;
+    line[len] = '\0';
+    return len;
+}
+
+// Write a log line to all loggers on the caller's stack
+void OXRS_LOG::write(LogLevel_t level, const char* prefix, const char* logEvent, uint32_t timestamp_ms)
+{
+    size_t header = formatHeader(level, prefix);
+    size_t len = appendLine(_line, header, logEvent);
+    writeText(level, prefix, header, len, timestamp_ms);
+}
+
+// Write the line in _line, in binary mode as a plain message frame
+void OXRS_LOG::writeText(LogLevel_t level, const char* prefix, size_t header, size_t len, uint32_t timestamp_ms)
+{
+    if (!_binary)
+    {
+        writeLine(level, prefix, header, len);
+        return;
     }
+
+    OXRS_LOG_FRAME frame(_frame, LOG_FRAME_LEN);
+    frame.begin(level, timestamp_ms, OXRS_LOG_FRAME::id(prefix), 0);
+    frame.add((const char*)_line + header);
+    writeFrame(level, prefix, frame.end(), header, _serialText ? len : 0);
 }
 
-void OXRS_LOG::log(LogLevel_t level, const char* prefix, String& logEvent)
+void OXRS_LOG::writeRecord(const LogRecord_t& record)
+{
+    if (record.frameLen == 0)
+    {
+        write(record.level, record.prefix, record.message, record.timestamp_ms);
+        return;
+    }
+
+    // frame was encoded by logb() on the producing core, text follows it if any
+    const char* text = record.message + record.frameLen;
+    size_t header = 0, len = 0;
+    if (*text)
+    {
+        header = formatHeader(record.level, record.prefix);
+        len = appendLine(_line, header, text);
+    }
+    memcpy(_frame, record.message, record.frameLen);
+    writeFrame(record.level, record.prefix, record.frameLen, header, len);
+}
+
+// Write _frame to all loggers, with _line for the Serial logger if lineLen
+void OXRS_LOG::writeFrame(LogLevel_t level, const char* prefix, size_t frameLen, size_t header, size_t lineLen)
+{
+    if (isRepeat(level, prefix, OXRS_LOG_FRAME::contentHash(_frame, frameLen)))
+        return;
+
+    if (lineLen)
+        _retained.write(level, millis(), false, _line, lineLen);
+    else
+        _retained.write(level, millis(), true, _frame, frameLen);
+
+    LogEntry_t entry = {level, prefix, lineLen ? _line : nullptr, lineLen, header, _frame, frameLen};
+    dispatch(entry);
+}
+
+// Format prefix and level into the line buffer, returns their length
+size_t OXRS_LOG::formatHeader(LogLevel_t level, const char* prefix)
+{
+    size_t len = appendLine(_line, 0, prefix);
+    return appendLine(_line, len, levelStr[level]);
+}
+
+void OXRS_LOG::writeLine(LogLevel_t level, const char* prefix, size_t header, size_t len)
+{
+    if (isRepeat(level, prefix, OXRS_LOG_FRAME::hash(_line, len)))
+        return;
+
+    _retained.write(level, millis(), false, _line, len);
+
+    LogEntry_t entry = {level, prefix, _line, len, header, nullptr, 0};
+    dispatch(entry);
+}
+
+// Pass the entry to each logger wanting its level, one compare for the rest
+void OXRS_LOG::dispatch(const LogEntry_t& entry)
+{
+    for (uint8_t i = 0; i < _loggerCount; i++)
+    {
+        if (entry.level >= _loggers[i]->getThreshold())
+            _loggers[i]->log(entry);
+    }
+}
+
+// True if the line is the same as the last one written, which is counted
+// instead. Otherwise summarises any repeats before the line is written.
+bool OXRS_LOG::isRepeat(LogLevel_t level, const char* prefix, uint32_t hash)
+{
+    if (hash == _repeatHash && level == _repeatLevel && prefix == _repeatPrefix)
+    {
+        if (_repeatCount++ == 0)
+            _repeatSince_ms = millis();
+        _repeated++;
+        flushRepeats(false);
+        return true;
+    }
+
+    flushRepeats(true);
+    _repeatHash   = hash;
+    _repeatLevel  = level;
+    _repeatPrefix = prefix;
+    return false;
+}
+
+// Write a "repeated N times" line for the last line, if held long enough or
+// forced. Uses its own buffers as the shared ones may hold the next line.
+void OXRS_LOG::flushRepeats(bool force)
+{
+    if (_repeatCount == 0)
+        return;
+
+    if (!force && millis() - _repeatSince_ms < LOG_REPEAT_SUMMARY_MS)
+        return;
+
+    char line[80];
+    int header = snprintf(line, sizeof(line), "%s%s", _repeatPrefix, levelStr[_repeatLevel]);
+    int len = snprintf(line + header, sizeof(line) - header, "Last message repeated %lu times", (unsigned long)_repeatCount);
+    len = min(header + len, (int)sizeof(line) - 1);
+    _repeatCount = 0;
+
+    uint8_t frame[64];
+    size_t frameLen = 0;
+    if (_binary)
+    {
+        OXRS_LOG_FRAME repeats(frame, sizeof(frame));
+        repeats.begin(_repeatLevel, millis(), OXRS_LOG_FRAME::id(_repeatPrefix), 0);
+        repeats.add((const char*)line + header);
+        frameLen = repeats.end();
+    }
+
+    _retained.write(_repeatLevel, millis(), false, line, len);
+
+    bool text = !_binary || _serialText;
+    LogEntry_t entry = {_repeatLevel, _repeatPrefix, text ? line : nullptr, text ? (size_t)len : 0, (size_t)header,
+        _binary ? frame : nullptr, frameLen};
+    dispatch(entry);
+}
+
+void OXRS_LOG::initRecord(LogRecord_t& record, LogLevel_t level, const char* prefix)
 {
-    if (level >= _currentLevel) {
-        String logLine(prefix);
-        logLine.concat(levelStr[level]);
-        logLine.concat(logEvent);
-        for (std::list<AbstractLogger*>::iterator iter=_loggers.begin(); iter != _loggers.end(); ++iter) {
-            (*iter)->log(level, logLine);
+    record.timestamp_ms = millis();
+    record.level        = level;
+    record.prefix       = prefix;
+}
+
+uint8_t OXRS_LOG::getCore()
+{
+#ifdef ARDUINO_ARCH_RP2040
+    return rp2040.cpuid();
+#else
+    // native builds, the core the test has set for the thread
+    return get_core_num() % LOG_CORES;
+#endif
+}
+
+// Apply the overflow policy if the core's ring is full, false if the record
+// is to be dropped
+bool OXRS_LOG::reserve(uint8_t core)
+{
+    if (!_rings[core].full())
+        return true;
+
+    switch (_overflowPolicy)
+    {
+    case BLOCK:
+        if (core != _pumpCore)
+        {
+            while (_rings[core].full())
+                yield();
+            return true;
+        }
+        if (!_pumping)
+        {
+            pump();
+            return true;
         }
+        // logged by a logger while pumping, cannot wait on ourselves
+        break;
+
+    case DROP_NEWEST:
+        break;
+
+    default:
+        // ring overwrites the oldest record, counted by the pump
+        return true;
     }
+
+    _dropped[core].store(_dropped[core].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+}
+
+bool OXRS_LOG::isAsync() const
+{
+    return _async;
+}
+
+void OXRS_LOG::setAsync(bool async)
+{
+    _async = async;
+    if (!async)
+        pump();
+}
+
+OXRS_LOG::OverflowPolicy_t OXRS_LOG::getOverflowPolicy() const
+{
+    return _overflowPolicy;
+}
+
+void OXRS_LOG::setOverflowPolicy(OverflowPolicy_t policy)
+{
+    _overflowPolicy = policy;
+}
+
+/*
+ * Drain queued records to the loggers, summarise long running repeats, then
+ * poll the loggers. At most one ring's
+ * worth is taken from each core per call so a chatty producer cannot hold
+ * the caller.
+ */
+void OXRS_LOG::pump()
+{
+    if (_pumping)
+        return;
+    _pumping = true;
+    _pumpCore = getCore();
+
+    LogRecord_t record;
+    for (uint8_t core = 0; core < LOG_CORES; core++)
+    {
+        uint32_t lost = 0;
+        for (size_t n = 0; n < LOG_RING_SIZE && _rings[core].pop(record, lost); n++)
+            writeRecord(record);
+
+        if (lost)
+            _lost.store(_lost.load(std::memory_order_relaxed) + lost, std::memory_order_relaxed);
+    }
+
+    flushRepeats(false);
+
+    for (uint8_t i = 0; i < _loggerCount; i++)
+        _loggers[i]->poll();
+
+    _pumping = false;
+}
+
+void OXRS_LOG::countRateLimited()
+{
+    uint8_t core = getCore();
+    _rateLimited[core].store(_rateLimited[core].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+uint32_t OXRS_LOG::getRateLimitedCount() const
+{
+    uint32_t rateLimited = 0;
+    for (uint8_t core = 0; core < LOG_CORES; core++)
+        rateLimited += _rateLimited[core].load(std::memory_order_relaxed);
+    return rateLimited;
+}
+
+uint32_t OXRS_LOG::getRepeatedCount() const
+{
+    return _repeated;
+}
+
+bool OXRS_LOG::isBinary() const
+{
+    return _binary;
+}
+
+void OXRS_LOG::setBinary(bool binary)
+{
+    _binary = binary;
+}
+
+bool OXRS_LOG::isSerialText() const
+{
+    return _serialText;
+}
+
+void OXRS_LOG::setSerialText(bool serialText)
+{
+    _serialText = serialText;
+}
+
+bool OXRS_LOG::hasRetained() const
+{
+    return _retained.hasPrevious();
+}
+
+// Write the previous boot's lines to all loggers, bypassing repeat
+// detection and the retained log itself
+size_t OXRS_LOG::replayRetained()
+{
+    if (!_retained.hasPrevious())
+        return 0;
+
+    logf(INFO, _LOG_PREFIX, "Lines retained from boot %lu follow", (unsigned long)(_retained.getBoot() - 1));
+
+    size_t count = _retained.forEachPrevious([this](const OXRS_LOG_RETAINED::Record_t& record) {
+        // the prefix is not retained, the line still starts with it
+        LogEntry_t entry = {(LogLevel_t)record.level, "", nullptr, 0, 0, nullptr, 0};
+        if (record.binary)
+        {
+            entry.frameLen = min((size_t)record.len, (size_t)LOG_FRAME_LEN);
+            memcpy(_frame, record.text, entry.frameLen);
+            entry.frame = _frame;
+        }
+        else
+        {
+            memcpy(_line, record.text, record.len);
+            _line[record.len] = '\0';
+            entry.line = _line;
+            entry.lineLen = record.len;
+        }
+        dispatch(entry);
+    });
+
+    logf(INFO, _LOG_PREFIX, "End of %u retained lines", (unsigned)count);
+    return count;
+}
+
+size_t OXRS_LOG::printRetained(Print& out) const
+{
+    static const char hex[] = "0123456789abcdef";
+
+    return _retained.forEachPrevious([&out](const OXRS_LOG_RETAINED::Record_t& record) {
+        if (record.binary)
+        {
+            out.print('#');
+            for (size_t i = 0; i < record.len; i++)
+            {
+                out.print(hex[(uint8_t)record.text[i] >> 4]);
+                out.print(hex[(uint8_t)record.text[i] & 0xf]);
+            }
+        }
+        else
+        {
+            out.write((const uint8_t*)record.text, record.len);
+        }
+        out.println();
+    });
+}
+
+uint32_t OXRS_LOG::getDroppedCount() const
+{
+    uint32_t dropped = _lost.load(std::memory_order_relaxed);
+    for (uint8_t core = 0; core < LOG_CORES; core++)
+        dropped += _dropped[core].load(std::memory_order_relaxed);
+    return dropped;
 }
 
 JsonVariant OXRS_LOG::findNestedKey(JsonObject obj, const String &key)
@@ -99,18 +596,27 @@ JsonVariant OXRS_LOG::findNestedKey(JsonObject obj, const String &key)
 }
 
 // FIXME: Use jsonschema enum to avoid string to enum translation
+bool OXRS_LOG::parseLevel(const char* sLogLevel, LogLevel_t& level)
+{
+    for (uint8_t l = DEBUG; l <= FATAL; l++)
+    {
+        // levelStr is "[LEVEL] "
+        const char* s = levelStr[l] + 1;
+        size_t len = strlen(s) - 2;
+        if (strncmp(sLogLevel, s, len) == 0 && sLogLevel[len] == '\0')
+        {
+            level = (LogLevel_t)l;
+            return true;
+        }
+    }
+    return false;
+}
+
 void OXRS_LOG::setLogLevelCommand(const String& sLogLevel)
 {
-    if (sLogLevel=="DEBUG")
-        oxrsLog.setLevel(OXRS_LOG::LogLevel_t::DEBUG);
-    if (sLogLevel=="INFO")
-        oxrsLog.setLevel(OXRS_LOG::LogLevel_t::INFO);
-    if (sLogLevel=="WARN")
-        oxrsLog.setLevel(OXRS_LOG::LogLevel_t::WARN);
-    if (sLogLevel=="ERROR")
-        oxrsLog.setLevel(OXRS_LOG::LogLevel_t::ERROR);
-    if (sLogLevel=="FATAL")
-        oxrsLog.setLevel(OXRS_LOG::LogLevel_t::FATAL);
+    LogLevel_t level;
+    if (parseLevel(sLogLevel.c_str(), level))
+        oxrsLog.setLevel(level);
 }
 
 void OXRS_LOG::onConfig(JsonVariant json) {
@@ -122,10 +628,47 @@ void OXRS_LOG::onConfig(JsonVariant json) {
         setLogLevelCommand(sLoglevel);
     }
 
-    // iterate through all loggers for onConfig
-    for (std::list<AbstractLogger*>::iterator iter=_loggers.begin(); iter != _loggers.end(); ++iter) {
-        (*iter)->onConfig(json);
+    // replaces all module levels, an empty array clears them
+    JsonVariant jvModuleLevels = findNestedKey(json, "moduleLoglevels");
+    if (jvModuleLevels.is<JsonArray>()) {
+        clearModuleLevels();
+        for (JsonObject moduleLevel : jvModuleLevels.as<JsonArray>()) {
+            const char* module = moduleLevel["module"];
+            LogLevel_t level;
+            if (module && parseLevel(moduleLevel["loglevel"] | "", level))
+                setModuleLevel(module, level);
+        }
+    }
+
+    JsonVariant jvLogOverflow = findNestedKey(json, "logoverflow");
+    if (!jvLogOverflow.isNull()) {
+        String sOverflow(jvLogOverflow.as<String>().c_str());
+        for (uint8_t policy = DROP_OLDEST; policy <= BLOCK; policy++) {
+            if (sOverflow == overflowPolicyStr[policy])
+                setOverflowPolicy((OverflowPolicy_t)policy);
+        }
+    }
+
+    JsonVariant jvLogBinary = findNestedKey(json, "logbinary");
+    if (!jvLogBinary.isNull()) {
+        setBinary(jvLogBinary.as<bool>());
+    }
+
+    JsonVariant jvLogSerialText = findNestedKey(json, "logserialtext");
+    if (!jvLogSerialText.isNull()) {
+        setSerialText(jvLogSerialText.as<bool>());
     }
+
+    JsonVariant jvLogAsync = findNestedKey(json, "logasync");
+    if (!jvLogAsync.isNull()) {
+        setAsync(jvLogAsync.as<bool>());
+    }
+
+    // iterate through all loggers for onConfig
+    for (uint8_t i = 0; i < _loggerCount; i++)
+        _loggers[i]->onConfig(json);
+
+    _configGeneration++;
 }
 
 void OXRS_LOG::setConfig(JsonVariant json)
@@ -148,49 +691,137 @@ void OXRS_LOG::setConfig(JsonVariant json)
     logLevelEnum.add("ERROR");
     logLevelEnum.add("FATAL");
 
+    // Module log levels
+    JsonObject moduleLevels     = logProps.createNestedObject("moduleLoglevels");
+    moduleLevels["title"]       = "Module Log Levels";
+    moduleLevels["description"] = "Override the log level for individual modules, e.g. OXRS_SEN5x to DEBUG.";
+    moduleLevels["type"]        = "array";
+
+    JsonObject moduleItem   = moduleLevels.createNestedObject("items");
+    moduleItem["type"]      = "object";
+    JsonObject moduleProps  = moduleItem.createNestedObject("properties");
+
+    JsonObject module       = moduleProps.createNestedObject("module");
+    module["title"]         = "Module";
+    module["type"]          = "string";
+    module["maxLength"]     = LOG_MODULE_LEN - 1;
+
+    JsonObject moduleLevel  = moduleProps.createNestedObject("loglevel");
+    moduleLevel["title"]    = "Log Level";
+    moduleLevel["enum"]     = logLevelEnum;
+
+    JsonArray moduleRequired = moduleItem.createNestedArray("required");
+    moduleRequired.add("module");
+    moduleRequired.add("loglevel");
+
+    // Async logging
+    JsonObject logAsync     = logProps.createNestedObject("logasync");
+    logAsync["title"]       = "Asynchronous Logging";
+    logAsync["description"] = "Queue log lines and write them to loggers from the main loop, so logging never blocks on the network.";
+    logAsync["type"]        = "boolean";
+    logAsync["default"]     = oxrsLog.isAsync();
+
+    JsonObject logOverflow     = logProps.createNestedObject("logoverflow");
+    logOverflow["title"]       = "Asynchronous Log Overflow";
+    logOverflow["description"] = "What to do when the log queue is full.";
+    logOverflow["default"]     = overflowPolicyStr[oxrsLog.getOverflowPolicy()];
+
+    JsonArray logOverflowEnum = logOverflow.createNestedArray("enum");
+    for (const char* policy : overflowPolicyStr)
+        logOverflowEnum.add(policy);
+
+    // Binary logging
+    JsonObject logBinary     = logProps.createNestedObject("logbinary");
+    logBinary["title"]       = "Binary Logging";
+    logBinary["description"] = "Send MQTT and syslog loggers compact binary frames rather than text, decoded with tools/log_decode.py.";
+    logBinary["type"]        = "boolean";
+    logBinary["default"]     = oxrsLog.isBinary();
+
+    JsonObject logSerialText     = logProps.createNestedObject("logserialtext");
+    logSerialText["title"]       = "Serial Text Logging";
+    logSerialText["description"] = "Keep the serial logger human readable when binary logging.";
+    logSerialText["type"]        = "boolean";
+    logSerialText["default"]     = oxrsLog.isSerialText();
+
     // iterate through all loggers to get config
-    for (std::list<AbstractLogger*>::iterator iter=_loggers.begin(); iter != _loggers.end(); ++iter) {
-        (*iter)->setConfig(logProps);
-    }
+    for (uint8_t i = 0; i < _loggerCount; i++)
+        _loggers[i]->setConfig(logProps);
 }
 
-// Serial logger
-void OXRS_LOG::SerialLogger::log(LogLevel_t level, const __FlashStringHelper* logLine)
+// Frame as "#<hex>" for loggers that can only take text, returns its length
+static size_t formatHex(char* line, size_t size, const uint8_t* frame, size_t len)
 {
-    Serial.println(logLine);
+    static const char hex[] = "0123456789abcdef";
+
+    size_t n = 0;
+    line[n++] = '#';
+    for (size_t i = 0; i < len && n + 2 <= size; i++)
+    {
+        line[n++] = hex[frame[i] >> 4];
+        line[n++] = hex[frame[i] & 0xf];
+    }
+    return n;
 }
 
-void OXRS_LOG::SerialLogger::log(LogLevel_t level, const char* logLine)
+// Minimum level property for a logger's schema
+void OXRS_LOG::AbstractLogger::setLevelConfig(JsonObject props, const char* key, const char* title) const
 {
-    Serial.println(logLine);
+    JsonObject level     = props.createNestedObject(key);
+    level["title"]       = title;
+    level["description"] = "Lowest level sent to this logger, after the overall log level.";
+    level["default"]     = levelStr[_minLevel < DEBUG ? DEBUG : _minLevel] + 1;
+
+    JsonArray levelEnum = level.createNestedArray("enum");
+    levelEnum.add("DEBUG");
+    levelEnum.add("INFO");
+    levelEnum.add("WARN");
+    levelEnum.add("ERROR");
+    levelEnum.add("FATAL");
 }
 
-void OXRS_LOG::SerialLogger::log(LogLevel_t level, String& logLine)
+void OXRS_LOG::AbstractLogger::onLevelConfig(JsonVariant json, const char* key)
 {
-    Serial.println(logLine);
+    JsonVariant jvLevel = findNestedKey(json, key);
+    LogLevel_t level;
+    if (!jvLevel.isNull() && parseLevel(jvLevel | "", level))
+        setMinLevel(level);
 }
 
-// Mqtt Logger
-void OXRS_LOG::MQTTLogger::log(LogLevel_t level, const __FlashStringHelper* logLine)
+// Serial logger
+void OXRS_LOG::SerialLogger::log(const LogEntry_t& entry)
 {
-    if (_client.connected() && isEnabled()) {
-        String s(logLine);
-        _client.publish(_topic.c_str(), s.c_str());
+    if (entry.line)
+    {
+        Serial.write((const uint8_t*)entry.line, entry.lineLen);
     }
+    else
+    {
+        char line[1 + 2 * LOG_FRAME_LEN];
+        Serial.write((const uint8_t*)line, formatHex(line, sizeof(line), entry.frame, entry.frameLen));
+    }
+    Serial.println();
 }
 
-void OXRS_LOG::MQTTLogger::log(LogLevel_t level, const char* logLine)
+void OXRS_LOG::SerialLogger::setConfig(JsonVariant json)
 {
-    if (_client.connected() && isEnabled()) {
-        _client.publish(_topic.c_str(), logLine);
-    }
+    setLevelConfig(json, LEVEL_CONFIG, "Serial Log Level");
 }
 
-void OXRS_LOG::MQTTLogger::log(LogLevel_t level, String& logLine)
+void OXRS_LOG::SerialLogger::onConfig(JsonVariant json)
 {
-    if (_client.connected() && isEnabled()) {
-        _client.publish(_topic.c_str(), logLine.c_str());
-    }
+    onLevelConfig(json, LEVEL_CONFIG);
+}
+
+// Mqtt Logger, frames published raw
+void OXRS_LOG::MQTTLogger::log(const LogEntry_t& entry)
+{
+    if (!_client.connected())
+        return;
+
+    if (entry.frame)
+        _client.publish(_topic.c_str(), entry.frame, entry.frameLen, false);
+    else
+        _client.publish(_topic.c_str(), (const uint8_t*)entry.line, entry.lineLen, false);
 }
 
 void OXRS_LOG::MQTTLogger::setConfig(JsonVariant json)
@@ -217,6 +848,8 @@ void OXRS_LOG::MQTTLogger::setConfig(JsonVariant json)
     serverProps["description"] = "";
     serverProps["default"]     = _topic;
 
+    setLevelConfig(enableProps, LEVEL_CONFIG, "Log Level");
+
     JsonArray required = obj.createNestedArray("required");
     required.add(TOPIC_CONFIG);
 
@@ -239,6 +872,8 @@ void OXRS_LOG::MQTTLogger::onConfig(JsonVariant json)
             if (!jvTopic.isNull()) {
                 _topic = jvTopic.as<String>();
             }
+
+            onLevelConfig(json, LEVEL_CONFIG);
         }
 
         if (!isEnabled() && enable) {
@@ -282,6 +917,16 @@ void OXRS_LOG::SysLogger::setConfig(JsonVariant json)
     portProps["description"] = "";
     portProps["default"]     = 514;
 
+    JsonObject batchProps = enableProps.createNestedObject(BATCH_CONFIG);
+    batchProps["type"]        = "integer";
+    batchProps["title"]       = "Batch Window (ms)";
+    batchProps["description"] = "Send lines logged within this window in one datagram, separated by newlines. The server must split them. 0 sends each line on its own.";
+    batchProps["minimum"]     = 0;
+    batchProps["maximum"]     = MAX_BATCH_MS;
+    batchProps["default"]     = 0;
+
+    setLevelConfig(enableProps, LEVEL_CONFIG, "Log Level");
+
     JsonArray required = obj.createNestedArray("required");
     required.add("server");
     required.add("port");
@@ -300,6 +945,9 @@ void OXRS_LOG::SysLogger::onConfig(JsonVariant json)
     if (!jvEnable.isNull()) {
         bool enable = jvEnable.as<bool>();
 
+        // anything batched goes to the old server
+        flushBatch();
+
         if (enable) {
             JsonVariant jvServer = findNestedKey(json, SERVER_CONFIG);
             if (!jvServer.isNull()) {
@@ -310,6 +958,17 @@ void OXRS_LOG::SysLogger::onConfig(JsonVariant json)
             if (!jvPort.isNull()) {
                 _port = jvPort.as<uint16_t>();
             }
+
+            JsonVariant jvBatch = findNestedKey(json, BATCH_CONFIG);
+            if (!jvBatch.isNull()) {
+                _batch_ms = min(jvBatch.as<uint16_t>(), MAX_BATCH_MS);
+            }
+
+            onLevelConfig(json, LEVEL_CONFIG);
+
+            // resolve again on the next send
+            _resolved = false;
+            _resolveAttempted = false;
         }
 
         if (!isEnabled() && enable) {
@@ -323,82 +982,130 @@ void OXRS_LOG::SysLogger::onConfig(JsonVariant json)
     }
 }
 
-void OXRS_LOG::SysLogger::getDateTime(String& dt)
+// RFC 5424 TIMESTAMP, reformatted at most once a second
+const char* OXRS_LOG::SysLogger::getTimestamp()
 {
     time_t now = time(nullptr);
-    struct tm timeinfo;
-    gmtime_r(&now, &timeinfo);
-    dt = asctime(&timeinfo);
+    if (now != _timestampSecond || !_timestamp[0])
+    {
+        _timestampSecond = now;
+
+        // NILVALUE until the clock has been set
+        if (now < CLOCK_VALID_EPOCH)
+        {
+            strcpy(_timestamp, "-");
+        }
+        else
+        {
+            struct tm timeinfo;
+            gmtime_r(&now, &timeinfo);
+            strftime(_timestamp, sizeof(_timestamp), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+        }
+    }
+    return _timestamp;
 }
 
-void OXRS_LOG::SysLogger::log(LogLevel_t level, const __FlashStringHelper* logLine)
+const char* OXRS_LOG::SysLogger::getHostname()
 {
-    if (!isEnabled())
-        return;
+    if (_hostname.isEmpty())
+    {
+        const char* hostname = WiFi.getHostname();
+        if (hostname)
+        {
+            _hostname = hostname;
+            _hostname.replace(' ', '-');
+        }
+    }
+    return _hostname.isEmpty() ? "-" : _hostname.c_str();
+}
 
-    String dt;
-    getDateTime(dt);
+void OXRS_LOG::SysLogger::log(const LogEntry_t& entry)
+{
+    // raw frame as the UDP payload, not a syslog message, for tools/log_decode.py
+    if (entry.frame)
+    {
+        // frames are not batched, keep them in order with lines
+        flushBatch();
+        send(entry.frame, entry.frameLen);
+        return;
+    }
 
     uint8_t facility = FAC_LOCAL0;
-    uint8_t severity = getSeverity(level);
+    uint8_t severity = getSeverity(entry.level);
     uint8_t priority = (8 * facility) + severity;
 
-    // This is a unit8 instead of a char because that's what udp.write() wants
-    uint8_t buffer[MAX_PACKET_SIZE];
-    String s(logLine);
-    int len = snprintf((char*)buffer, MAX_PACKET_SIZE, "<%d>%s %s %s: %s", priority, dt.c_str(), _hostname.c_str(), _app.c_str(), s);
-
-//Aug 26 17:00:47
+    // format straight into the batch, room for a full line and its newline
+    if (MAX_DATAGRAM_SIZE - _batchLen < MAX_PACKET_SIZE + 1u)
+        flushBatch();
 
-    // Send the raw UDP packet
-    send(buffer, len);
-}
-
-void OXRS_LOG::SysLogger::log(LogLevel_t level, const char* logLine)
-{
-    if (!isEnabled())
+    uint8_t* buffer = _batch + _batchLen;
+    int n = snprintf((char*)buffer, MAX_PACKET_SIZE, "<%d>1 %s %s %s - - - %.*s",
+        priority, getTimestamp(), getHostname(), _app.c_str(), (int)entry.lineLen, entry.line);
+    if (n < 0)
         return;
+    n = min(n, MAX_PACKET_SIZE - 1);
 
-    String dt;
-    getDateTime(dt);
-
-    uint8_t facility = FAC_LOCAL0;
-    uint8_t severity = getSeverity(level);
-    uint8_t priority = (8 * facility) + severity;
+    if (_batch_ms == 0)
+    {
+        send(buffer, n);
+        return;
+    }
 
-    // This is a unit8 instead of a char because that's what udp.write() wants
-    uint8_t buffer[MAX_PACKET_SIZE];
-    int len = snprintf((char*)buffer, MAX_PACKET_SIZE, "<%d>%s %s %s: %s", priority, dt.c_str(), _hostname.c_str(), _app.c_str(), logLine);
+    if (_batchLen == 0)
+        _batchStart_ms = millis();
+    buffer[n] = '\n';
+    _batchLen += n + 1;
+}
 
-    // Send the raw UDP packet
-    send(buffer, len);
+void OXRS_LOG::SysLogger::poll()
+{
+    if (_batchLen && millis() - _batchStart_ms >= _batch_ms)
+        flushBatch();
 }
 
-void OXRS_LOG::SysLogger::log(LogLevel_t level, String& logLine)
+void OXRS_LOG::SysLogger::flushBatch()
 {
-    if (!isEnabled())
+    if (_batchLen == 0)
         return;
 
-    String dt;
-    getDateTime(dt);
+    send(_batch, _batchLen);
+    _batchLen = 0;
+}
 
-    uint8_t facility = FAC_LOCAL0;
-    uint8_t severity = getSeverity(level);
-    uint8_t priority = (8 * facility) + severity;
+// Resolve _server, at most once per RESOLVE_RETRY_MS while failing
+bool OXRS_LOG::SysLogger::resolve()
+{
+    if (_resolved)
+        return true;
+
+    if (_server.isEmpty())
+        return false;
 
-    // This is a unit8 instead of a char because that's what udp.write() wants
-    uint8_t buffer[MAX_PACKET_SIZE];
-    int len = snprintf((char*)buffer, MAX_PACKET_SIZE, "<%d>%s %s %s: %s", priority, dt.c_str(), _hostname.c_str(), _app.c_str(), logLine.c_str());
+    if (_resolveAttempted && millis() - _resolve_ms < RESOLVE_RETRY_MS)
+        return false;
 
-    // Send the raw UDP packet
-    send(buffer, len);
+    _resolveAttempted = true;
+    _resolve_ms = millis();
+    _resolved = WiFi.hostByName(_server.c_str(), _serverIP) == 1;
+    return _resolved;
 }
 
-void OXRS_LOG::SysLogger::send(uint8_t* pBuffer, int len) 
+// Lines are dropped while the server cannot be resolved
+void OXRS_LOG::SysLogger::send(const uint8_t* pBuffer, int len) 
 {
-    _syslogger.beginPacket(_server.c_str(), _port);
-    _syslogger.write(pBuffer, len);
-    _syslogger.endPacket();
+    if (!resolve())
+        return;
+
+    bool sent = _syslogger.beginPacket(_serverIP, _port) == 1;
+    if (sent)
+    {
+        _syslogger.write(pBuffer, len);
+        sent = _syslogger.endPacket() == 1;
+    }
+
+    // the address may have changed
+    if (!sent)
+        _resolved = false;
 }
 
 uint8_t OXRS_LOG::SysLogger::getSeverity(LogLevel_t level)
@@ -418,3 +1125,502 @@ uint8_t OXRS_LOG::SysLogger::getSeverity(LogLevel_t level)
             return PRI_INFO;
     }
 }
+
+// Loki logger
+void OXRS_LOG::LokiLogger::setConfig(JsonVariant json)
+{
+    JsonObject loki = json.createNestedObject("loki");
+    loki["title"]   = "Loki";
+    JsonObject lokiProps = loki.createNestedObject("properties");
+    JsonObject enable = lokiProps.createNestedObject(LOKI_ENABLE);
+    enable["type"]    = "boolean";
+    enable["title"]   = "Enable";
+
+    JsonObject deps = loki.createNestedObject("dependencies");
+    JsonObject lokiEnable = deps.createNestedObject(LOKI_ENABLE);
+    JsonArray oneOfArr = lokiEnable.createNestedArray("oneOf");
+    JsonObject obj = oneOfArr.createNestedObject();
+    JsonObject enableProps = obj.createNestedObject("properties");
+    JsonObject lokiEnableProps = enableProps.createNestedObject(LOKI_ENABLE);
+    JsonArray arrEnum = lokiEnableProps.createNestedArray("enum");
+    arrEnum.add(true);
+
+    JsonObject urlProps = enableProps.createNestedObject(URL_CONFIG);
+    urlProps["type"]        = "string";
+    urlProps["title"]       = "Push URL";
+    urlProps["description"] = "e.g. http://loki:3100/loki/api/v1/push";
+
+    JsonObject batchProps = enableProps.createNestedObject(BATCH_CONFIG);
+    batchProps["type"]        = "integer";
+    batchProps["title"]       = "Batch Window (ms)";
+    batchProps["description"] = "Longest a line is held before being pushed.";
+    batchProps["minimum"]     = MIN_BATCH_MS;
+    batchProps["maximum"]     = MAX_BATCH_MS;
+    batchProps["default"]     = _batch_ms;
+
+    setLevelConfig(enableProps, LEVEL_CONFIG, "Log Level");
+
+    JsonArray required = obj.createNestedArray("required");
+    required.add(URL_CONFIG);
+
+    obj = oneOfArr.createNestedObject();
+    enableProps = obj.createNestedObject("properties");
+    lokiEnableProps = enableProps.createNestedObject(LOKI_ENABLE);
+    arrEnum = lokiEnableProps.createNestedArray("enum");
+    arrEnum.add(false);
+}
+
+void OXRS_LOG::LokiLogger::onConfig(JsonVariant json)
+{
+    // Process log config changes
+    JsonVariant jvEnable = findNestedKey(json, LOKI_ENABLE);
+    if (!jvEnable.isNull()) {
+        bool enable = jvEnable.as<bool>();
+
+        if (enable) {
+            JsonVariant jvUrl = findNestedKey(json, URL_CONFIG);
+            if (!jvUrl.isNull() && !parseUrl(jvUrl.as<String>())) {
+                LOG_WARN(F("Invalid Loki push URL, only http is supported"));
+                enable = false;
+            }
+
+            JsonVariant jvBatch = findNestedKey(json, BATCH_CONFIG);
+            if (!jvBatch.isNull()) {
+                _batch_ms = constrain(jvBatch.as<uint32_t>(), MIN_BATCH_MS, MAX_BATCH_MS);
+            }
+
+            onLevelConfig(json, LEVEL_CONFIG);
+
+            // try the new server straight away, any push in flight is resent
+            _client.stop();
+            _resolved = false;
+            _resolveAttempted = false;
+            _sentCount = 0;
+            _backoff_ms = 0;
+        }
+
+        if (!isEnabled() && enable) {
+            setEnable(enable);
+            LOG_DEBUG(F("Loki enabled"));
+        }
+        if (isEnabled() && !enable) {
+            LOG_DEBUG(F("Loki disabled"));
+            setEnable(enable);
+            _client.stop();
+            _count = 0;
+            _textLen = 0;
+            _sentCount = 0;
+        }
+    }
+}
+
+// Split http://host[:port]/path, short enough for the request header
+bool OXRS_LOG::LokiLogger::parseUrl(const String& url)
+{
+    if (!url.startsWith("http://") || url.length() > MAX_URL_LEN)
+        return false;
+
+    String hostPort = url.substring(7);
+    int slash = hostPort.indexOf('/');
+    _path = slash < 0 ? String("/loki/api/v1/push") : hostPort.substring(slash);
+    if (slash >= 0)
+        hostPort = hostPort.substring(0, slash);
+
+    int colon = hostPort.indexOf(':');
+    _host = colon < 0 ? hostPort : hostPort.substring(0, colon);
+    _port = colon < 0 ? 80 : hostPort.substring(colon + 1).toInt();
+    return !_host.isEmpty() && _port != 0;
+}
+
+// Buffer the message and module, which is a label
+void OXRS_LOG::LokiLogger::log(const LogEntry_t& entry)
+{
+    // "[module] "
+    const char* module = entry.prefix;
+    size_t moduleLen = 0;
+    if (*module == '[')
+    {
+        module++;
+        const char* close = strchr(module, ']');
+        moduleLen = close ? min((size_t)(close - module), (size_t)UINT8_MAX) : 0;
+    }
+
+    // message without its header, or the frame as hex
+    char hex[1 + 2 * LOG_FRAME_LEN];
+    const char* message = hex;
+    size_t messageLen;
+    if (entry.line)
+    {
+        message = entry.line + entry.headerLen;
+        messageLen = entry.lineLen - entry.headerLen;
+    }
+    else
+    {
+        messageLen = formatHex(hex, sizeof(hex), entry.frame, entry.frameLen);
+    }
+    messageLen = min(messageLen, (size_t)UINT16_MAX);
+
+    if (_count == LOKI_MAX_ENTRIES || _textLen + moduleLen + messageLen > LOKI_BUFFER_SIZE)
+    {
+        _dropped++;
+        return;
+    }
+
+    Entry_t& buffered = _entries[_count++];
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    buffered.time_s     = tv.tv_sec < CLOCK_VALID_EPOCH ? 0 : tv.tv_sec;
+    buffered.time_ms    = tv.tv_usec / 1000;
+    buffered.level      = entry.level;
+    buffered.offset     = _textLen;
+    buffered.moduleLen  = moduleLen;
+    buffered.messageLen = messageLen;
+    buffered.logged_ms  = millis();
+    memcpy(_text + _textLen, module, moduleLen);
+    memcpy(_text + _textLen + moduleLen, message, messageLen);
+    _textLen += moduleLen + messageLen;
+
+    if (_count == 1)
+        _batchStart_ms = millis();
+}
+
+bool OXRS_LOG::LokiLogger::isFlushDue() const
+{
+    if (_count == 0 || _sentCount || !_resolved)
+        return false;
+
+    // lines are held until the clock is set, so they can be dated
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (now.tv_sec < CLOCK_VALID_EPOCH)
+        return false;
+
+    if (_backoff_ms)
+        return millis() - _retry_ms >= _backoff_ms;
+
+    // nearly full, or held for the batch window
+    return _count >= LOKI_MAX_ENTRIES * 3 / 4 ||
+           _textLen >= LOKI_BUFFER_SIZE * 3 / 4 ||
+           millis() - _batchStart_ms >= _batch_ms;
+}
+
+void OXRS_LOG::LokiLogger::poll()
+{
+    if (!isEnabled())
+        return;
+
+    if (_sentCount)
+        readResponse();
+    else if (resolve() && isFlushDue())
+        push();
+}
+
+// Look up _host once the network is up, not when pushing, and then at most
+// once per RESOLVE_RETRY_MS while it or a connect to it fails
+bool OXRS_LOG::LokiLogger::resolve()
+{
+    if (_resolved)
+        return true;
+
+    if (_host.isEmpty() || WiFi.status() != WL_CONNECTED)
+        return false;
+
+    if (_resolveAttempted && millis() - _resolve_ms < RESOLVE_RETRY_MS)
+        return false;
+
+    // an address needs no lookup
+    _resolveAttempted = true;
+    _resolve_ms = millis();
+    _resolved = _serverIP.fromString(_host) || WiFi.hostByName(_host.c_str(), _serverIP, RESOLVE_TIMEOUT_MS) == 1;
+    return _resolved;
+}
+
+uint32_t OXRS_LOG::LokiLogger::getDroppedCount() const
+{
+    return _dropped;
+}
+
+uint32_t OXRS_LOG::LokiLogger::getFailureCount() const
+{
+    return _failures;
+}
+
+/*
+ * Buffers writes to a Print, so the body does not go out a byte per TCP
+ * segment, or with no Print only counts them, for the Content-Length.
+ */
+class LokiWriter
+{
+public:
+    LokiWriter(Print* out) : _out(out), _len(0), _count(0), _failed(false) {};
+
+    void write(const char* s, size_t n)
+    {
+        _count += n;
+        if (!_out)
+            return;
+        while (n)
+        {
+            size_t chunk = min(n, sizeof(_buffer) - _len);
+            memcpy(_buffer + _len, s, chunk);
+            _len += chunk;
+            s += chunk;
+            n -= chunk;
+            if (_len == sizeof(_buffer))
+                flush();
+        }
+    }
+
+    void write(const char* s)
+    {
+        write(s, strlen(s));
+    }
+
+    // JSON string contents
+    void writeEscaped(const char* s, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            char c = s[i];
+            if (c == '"' || c == '\\')
+            {
+                char escaped[2] = { '\\', c };
+                write(escaped, 2);
+            }
+            else if ((uint8_t)c < 0x20)
+            {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                write(escaped, 6);
+            }
+            else
+            {
+                write(&c, 1);
+            }
+        }
+    }
+
+    // Bytes written, 0 if the Print did not take them all
+    size_t flush()
+    {
+        if (_out && _len && _out->write((const uint8_t*)_buffer, _len) != _len)
+            _failed = true;
+        _len = 0;
+        return _failed ? 0 : _count;
+    }
+
+private:
+    Print* _out;
+    char   _buffer[128];
+    size_t _len;
+    size_t _count;
+    bool   _failed;
+};
+
+// Push request body of the first count lines, consecutive lines with the
+// same labels share a stream. boot_ms is the epoch at millis() 0, taken once
+// per push so the Content-Length pass and the send pass match.
+size_t OXRS_LOG::LokiLogger::writeBody(Print* out, uint8_t count, uint64_t boot_ms)
+{
+    static const char *lokiLevel[] = { "unknown", "debug", "info", "warn", "error", "critical", "unknown" };
+
+    LokiWriter body(out);
+
+    body.write("{\"streams\":[");
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const Entry_t& entry = _entries[i];
+        const char* module = _text + entry.offset;
+        const Entry_t* previous = i ? &_entries[i - 1] : nullptr;
+        bool sameStream = previous && previous->level == entry.level &&
+            previous->moduleLen == entry.moduleLen &&
+            memcmp(_text + previous->offset, module, entry.moduleLen) == 0;
+
+        if (!sameStream)
+        {
+            if (i)
+                body.write("]},");
+            body.write("{\"stream\":{\"device\":\"");
+            body.writeEscaped(_device.c_str(), _device.length());
+            body.write("\",\"app\":\"");
+            body.write(FW_SHORT_NAME);
+            body.write("\",\"level\":\"");
+            body.write(lokiLevel[entry.level]);
+            body.write("\",\"module\":\"");
+            body.writeEscaped(module, entry.moduleLen);
+            body.write("\"},\"values\":[");
+        }
+        else
+        {
+            body.write(",");
+        }
+
+        // nanosecond epoch as a string, lines logged before the clock was set
+        // are dated from when they were logged
+        char timestamp[32];
+        uint64_t time_ms = entry.time_s ? (uint64_t)entry.time_s * 1000 + entry.time_ms : boot_ms + entry.logged_ms;
+        snprintf(timestamp, sizeof(timestamp), "%lu%03u000000", (unsigned long)(time_ms / 1000), (unsigned)(time_ms % 1000));
+
+        body.write("[\"");
+        body.write(timestamp);
+        body.write("\",\"");
+        body.writeEscaped(module + entry.moduleLen, entry.messageLen);
+        body.write("\"]");
+    }
+    if (count)
+        body.write("]}");
+    body.write("]}");
+    return body.flush();
+}
+
+// Connect to the resolved server, the stream timeout bounds the connect, and
+// the writes after it, so an unreachable server does not stall the loop
+bool OXRS_LOG::LokiLogger::connect()
+{
+    _client.setTimeout(CONNECT_TIMEOUT_MS);
+    if (_client.connect(_serverIP, _port))
+        return true;
+
+    // the address may have changed, it is looked up again by resolve()
+    _resolved = false;
+    return false;
+}
+
+/*
+ * Send the buffered lines over the kept alive connection, or a new one if
+ * there is none or the server has closed it. The response is left for
+ * readResponse() on later polls.
+ */
+void OXRS_LOG::LokiLogger::push()
+{
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    uint64_t boot_ms = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000 - millis();
+
+    _sentCount = _count;
+    size_t contentLength = writeBody(nullptr, _sentCount, boot_ms);
+
+    // the body is only written once the socket is established
+    bool sent = _client.connected() && sendRequest(contentLength, boot_ms);
+    if (!sent)
+    {
+        _client.stop();
+        sent = connect() && sendRequest(contentLength, boot_ms);
+    }
+    if (!sent)
+    {
+        finishPush(0);
+        return;
+    }
+
+    _sent_ms = millis();
+    _responseState = RESPONSE_VERSION;
+    _status = 0;
+    _headerMatch = 0;
+}
+
+bool OXRS_LOG::LokiLogger::sendRequest(size_t contentLength, uint64_t boot_ms)
+{
+    // one write for the headers, rather than a segment each
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+        "POST %s HTTP/1.1\r\nHost: %s:%u\r\nContent-Length: %u\r\nContent-Type: application/json\r\n\r\n",
+        _path.c_str(), _host.c_str(), _port, (unsigned)contentLength);
+    if (n <= 0 || n >= (int)sizeof(header))
+        return false;
+
+    return _client.write((const uint8_t*)header, n) == (size_t)n &&
+           writeBody(&_client, _sentCount, boot_ms) == contentLength;
+}
+
+// Read what has arrived of the response, "HTTP/1.1 204 No Content" then
+// headers, finishing the push once they are read or the server gives up
+void OXRS_LOG::LokiLogger::readResponse()
+{
+    static const char HEADERS_END[] = "\r\n\r\n";
+
+    while (_client.available() > 0)
+    {
+        int c = _client.read();
+        if (c < 0)
+            break;
+
+        switch (_responseState)
+        {
+        case RESPONSE_VERSION:
+            if (c == ' ')
+                _responseState = RESPONSE_STATUS;
+            break;
+
+        case RESPONSE_STATUS:
+            if (c >= '0' && c <= '9')
+            {
+                _status = _status * 10 + (c - '0');
+                break;
+            }
+            _responseState = RESPONSE_HEADERS;
+            _headerMatch = 0;
+            break;
+
+        case RESPONSE_HEADERS:
+            // the status line's own CRLF starts the match
+            _headerMatch = c == HEADERS_END[_headerMatch] ? _headerMatch + 1 : (c == '\r' ? 1 : 0);
+            if (_headerMatch == 4)
+            {
+                finishPush(_status);
+                return;
+            }
+            break;
+        }
+    }
+
+    if (!_client.connected())
+        finishPush(0);
+    else if (millis() - _sent_ms >= RESPONSE_TIMEOUT_MS)
+        finishPush(0);
+}
+
+// Complete a push with its response status, 0 if none was received
+void OXRS_LOG::LokiLogger::finishPush(int status)
+{
+    // only a 204 has no body to skip, anything else is not worth keeping
+    if (status != 204)
+        _client.stop();
+
+    bool retry = status == 0 || status == 429 || status >= 500;
+    if (retry)
+    {
+        // lines are kept and new ones are dropped if the buffer fills, the
+        // address is only looked up again if a connect to it fails
+        _failures++;
+        _retry_ms = millis();
+        _backoff_ms = _backoff_ms ? min(_backoff_ms * 2, MAX_BACKOFF_MS) : MIN_BACKOFF_MS;
+        _sentCount = 0;
+        return;
+    }
+
+    // sent, or rejected in a way a retry will not fix
+    if (status < 200 || status >= 300)
+    {
+        _failures++;
+        _dropped += _sentCount;
+    }
+    _backoff_ms = 0;
+    removeSent();
+}
+
+// Remove the pushed lines, keeping any logged since
+void OXRS_LOG::LokiLogger::removeSent()
+{
+    size_t textLen = _sentCount < _count ? _entries[_sentCount].offset : _textLen;
+    memmove(_text, _text + textLen, _textLen - textLen);
+    memmove(_entries, _entries + _sentCount, (_count - _sentCount) * sizeof(Entry_t));
+    _count -= _sentCount;
+    _textLen -= textLen;
+    for (uint8_t i = 0; i < _count; i++)
+        _entries[i].offset -= textLen;
+
+    // held for another window, their log time is not kept
+    _batchStart_ms = millis();
+    _sentCount = 0;
+}
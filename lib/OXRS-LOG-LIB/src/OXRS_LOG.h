@@ -10,13 +10,38 @@
  *    - Serial   (default)
  *    - MQTT     (state, log topic)
  *    - Syslog   (state, serverIP, servicePort)
+ *    - Loki     (state, push URL, batch window)
  *
  * New loggers can be added by extending the class AbstractLogger.
+ *
+ * Logging is synchronous by default, every logger is called on the caller's
+ * stack. In async mode log calls only append a record to a per core ring,
+ * and pump() (called from OXRS_IO_PICO::loop) drains the rings to the
+ * loggers, so network loggers never stall the caller. Prefixes must be
+ * static strings as only the pointer is recorded.
+ *
+ * Levels can be overridden per module (log prefix without brackets, e.g.
+ * OXRS_SEN5x) through the moduleLoglevels config. Each translation unit
+ * caches its level so a filtered log call costs a single compare, and
+ * building with -DOXRS_LOG_MIN_LEVEL=n removes calls below level n, along
+ * with their arguments and strings, entirely.
+ *
+ * Each log call site is rate limited by a token bucket per core
+ * (LOG_LIMIT_BURST lines, then one per LOG_LIMIT_PERIOD_MS), and consecutive
+ * identical lines are collapsed into a "repeated N times" summary, so a call
+ * in a hot loop cannot flood the loggers. LOGF_ERROR_KEY limits by key
+ * instead, for a call site shared by many sources.
+ *
+ * In binary mode (logbinary config) formatted calls are not expanded;
+ * loggers are sent an OXRS_LOG_FRAME of format id and raw arguments, and
+ * the Serial logger can still format text (logserialtext config). Building
+ * with -DOXRS_LOG_BINARY starts in binary mode and generates the string
+ * table, -DOXRS_LOG_BINARY_ONLY also leaves the format strings out of flash.
  */
 
 #pragma once
 
-#include <list>
+#include <atomic>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -25,23 +50,104 @@
 #include <PubSubClient.h>
 #include <WiFiUdp.h>
 #include <ArduinoJson.h>
-
-#define MAX_BUF_LEN 512
-static char _buffer[MAX_BUF_LEN];
-
-#define LOG_ERROR(s)  oxrsLog.log(OXRS_LOG::LogLevel_t::ERROR, _LOG_PREFIX, s)
-#define LOG_INFO(s)   oxrsLog.log(OXRS_LOG::LogLevel_t::INFO,  _LOG_PREFIX, s)
-#define LOG_WARN(s)   oxrsLog.log(OXRS_LOG::LogLevel_t::WARN,  _LOG_PREFIX, s)
-#define LOG_FATAL(s)  oxrsLog.log(OXRS_LOG::LogLevel_t::FATAL, _LOG_PREFIX, s)
-#define LOG_DEBUG(s)  oxrsLog.log(OXRS_LOG::LogLevel_t::DEBUG, _LOG_PREFIX, s)
-
-#define LOGF_ERROR(fmt, ...)  oxrsLog.logf(OXRS_LOG::LogLevel_t::ERROR, _LOG_PREFIX, fmt, __VA_ARGS__)
-#define LOGF_INFO(fmt, ...)   oxrsLog.logf(OXRS_LOG::LogLevel_t::INFO,  _LOG_PREFIX, fmt, __VA_ARGS__)
-#define LOGF_WARN(fmt, ...)   oxrsLog.logf(OXRS_LOG::LogLevel_t::WARN,  _LOG_PREFIX, fmt, __VA_ARGS__)
-#define LOGF_FATAL(fmt, ...)  oxrsLog.logf(OXRS_LOG::LogLevel_t::FATAL, _LOG_PREFIX, fmt, __VA_ARGS__)
-#define LOGF_DEBUG(fmt, ...)  oxrsLog.logf(OXRS_LOG::LogLevel_t::DEBUG, _LOG_PREFIX, fmt, __VA_ARGS__)
-
-#define ISLOG_DEBUG     (oxrsLog.getLevel()==OXRS_LOG::LogLevel_t::DEBUG)
+#include <OXRS_RING.h>
+#include <OXRS_LOG_FRAME.h>
+#include <OXRS_LOG_RETAINED.h>
+
+// normally provided by the firmware build flags
+#ifndef FW_SHORT_NAME
+#define FW_SHORT_NAME "OXRS"
+#endif
+
+#define MAX_BUF_LEN 512         // formatted log lines over this are truncated
+
+#define LOG_RECORD_LEN  128     // async log lines over this are truncated
+#define LOG_FRAME_LEN   128     // binary frame arguments over this are truncated
+
+#define LOKI_MAX_ENTRIES 64     // lines buffered for the Loki logger
+#define LOKI_BUFFER_SIZE 4096   // bytes of buffered Loki line text
+#define LOG_RING_SIZE   32      // async records buffered per core
+#define LOG_CORES       2
+#define LOG_MAX_LOGGERS 8       // loggers that can be added, including Serial
+
+#define LOG_MODULES     8       // per module level overrides
+#define LOG_REPEAT_SUMMARY_MS 60000 // longest a "repeated N times" summary is held
+
+// Per call site rate limit, a burst of lines then one per period
+#ifndef LOG_LIMIT_BURST
+#define LOG_LIMIT_BURST     10
+#endif
+#ifndef LOG_LIMIT_PERIOD_MS
+#define LOG_LIMIT_PERIOD_MS 1000
+#endif
+#ifndef LOG_LIMIT_KEYS
+#define LOG_LIMIT_KEYS      8   // keys tracked per core by a keyed call site
+#endif
+#define LOG_MODULE_LEN  24      // max module name length, including terminator
+
+// Compile time minimum level (LogLevel_t value), calls below it are removed
+#ifndef OXRS_LOG_MIN_LEVEL
+#define OXRS_LOG_MIN_LEVEL 0
+#endif
+
+#define OXRS_LOG_ENABLED(l)       _logModule.isEnabled(OXRS_LOG::LogLevel_t::l, _LOG_PREFIX)
+#define OXRS_LOG_LIMITED(call)    [&]() { static OXRS_LOG_LIMIT limit; if (limit.allow()) call; }()
+#define OXRS_LOG_KEY_LIMITED(key, call) [&]() { static OXRS_LOG_KEYED_LIMIT<LOG_LIMIT_KEYS> limit; if (limit.allow(key)) call; }()
+#define OXRS_LOG_AT(l, s)         (OXRS_LOG_ENABLED(l) ? OXRS_LOG_LIMITED(oxrsLog.log(OXRS_LOG::LogLevel_t::l, _LOG_PREFIX, s)) : (void)0)
+#define OXRS_LOGF_AT(l, fmt, ...) (OXRS_LOG_ENABLED(l) ? OXRS_LOG_LIMITED(oxrsLog.logb(OXRS_LOG::LogLevel_t::l, _LOG_PREFIX, OXRS_LOG_ID(fmt), OXRS_LOG_FMT(fmt), __VA_ARGS__)) : (void)0)
+#define OXRS_LOGF_KEY_AT(l, key, fmt, ...) (OXRS_LOG_ENABLED(l) ? OXRS_LOG_KEY_LIMITED(key, oxrsLog.logb(OXRS_LOG::LogLevel_t::l, _LOG_PREFIX, OXRS_LOG_ID(fmt), OXRS_LOG_FMT(fmt), __VA_ARGS__)) : (void)0)
+
+// Format id computed at compile time, see tools/log_strings.py
+#define OXRS_LOG_ID(fmt)          (std::integral_constant<uint32_t, OXRS_LOG_FRAME::id(fmt)>::value)
+#ifdef OXRS_LOG_BINARY_ONLY
+#define OXRS_LOG_FMT(fmt)         ((const char*)nullptr)
+#else
+#define OXRS_LOG_FMT(fmt)         fmt
+#endif
+
+#if OXRS_LOG_MIN_LEVEL <= 1
+#define LOG_DEBUG(s)          OXRS_LOG_AT(DEBUG, s)
+#define LOGF_DEBUG(fmt, ...)  OXRS_LOGF_AT(DEBUG, fmt, __VA_ARGS__)
+#define ISLOG_DEBUG           OXRS_LOG_ENABLED(DEBUG)
+#else
+#define LOG_DEBUG(s)          ((void)0)
+#define LOGF_DEBUG(fmt, ...)  ((void)0)
+#define ISLOG_DEBUG           false
+#endif
+
+#if OXRS_LOG_MIN_LEVEL <= 2
+#define LOG_INFO(s)           OXRS_LOG_AT(INFO, s)
+#define LOGF_INFO(fmt, ...)   OXRS_LOGF_AT(INFO, fmt, __VA_ARGS__)
+#else
+#define LOG_INFO(s)           ((void)0)
+#define LOGF_INFO(fmt, ...)   ((void)0)
+#endif
+
+#if OXRS_LOG_MIN_LEVEL <= 3
+#define LOG_WARN(s)           OXRS_LOG_AT(WARN, s)
+#define LOGF_WARN(fmt, ...)   OXRS_LOGF_AT(WARN, fmt, __VA_ARGS__)
+#else
+#define LOG_WARN(s)           ((void)0)
+#define LOGF_WARN(fmt, ...)   ((void)0)
+#endif
+
+#if OXRS_LOG_MIN_LEVEL <= 4
+#define LOG_ERROR(s)          OXRS_LOG_AT(ERROR, s)
+#define LOGF_ERROR(fmt, ...)  OXRS_LOGF_AT(ERROR, fmt, __VA_ARGS__)
+#define LOGF_ERROR_KEY(key, fmt, ...) OXRS_LOGF_KEY_AT(ERROR, key, fmt, __VA_ARGS__)
+#else
+#define LOG_ERROR(s)          ((void)0)
+#define LOGF_ERROR(fmt, ...)  ((void)0)
+#define LOGF_ERROR_KEY(key, fmt, ...) ((void)0)
+#endif
+
+#if OXRS_LOG_MIN_LEVEL <= 5
+#define LOG_FATAL(s)          OXRS_LOG_AT(FATAL, s)
+#define LOGF_FATAL(fmt, ...)  OXRS_LOGF_AT(FATAL, fmt, __VA_ARGS__)
+#else
+#define LOG_FATAL(s)          ((void)0)
+#define LOGF_FATAL(fmt, ...)  ((void)0)
+#endif
 
 /*
  * Singleton log that abstracts underying loggers
@@ -64,6 +170,19 @@ public:
         OFF,
     };
 
+    // What an async log call does when its ring is full
+    enum OverflowPolicy_t {
+        DROP_OLDEST=0,  // overwrite the oldest unread record
+        DROP_NEWEST,    // discard the record being logged
+        BLOCK,          // wait for the pump, or pump inline on the pump's core
+    };
+
+    inline static const char *overflowPolicyStr[] = {
+        "DROP_OLDEST",
+        "DROP_NEWEST",
+        "BLOCK"
+    };
+
     inline static const char *levelStr[] = {
         " ",
         "[DEBUG] ",
@@ -74,14 +193,36 @@ public:
         " "
     };
 
+    /*
+     * A line being logged. The line is "<prefix><[LEVEL] >message" and the
+     * frame its OXRS_LOG_FRAME encoding. In binary mode there is always a
+     * frame and a line only if the Serial logger keeps text, otherwise only
+     * a line. Both point into shared buffers, valid only for the duration
+     * of the call.
+     */
+    typedef struct {
+        LogLevel_t     level;
+        const char*    prefix;          // "[module] ", empty if not known
+        const char*    line;            // null if not formatted
+        size_t         lineLen;
+        size_t         headerLen;       // of prefix and level at the start of line
+        const uint8_t* frame;           // null if not encoded
+        size_t         frameLen;
+    } LogEntry_t;
+
     /* 
-     * Abstrat base class for all loggers
+     * Abstrat base class for all loggers. Each is only passed lines at or
+     * above its own minimum level, and only while enabled.
      */
     class AbstractLogger {
     public:
-        virtual void log(LogLevel_t level, const __FlashStringHelper* logLine)=0;
-        virtual void log(LogLevel_t level, const char* logLine)=0;
-        virtual void log(LogLevel_t level, String& logLine)=0;
+        AbstractLogger() :
+            _enable(false), _minLevel(ALL), _threshold(OFF) {};
+
+        virtual void log(const LogEntry_t& entry)=0;
+
+        // Called regularly from pump() to flush any buffered output
+        virtual void poll() {};
 
         // OXRS callbacks
         virtual void onConfig(JsonVariant json)=0;
@@ -93,10 +234,31 @@ public:
 
         void setEnable(bool e) {
             _enable = e;
+            _threshold = _enable ? _minLevel : OFF;
+        }
+
+        LogLevel_t getMinLevel() const {
+            return _minLevel;
+        }
+
+        void setMinLevel(LogLevel_t level) {
+            _minLevel = level;
+            _threshold = _enable ? _minLevel : OFF;
         }
 
+        // Lowest level passed to log(), OFF while disabled
+        LogLevel_t getThreshold() const {
+            return _threshold;
+        }
+
+    protected:
+        void setLevelConfig(JsonObject props, const char* key, const char* title) const;
+        void onLevelConfig(JsonVariant json, const char* key);
+
     private:
-        bool _enable;   // logger enabled or not
+        bool       _enable;     // logger enabled or not
+        LogLevel_t _minLevel;   // lowest level logged
+        LogLevel_t _threshold;  // _minLevel, or OFF if not enabled
     };
 
     /*
@@ -104,12 +266,16 @@ public:
      */
     class SerialLogger : public AbstractLogger {
     public:
-        virtual void log(LogLevel_t level, const __FlashStringHelper* logLine);
-        virtual void log(LogLevel_t level, const char* logLine);
-        virtual void log(LogLevel_t level, String& logLine);
+        SerialLogger() {
+            setEnable(true);
+        };
 
-        virtual void onConfig(JsonVariant json) {};
-        virtual void setConfig(JsonVariant json) {};
+        virtual void log(const LogEntry_t& entry);
+
+        virtual void onConfig(JsonVariant json);
+        virtual void setConfig(JsonVariant json);
+
+        inline static const char* LEVEL_CONFIG = "seriallog_loglevel";
     };
 
     /*
@@ -124,14 +290,13 @@ public:
             _topic = topic;
         }
 
-        virtual void log(LogLevel_t level, const __FlashStringHelper* logLine);
-        virtual void log(LogLevel_t level, const char* logLine);
-        virtual void log(LogLevel_t level, String& logLine);
+        virtual void log(const LogEntry_t& entry);
 
         virtual void onConfig(JsonVariant json);
         virtual void setConfig(JsonVariant json);
 
         inline static const char* TOPIC_CONFIG   = "topic";
+        inline static const char* LEVEL_CONFIG   = "mqttlog_loglevel";
         inline static const char* MQTTLOG_ENABLE = "mqttlog_enable";
 
     private:
@@ -140,28 +305,47 @@ public:
     };
 
     /*
-     * Basic sys logger
+     * RFC 5424 sys logger over UDP. The server is resolved once, and again
+     * after a config change or send failure. Lines logged within the batch
+     * window are coalesced into one datagram, each terminated by a newline
+     * (RFC 6587 non-transparent framing), so the receiver must split them.
      */
     class SysLogger : public AbstractLogger {
     public:
         SysLogger() :
-            _hostname(""),      // FIXME: to be derived from network configuration
+            _hostname(""),      // from the network on first use
             _app(FW_SHORT_NAME),
             _server(""),
-            _port(514) {};
-
-        virtual void log(LogLevel_t level, const __FlashStringHelper* logLine);
-        virtual void log(LogLevel_t level, const char* logLine);
-        virtual void log(LogLevel_t level, String& logLine);
+            _port(514),
+            _resolved(false),
+            _resolveAttempted(false),
+            _resolve_ms(0),
+            _batch_ms(0),
+            _batchLen(0),
+            _batchStart_ms(0),
+            _timestampSecond(0)
+        {
+            // APP-NAME may not contain spaces
+            _app.replace(' ', '_');
+            _timestamp[0] = '\0';
+        };
+
+        virtual void log(const LogEntry_t& entry);
+        virtual void poll();
 
         virtual void onConfig(JsonVariant json);
         virtual void setConfig(JsonVariant json);
 
         inline static const char* SERVER_CONFIG = "server";
         inline static const char* PORT_CONFIG   = "port";
+        inline static const char* BATCH_CONFIG  = "batch_ms";
+        inline static const char* LEVEL_CONFIG  = "syslog_loglevel";
         inline static const char* SYSLOG_ENABLE = "syslog_enable";
 
         inline static uint16_t MAX_PACKET_SIZE = 256;
+        inline static const uint16_t MAX_DATAGRAM_SIZE = 1024;  // batched lines
+        inline static const uint16_t MAX_BATCH_MS      = 5000;
+        inline static const uint32_t RESOLVE_RETRY_MS  = 30000; // after a failed lookup
 
         inline static uint8_t PRI_EMERGENCY = 0;
         inline static uint8_t PRI_ALERT     = 1;
@@ -175,42 +359,443 @@ public:
         inline static uint8_t FAC_LOCAL0 = 16;
 
     private:
-        void send(uint8_t* pBuffer, int len);
+        void send(const uint8_t* pBuffer, int len);
+        void flushBatch();
+        bool resolve();
         uint8_t getSeverity(LogLevel_t level);
 
-        void getDateTime(String& dt);
+        const char* getTimestamp();
+        const char* getHostname();
+
+        WiFiUDP   _syslogger;   // FIXME: And if this is using ethernet?
+        String    _hostname;
+        String    _app;
+        String    _server;
+        uint16_t  _port;
+
+        IPAddress _serverIP;            // resolved _server
+        bool      _resolved;            // _serverIP is valid
+        bool      _resolveAttempted;    // _resolve_ms is valid
+        uint32_t  _resolve_ms;          // time of last lookup
+
+        uint16_t  _batch_ms;            // batch window, 0 to send each line
+        uint8_t   _batch[MAX_DATAGRAM_SIZE];
+        size_t    _batchLen;
+        uint32_t  _batchStart_ms;       // time first line was batched
+
+        time_t    _timestampSecond;     // second _timestamp was formatted for
+        char      _timestamp[24];       // RFC 5424 TIMESTAMP
+    };
+
+    /*
+     * Grafana Loki logger. Lines are buffered with their time and labels
+     * (device, level, module) and pushed in one HTTP request per batch, when
+     * the batch window has passed or the buffer is nearly full. The server
+     * is resolved once, and again after a config change or failure, and the
+     * connection is kept alive between pushes. The response is read by later
+     * polls, the pushed lines staying buffered until it arrives. Failed
+     * pushes are retried with exponential backoff, lines being dropped while
+     * the buffer is full. Only plain http is supported.
+     */
+    class LokiLogger : public AbstractLogger {
+    public:
+        LokiLogger(Client& client) :
+            _client(client),
+            _device(""),
+            _host(""),
+            _port(80),
+            _path(""),
+            _batch_ms(5000),
+            _count(0),
+            _textLen(0),
+            _batchStart_ms(0),
+            _resolved(false),
+            _resolveAttempted(false),
+            _resolve_ms(0),
+            _sentCount(0),
+            _sent_ms(0),
+            _responseState(RESPONSE_VERSION),
+            _status(0),
+            _headerMatch(0),
+            _backoff_ms(0),
+            _retry_ms(0),
+            _dropped(0),
+            _failures(0) {};
+
+        void setDevice(const char* device) {
+            _device = device;
+        }
+
+        virtual void log(const LogEntry_t& entry);
+        virtual void poll();
+
+        virtual void onConfig(JsonVariant json);
+        virtual void setConfig(JsonVariant json);
+
+        uint32_t getDroppedCount() const;       // lines dropped, buffer full or rejected
+        uint32_t getFailureCount() const;       // failed pushes
+
+        inline static const char* URL_CONFIG   = "loki_url";
+        inline static const char* BATCH_CONFIG = "loki_batch_ms";
+        inline static const char* LEVEL_CONFIG = "loki_loglevel";
+        inline static const char* LOKI_ENABLE  = "loki_enable";
 
-        WiFiUDP  _syslogger;    // FIXME: And if this is using ethernet?
-        String   _hostname;
-        String   _app;
-        String   _server;
+        inline static const uint32_t MIN_BATCH_MS        = 1000;
+        inline static const uint32_t MAX_BATCH_MS        = 60000;
+        inline static const uint32_t MIN_BACKOFF_MS      = 1000;
+        inline static const uint32_t MAX_BACKOFF_MS      = 60000;
+        inline static const size_t   MAX_URL_LEN         = 160;
+        inline static const uint32_t CONNECT_TIMEOUT_MS  = 10;      // bounds the connect and writes, on the loop
+        inline static const uint32_t RESPONSE_TIMEOUT_MS = 2000;
+        inline static const uint32_t RESOLVE_RETRY_MS    = 30000;   // after a failed lookup or connect
+        inline static const uint32_t RESOLVE_TIMEOUT_MS  = 1000;
+
+    private:
+        // Progress through the response status line and headers
+        enum ResponseState_t {
+            RESPONSE_VERSION=0,     // "HTTP/1.1 "
+            RESPONSE_STATUS,        // "204"
+            RESPONSE_HEADERS,       // up to the blank line
+        };
+
+        typedef struct {
+            uint32_t   time_s;              // epoch, 0 if the clock was not set
+            uint16_t   time_ms;
+            LogLevel_t level;
+            uint16_t   offset;              // of module then message in _text
+            uint8_t    moduleLen;
+            uint16_t   messageLen;
+            uint32_t   logged_ms;           // millis, dates lines logged before the clock was set
+        } Entry_t;
+
+        bool parseUrl(const String& url);
+        bool resolve();
+        bool isFlushDue() const;
+        bool connect();
+        void push();
+        bool sendRequest(size_t contentLength, uint64_t boot_ms);
+        void readResponse();
+        void finishPush(int status);
+        void removeSent();
+        size_t writeBody(Print* out, uint8_t count, uint64_t boot_ms);
+
+        Client&  _client;
+        String   _device;
+        String   _host;
         uint16_t _port;
+        String   _path;
+        uint32_t _batch_ms;             // longest a line is buffered
+
+        Entry_t  _entries[LOKI_MAX_ENTRIES];
+        uint8_t  _count;
+        char     _text[LOKI_BUFFER_SIZE];
+        size_t   _textLen;
+        uint32_t _batchStart_ms;        // time first line was buffered
+
+        IPAddress _serverIP;            // resolved _host
+        bool     _resolved;             // _serverIP is valid
+        bool     _resolveAttempted;     // _resolve_ms is valid
+        uint32_t _resolve_ms;           // time of last lookup
+        uint8_t  _sentCount;            // lines pushed, awaiting the response
+        uint32_t _sent_ms;              // time of the push
+        ResponseState_t _responseState;
+        int      _status;               // response status, 0 until read
+        uint8_t  _headerMatch;          // of the "\r\n\r\n" ending the headers
+
+        uint32_t _backoff_ms;           // current backoff, 0 if last push succeeded
+        uint32_t _retry_ms;             // time of last failed push
+        uint32_t _dropped;
+        uint32_t _failures;
     };
 
     LogLevel_t getLevel() const;
     void setLevel(LogLevel_t level);
 
+    // per module levels, module is the log prefix without brackets
+    LogLevel_t getLevel(const char* prefix) const;     // module level, else overall level
+    bool setModuleLevel(const char* module, LogLevel_t level);  // false if table full
+    void clearModuleLevels();
+
+    // incremented whenever any level changes, invalidating cached levels
+    uint32_t getLevelGeneration() const {
+        return _levelGeneration.load(std::memory_order_acquire);
+    }
+
+    // incremented whenever config, a level or the loggers change, as
+    // setConfig() reflects them, invalidating anything built from it
+    uint32_t getConfigGeneration() const { return _configGeneration; }
+
     // OXRS callbacks
     void onConfig(JsonVariant json);
     void setConfig(JsonVariant json);
 
     void setLogLevelCommand(const String& sLogLevel);
+    static bool parseLevel(const char* sLogLevel, LogLevel_t& level);
 
     void addLogger(AbstractLogger* pLogger);    // add logger to the list of loggers to use
 
     void logf(LogLevel_t level, const char* prefix, const char *fmt, ...);
     void log(LogLevel_t level, const char* prefix, const __FlashStringHelper *logEvent);
-    void log(LogLevel_t level, const char* prefix, char* logEvent);
+    void log(LogLevel_t level, const char* prefix, const char* logEvent);
     void log(LogLevel_t level, const char* prefix, String& logEvent);
 
+    /*
+     * Formatted log call from the LOGF_ macros, id is OXRS_LOG_FRAME::id(fmt)
+     * and fmt is null if format strings are left out of the build. Only
+     * expanded with vsnprintf if a logger needs text.
+     */
+    template <typename... Args>
+    void logb(LogLevel_t level, const char* prefix, uint32_t id, const char* fmt, Args... args)
+    {
+        if (level < _floorLevel)
+            return;
+
+        if (!_binary && fmt)
+        {
+            logf(level, prefix, fmt, args...);
+            return;
+        }
+
+        bool text = fmt && _serialText;
+        if (_async)
+        {
+            uint8_t core = getCore();
+            if (!reserve(core))
+                return;
+
+            // frame first, any text for the Serial logger after it
+            LogRecord_t record;
+            initRecord(record, level, prefix);
+            OXRS_LOG_FRAME frame((uint8_t*)record.message, LOG_RECORD_LEN - 1);
+            frame.begin(level, record.timestamp_ms, OXRS_LOG_FRAME::id(prefix), id);
+            frame.add(args...);
+            record.frameLen = frame.end();
+            record.message[record.frameLen] = '\0';
+            if (text)
+                snprintf(record.message + record.frameLen, LOG_RECORD_LEN - record.frameLen, fmt, args...);
+            _rings[core].push(record);
+        }
+        else
+        {
+            OXRS_LOG_FRAME frame(_frame, LOG_FRAME_LEN);
+            frame.begin(level, millis(), OXRS_LOG_FRAME::id(prefix), id);
+            frame.add(args...);
+
+            size_t header = 0, len = 0;
+            if (text)
+            {
+                header = len = formatHeader(level, prefix);
+                int n = snprintf(_line + len, MAX_BUF_LEN - len, fmt, args...);
+                if (n > 0)
+                    len = min(len + n, (size_t)MAX_BUF_LEN - 1);
+            }
+            writeFrame(level, prefix, frame.end(), header, len);
+        }
+    }
+
+    // async logging
+    bool isAsync() const;
+    void setAsync(bool async);                  // drains any queued records when disabled
+    OverflowPolicy_t getOverflowPolicy() const;
+    void setOverflowPolicy(OverflowPolicy_t policy);
+    void pump();                                // drain queued records, call from one core only
+    uint32_t getDroppedCount() const;           // records dropped or overwritten since boot
+
+    // suppression
+    void countRateLimited();                    // called by OXRS_LOG_LIMIT
+    uint32_t getRateLimitedCount() const;       // lines over a call site's rate limit since boot
+    uint32_t getRepeatedCount() const;          // lines collapsed as repeats since boot
+
+    // binary logging
+    bool isBinary() const;
+    void setBinary(bool binary);
+    bool isSerialText() const;
+    void setSerialText(bool serialText);        // Serial logger formats text in binary mode
+
+    // lines retained in RAM across a warm reboot
+    bool hasRetained() const;                   // previous boot left lines
+    size_t replayRetained();                    // write them to all loggers
+    size_t printRetained(Print& out) const;     // one per line, frames as "#<hex>"
+
     static JsonVariant findNestedKey(JsonObject obj, const String &key);
 
+    static uint8_t getCore();                   // of the caller, indexes per core state
+
 private:
     OXRS_LOG();                             // singleton
 
+    typedef struct {
+        uint32_t    timestamp_ms;           // millis() when logged
+        LogLevel_t  level;
+        const char* prefix;                 // static string
+        uint8_t     frameLen;               // binary frame at the start of message, 0 if text
+        char        message[LOG_RECORD_LEN];
+    } LogRecord_t;
+
+    void write(LogLevel_t level, const char* prefix, const char* logEvent, uint32_t timestamp_ms);
+    void writeText(LogLevel_t level, const char* prefix, size_t header, size_t len, uint32_t timestamp_ms);
+    void writeRecord(const LogRecord_t& record);
+    void writeFrame(LogLevel_t level, const char* prefix, size_t frameLen, size_t header, size_t lineLen);
+    size_t formatHeader(LogLevel_t level, const char* prefix);
+    void writeLine(LogLevel_t level, const char* prefix, size_t header, size_t len);
+    void dispatch(const LogEntry_t& entry);
+    bool isRepeat(LogLevel_t level, const char* prefix, uint32_t hash);
+    void flushRepeats(bool force);
+    void levelsChanged();
+    bool reserve(uint8_t core);
+    void initRecord(LogRecord_t& record, LogLevel_t level, const char* prefix);
+
     LogLevel_t   _currentLevel;             // current logging level of LogLevel_t
+    LogLevel_t   _floorLevel;               // lowest of overall and module levels
+
+    typedef struct {
+        char       name[LOG_MODULE_LEN];    // prefix without brackets
+        LogLevel_t level;
+    } ModuleLevel_t;
+
+    ModuleLevel_t _modules[LOG_MODULES];
+    uint8_t       _moduleCount;
+    std::atomic<uint32_t> _levelGeneration;
+    uint32_t      _configGeneration;
     SerialLogger _serial;                   // default Serial logger
-    std::list<AbstractLogger*> _loggers;    // list of all loggers to log to
+    AbstractLogger* _loggers[LOG_MAX_LOGGERS];  // all loggers to log to
+    uint8_t      _loggerCount;
+    char         _line[MAX_BUF_LEN];        // shared buffer lines are formatted into
+    uint8_t      _frame[LOG_FRAME_LEN];     // shared buffer frames are encoded into
+    OXRS_LOG_RETAINED _retained;            // last lines written, kept over a reboot
+
+    bool         _binary;                   // send loggers frames rather than text
+    bool         _serialText;               // except the Serial logger
+
+    bool             _async;                // queue records for pump() rather than write
+    OverflowPolicy_t _overflowPolicy;       // async behaviour when a ring is full
+    OXRS_RING<LogRecord_t, LOG_RING_SIZE> _rings[LOG_CORES];  // async records, per producing core
+    std::atomic<uint32_t> _dropped[LOG_CORES];  // records discarded, owned by producing core
+    std::atomic<uint32_t> _lost;            // records overwritten before pumped, owned by pump
+    volatile bool    _pumping;              // pump() in progress
+    volatile uint8_t _pumpCore;             // core last running pump()
+
+    std::atomic<uint32_t> _rateLimited[LOG_CORES];  // owned by counting core
+    uint32_t    _repeated;                  // lines collapsed as repeats
+    uint32_t    _repeatHash;                // hash of the last line written
+    LogLevel_t  _repeatLevel;
+    const char* _repeatPrefix;
+    uint32_t    _repeatCount;               // repeats not yet summarised
+    uint32_t    _repeatSince_ms;            // time of the first of them
 };
 
 extern OXRS_LOG &oxrsLog;
+
+/*
+ * Level of the including translation unit, resolved from its _LOG_PREFIX on
+ * first use and again only after levels change, so the log macros can filter
+ * with one compare before any arguments are evaluated. Level and generation
+ * are packed in one word so either core may refresh it without a lock.
+ */
+class OXRS_LOG_MODULE {
+public:
+    bool isEnabled(OXRS_LOG::LogLevel_t level, const char* prefix)
+    {
+        uint32_t generation = oxrsLog.getLevelGeneration();
+        uint32_t cached = _cached.load(std::memory_order_relaxed);
+        if ((cached >> 8) != (generation & 0xffffff))
+        {
+            cached = generation << 8 | oxrsLog.getLevel(prefix);
+            _cached.store(cached, std::memory_order_relaxed);
+        }
+        return level >= (OXRS_LOG::LogLevel_t)(cached & 0xff);
+    }
+
+private:
+    std::atomic<uint32_t> _cached{0};       // generation << 8 | level
+};
+
+[[maybe_unused]] static OXRS_LOG_MODULE _logModule;
+
+/*
+ * Token buckets for one log call site, declared by the log macros, one per
+ * core so neither core contends for or starves the other. Lines over the
+ * limit are dropped before their arguments are evaluated.
+ */
+class OXRS_LOG_LIMIT {
+public:
+    bool allow()
+    {
+        return _buckets[OXRS_LOG::getCore()].allow(millis());
+    }
+
+    // credit is kept in ms, each line costs a period
+    class Bucket {
+    public:
+        bool allow(uint32_t now)
+        {
+            uint32_t elapsed = now - _last_ms;
+            _last_ms = now;
+            _credit = elapsed >= MAX_CREDIT - _credit ? MAX_CREDIT : _credit + elapsed;
+
+            if (_credit < LOG_LIMIT_PERIOD_MS)
+            {
+                oxrsLog.countRateLimited();
+                return false;
+            }
+            _credit -= LOG_LIMIT_PERIOD_MS;
+            return true;
+        }
+
+        uint32_t lastUsed() const
+        {
+            return _last_ms;
+        }
+
+    private:
+        inline static const uint32_t MAX_CREDIT = (uint32_t)LOG_LIMIT_BURST * LOG_LIMIT_PERIOD_MS;
+
+        uint32_t _credit = MAX_CREDIT;
+        uint32_t _last_ms = 0;
+    };
+
+private:
+    Bucket _buckets[LOG_CORES];
+};
+
+/*
+ * Token buckets for a call site that logs on behalf of many sources (e.g.
+ * one error reporter for every sensor command), one per key so a flood from
+ * one key cannot silence the others. Each core tracks up to N keys, the least
+ * recently used key's bucket is taken over by a new one.
+ */
+template <size_t N>
+class OXRS_LOG_KEYED_LIMIT {
+public:
+    bool allow(uintptr_t key)
+    {
+        Slot_t* slots = _slots[OXRS_LOG::getCore()];
+        uint32_t now = millis();
+
+        Slot_t* lru = &slots[0];
+        for (size_t i = 0; i < N; i++)
+        {
+            if (slots[i].used && slots[i].key == key)
+                return slots[i].bucket.allow(now);
+
+            if (!slots[i].used)
+                lru = &slots[i];
+            else if (lru->used && now - slots[i].bucket.lastUsed() > now - lru->bucket.lastUsed())
+                lru = &slots[i];
+        }
+
+        *lru = Slot_t();
+        lru->used = true;
+        lru->key = key;
+        return lru->bucket.allow(now);
+    }
+
+private:
+    typedef struct {
+        uintptr_t              key = 0;
+        bool                   used = false;
+        OXRS_LOG_LIMIT::Bucket bucket;
+    } Slot_t;
+
+    Slot_t _slots[LOG_CORES][N];
+};
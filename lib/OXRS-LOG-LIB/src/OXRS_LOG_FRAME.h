@@ -0,0 +1,242 @@
+/**
+ * OXRS-LOG
+ *
+ * Compact binary encoding of a log call, so a format string never has to be
+ * expanded (or even stored) on the device. A frame carries ids of the prefix
+ * and format string plus the raw arguments; tools/log_decode.py rebuilds the
+ * text using the string table tools/log_strings.py extracts from the sources.
+ *
+ * Frame layout, little endian:
+ *   u8     MAGIC
+ *   u8     level, LEVEL_TRUNCATED set if arguments did not fit
+ *   varint timestamp (ms since boot)
+ *   u32    prefix id
+ *   u32    format id, 0 for a plain message sent as one string argument
+ *   arguments in call order
+ *      integers      zigzag varint
+ *      floating      float32
+ *      strings       u8 length, bytes (truncated to 255), F() strings too
+ *
+ * Depends only on the C++ standard library so it can be used on a host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+class __FlashStringHelper;
+
+class OXRS_LOG_FRAME
+{
+public:
+    inline static const uint8_t MAGIC           = 0xB1;
+    inline static const uint8_t LEVEL_TRUNCATED = 0x80;
+    inline static const size_t  MAX_HEADER_LEN  = 2 + 5 + 4 + 4;
+
+    /*
+     * FNV-1a hash of s, skipping printf length modifiers (h l j z t L) so the
+     * id does not depend on how a platform defines PRIu32 and friends
+     */
+    static constexpr uint32_t id(const char* s)
+    {
+        uint32_t hash = 2166136261u;
+        bool spec = false;
+        for (; *s; s++)
+        {
+            char c = *s;
+            if (spec)
+            {
+                if (c == 'h' || c == 'l' || c == 'j' || c == 'z' || c == 't' || c == 'L')
+                    continue;
+                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '%')
+                    spec = false;
+            }
+            else if (c == '%')
+            {
+                spec = true;
+            }
+            hash = (hash ^ (uint8_t)c) * 16777619u;
+        }
+        return hash;
+    }
+
+    // FNV-1a of n bytes, continuing from seed
+    static uint32_t hash(const void* p, size_t n, uint32_t seed = 2166136261u)
+    {
+        const uint8_t* b = (const uint8_t*)p;
+        while (n--)
+            seed = (seed ^ *b++) * 16777619u;
+        return seed;
+    }
+
+    // Hash of a frame ignoring its timestamp, to spot repeated lines
+    static uint32_t contentHash(const uint8_t* frame, size_t len)
+    {
+        if (len < 2)
+            return hash(frame, len);
+
+        size_t i = 2;
+        while (i < len && (frame[i] & 0x80))
+            i++;
+        i = i < len ? i + 1 : len;
+        return hash(frame + i, len - i, hash(frame, 2));
+    }
+
+    OXRS_LOG_FRAME(uint8_t* buffer, size_t size) :
+        _buffer(buffer), _size(size), _len(0), _truncated(false) {};
+
+    void begin(uint8_t level, uint32_t timestamp_ms, uint32_t prefixId, uint32_t formatId)
+    {
+        _len = 0;
+        _truncated = false;
+        putByte(MAGIC);
+        putByte(level);
+        putVarint(timestamp_ms);
+        putU32(prefixId);
+        putU32(formatId);
+    }
+
+    template <typename... Args>
+    void add(Args... args)
+    {
+        (addArg(args), ...);
+    }
+
+    // Frame length, marking the frame truncated if any argument did not fit
+    size_t end()
+    {
+        if (_truncated && _len > 1)
+            _buffer[1] |= LEVEL_TRUNCATED;
+        return _len;
+    }
+
+private:
+    template <typename T>
+    void addArg(T value)
+    {
+        if constexpr (std::is_floating_point<T>::value)
+            putFloat((float)value);
+        else if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value)
+            putString(value);
+        else if constexpr (std::is_same<T, const __FlashStringHelper*>::value)
+            putString((const char*)value);
+        else if constexpr (std::is_pointer<T>::value)
+            putUnsigned((uintptr_t)value);
+        else if constexpr (std::is_enum<T>::value)
+            addArg((typename std::underlying_type<T>::type)value);
+        else if constexpr (std::is_signed<T>::value)
+            putSigned((int64_t)value);
+        else
+            putUnsigned((uint64_t)value);
+    }
+
+    // all arguments are whole, a partial argument would misalign the decoder
+    bool reserve(size_t n)
+    {
+        if (_truncated || _len + n > _size)
+        {
+            _truncated = true;
+            return false;
+        }
+        return true;
+    }
+
+    void putByte(uint8_t b)
+    {
+        if (reserve(1))
+            _buffer[_len++] = b;
+    }
+
+    void putU32(uint32_t v)
+    {
+        if (!reserve(4))
+            return;
+        for (uint8_t i = 0; i < 4; i++, v >>= 8)
+            _buffer[_len++] = (uint8_t)v;
+    }
+
+    // 32 bit arithmetic where possible, the M0+ has no 64 bit shifts
+    void putVarint(uint32_t v)
+    {
+        uint8_t tmp[5];
+        size_t n = 0;
+        for (; v >= 0x80; v >>= 7)
+            tmp[n++] = (uint8_t)v | 0x80;
+        tmp[n++] = (uint8_t)v;
+        putBytes(tmp, n);
+    }
+
+    void putVarint64(uint64_t v)
+    {
+        if (v <= 0xffffffff)
+        {
+            putVarint((uint32_t)v);
+            return;
+        }
+        uint8_t tmp[10];
+        size_t n = 0;
+        for (; v >= 0x80; v >>= 7)
+            tmp[n++] = (uint8_t)v | 0x80;
+        tmp[n++] = (uint8_t)v;
+        putBytes(tmp, n);
+    }
+
+    void putSigned(int64_t v)
+    {
+        if (v >= INT32_MIN && v <= INT32_MAX)
+        {
+            int32_t v32 = (int32_t)v;
+            putVarint(((uint32_t)v32 << 1) ^ (uint32_t)(v32 >> 31));
+        }
+        else
+            putVarint64(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+
+    void putUnsigned(uint64_t v)
+    {
+        if (v <= INT32_MAX)
+            putVarint((uint32_t)v << 1);
+        else
+            putVarint64(v << 1);
+    }
+
+    void putFloat(float f)
+    {
+        uint32_t v;
+        memcpy(&v, &f, sizeof(v));
+        putU32(v);
+    }
+
+    void putString(const char* s)
+    {
+        if (!s)
+            s = "(null)";
+
+        // at most 255 bytes, scanned rather than strnlen(s, 255), which GCC
+        // flags once inlined with a shorter string
+        size_t n = 0;
+        while (n < 255 && s[n])
+            n++;
+        if (!reserve(1 + n))
+            return;
+        _buffer[_len++] = (uint8_t)n;
+        memcpy(_buffer + _len, s, n);
+        _len += n;
+    }
+
+    void putBytes(const uint8_t* p, size_t n)
+    {
+        if (!reserve(n))
+            return;
+        memcpy(_buffer + _len, p, n);
+        _len += n;
+    }
+
+    uint8_t* _buffer;
+    size_t   _size;
+    size_t   _len;
+    bool     _truncated;
+};
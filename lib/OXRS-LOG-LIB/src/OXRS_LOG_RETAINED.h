@@ -0,0 +1,165 @@
+/**
+ * OXRS-LOG
+ *
+ * Mirror of the most recent log records in RAM that survives a warm reboot
+ * (watchdog, hang or software reset), so the lines leading up to it can be
+ * recovered at the next boot.
+ *
+ * The caller provides two regions placed in RAM that is not zeroed at boot.
+ * Each boot writes to one while the other keeps the previous boot's records
+ * untouched, so they can be read at any time after boot. Every record has
+ * its own checksum, so a record torn by the reboot or RAM that was never
+ * written (power on) is simply skipped.
+ *
+ * Depends only on the C++ standard library so it can be tested on a host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef LOG_RETAINED_RECORDS
+#define LOG_RETAINED_RECORDS 32     // records kept per boot, 128 bytes each
+#endif
+
+class OXRS_LOG_RETAINED
+{
+public:
+    inline static const size_t   TEXT_LEN     = 114;
+    inline static const uint32_t REGION_MAGIC = 0x4F4C5231;     // "OLR1"
+
+    typedef struct {
+        uint32_t seq;                   // record number, from 1
+        uint32_t timestamp_ms;          // millis() when written
+        uint8_t  level;
+        uint8_t  binary;                // text is an OXRS_LOG_FRAME
+        uint8_t  len;
+        uint8_t  reserved;
+        uint16_t checksum;
+        char     text[TEXT_LEN];
+    } Record_t;
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t boot;                  // boot number, increments each boot
+        uint32_t check;                 // ~(magic ^ boot)
+        Record_t records[LOG_RETAINED_RECORDS];
+    } Region_t;
+
+    // Pick the region to write, keeping the other if it holds the last boot
+    OXRS_LOG_RETAINED(Region_t regions[2]) :
+        _current(&regions[0]), _previous(nullptr), _seq(0)
+    {
+        bool valid0 = isValid(regions[0]);
+        bool valid1 = isValid(regions[1]);
+
+        if (valid0 && (!valid1 || regions[0].boot - regions[1].boot < 0x80000000))
+            _previous = &regions[0];
+        else if (valid1)
+            _previous = &regions[1];
+
+        _current = _previous == &regions[0] ? &regions[1] : &regions[0];
+        uint32_t boot = _previous ? _previous->boot + 1 : 1;
+
+        // invalidate the header while the records are cleared
+        _current->magic = 0;
+        memset(_current->records, 0, sizeof(_current->records));
+        _current->boot  = boot;
+        _current->check = ~(REGION_MAGIC ^ boot);
+        _current->magic = REGION_MAGIC;
+    }
+
+    // Copy a line (or frame), truncated to TEXT_LEN, over the oldest record
+    void write(uint8_t level, uint32_t timestamp_ms, bool binary, const void* data, size_t len)
+    {
+        if (len > TEXT_LEN)
+            len = TEXT_LEN;
+
+        Record_t& record = _current->records[_seq % LOG_RETAINED_RECORDS];
+        record.seq          = ++_seq;
+        record.timestamp_ms = timestamp_ms;
+        record.level        = level;
+        record.binary       = binary;
+        record.len          = (uint8_t)len;
+        record.reserved     = 0;
+        memcpy(record.text, data, len);
+        record.checksum     = checksum(record);
+    }
+
+    // Records retained from the previous boot
+    bool hasPrevious() const
+    {
+        return _previous != nullptr;
+    }
+
+    uint32_t getBoot() const
+    {
+        return _current->boot;
+    }
+
+    // Call f(const Record_t&) for each valid record of the previous boot, oldest first
+    template <typename F>
+    size_t forEachPrevious(F f) const
+    {
+        if (!_previous)
+            return 0;
+
+        uint32_t last = 0;
+        for (size_t i = 0; i < LOG_RETAINED_RECORDS; i++)
+        {
+            const Record_t& record = _previous->records[i];
+            if (record.seq > last && isValid(record))
+                last = record.seq;
+        }
+
+        size_t count = 0;
+        uint32_t first = last > LOG_RETAINED_RECORDS ? last - LOG_RETAINED_RECORDS + 1 : 1;
+        for (uint32_t seq = first; last && seq <= last; seq++)
+        {
+            const Record_t& record = _previous->records[(seq - 1) % LOG_RETAINED_RECORDS];
+            if (record.seq == seq && isValid(record))
+            {
+                f(record);
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+    static bool isValid(const Region_t& region)
+    {
+        return region.magic == REGION_MAGIC && region.check == ~(REGION_MAGIC ^ region.boot);
+    }
+
+    static bool isValid(const Record_t& record)
+    {
+        return record.seq && record.len <= TEXT_LEN && record.checksum == checksum(record);
+    }
+
+    // Fletcher style sums over the record up to its checksum, then the text;
+    // reduced once at the end, the M0+ has no divide instruction
+    static uint16_t checksum(const Record_t& record)
+    {
+        uint32_t sum1 = 0, sum2 = 0;
+        const uint8_t* p = (const uint8_t*)&record;
+        for (size_t i = 0; i < offsetof(Record_t, checksum); i++)
+        {
+            sum1 += p[i];
+            sum2 += sum1;
+        }
+        p = (const uint8_t*)record.text;
+        for (size_t i = 0; i < record.len; i++)
+        {
+            sum1 += p[i];
+            sum2 += sum1;
+        }
+        return (uint16_t)(sum1 ^ (sum2 << 8) ^ (sum2 >> 8));
+    }
+
+    Region_t* _current;                 // written this boot
+    Region_t* _previous;                // last boot, null if none
+    uint32_t  _seq;                     // records written this boot
+};
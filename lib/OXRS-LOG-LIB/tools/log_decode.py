@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Decode OXRS_LOG binary log frames to text, using the table from log_strings.py.
+
+    log_decode.py -t log_strings.json [--udp PORT]
+
+With --udp, listens for frames sent by the syslog logger. Otherwise reads
+lines from stdin, decoding any that end in a hex frame (the serial logger's
+"#<hex>" lines, or `mosquitto_sub -t <log topic> -F %x`) and passing other
+lines through, e.g.
+
+    mosquitto_sub -t 'log/#' -F %x | log_decode.py -t .pio/build/pico/log_strings.json
+"""
+
+import argparse
+import json
+import re
+import socket
+import struct
+import sys
+
+MAGIC = 0xB1
+LEVEL_TRUNCATED = 0x80
+LEVELS = [" ", "[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] ", "[FATAL] ", " "]
+
+SPEC = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?([diouxXeEfFgGaAcsp%])")
+HEX_LINE = re.compile(r"(?:^|#)((?:[bB]1)(?:[0-9a-fA-F]{2})+)\s*$")
+
+
+class Truncated(Exception):
+    pass
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise Truncated()
+        b = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return b
+
+    def varint(self):
+        v = shift = 0
+        while True:
+            b = self.take(1)[0]
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return v
+
+    def integer(self):
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+    def u32(self):
+        return struct.unpack("<I", self.take(4))[0]
+
+    def float(self):
+        return struct.unpack("<f", self.take(4))[0]
+
+    def string(self):
+        return self.take(self.take(1)[0]).decode("utf-8", errors="replace")
+
+
+def expand(fmt, r):
+    """Format fmt reading arguments from r, as printf would"""
+    out = []
+    pos = 0
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(r.integer())
+        if precision == "*":
+            precision = str(r.integer())
+        spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+
+        if conv in "eEfFgGaA":
+            v = r.float()
+            out.append(v.hex() if conv in "aA" else (spec + conv) % v)
+        elif conv == "s":
+            out.append((spec + "s") % r.string())
+        elif conv == "c":
+            out.append((spec + "s") % chr(r.integer() & 0xFF))
+        elif conv == "p":
+            out.append("0x%x" % r.integer())
+        else:
+            out.append((spec + conv.replace("u", "d")) % r.integer())
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode(frame, table):
+    r = Reader(frame)
+    if r.take(1)[0] != MAGIC:
+        return None
+    level = r.take(1)[0]
+    timestamp_ms = r.varint()
+    prefix_id = r.u32()
+    format_id = r.u32()
+
+    prefix = table["prefixes"].get("0x%08x" % prefix_id, "[0x%08x] " % prefix_id)
+    header = "%10.3f %s%s" % (timestamp_ms / 1000.0, prefix, LEVELS[min(level & 0x7F, 6)])
+
+    try:
+        if format_id == 0:
+            message = r.string()
+        elif "0x%08x" % format_id in table["formats"]:
+            message = expand(table["formats"]["0x%08x" % format_id], r)
+        else:
+            message = "<unknown format 0x%08x> %s" % (format_id, frame[r.pos:].hex())
+    except Truncated:
+        message = "<bad frame> %s" % frame.hex()
+
+    if level & LEVEL_TRUNCATED:
+        message += " [truncated]"
+    return header + message
+
+
+def decode_lines(stream, table):
+    for line in stream:
+        line = line.rstrip("\r\n")
+        m = HEX_LINE.search(line)
+        text = None
+        if m:
+            try:
+                text = decode(bytes.fromhex(m.group(1)), table)
+            except Truncated:
+                text = None
+        print(text if text is not None else line, flush=True)
+
+
+def decode_udp(port, table):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", port))
+    while True:
+        frame, _ = sock.recvfrom(2048)
+        try:
+            text = decode(frame, table)
+        except Truncated:
+            text = None
+        print(text if text is not None else frame.decode("utf-8", errors="replace"), flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode OXRS_LOG binary log frames")
+    parser.add_argument("-t", "--table", required=True, help="log_strings.json from log_strings.py")
+    parser.add_argument("--udp", type=int, help="listen for frames on this UDP port")
+    args = parser.parse_args()
+
+    with open(args.table, encoding="utf-8") as f:
+        table = json.load(f)
+
+    try:
+        if args.udp:
+            decode_udp(args.udp, table)
+        else:
+            decode_lines(sys.stdin, table)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+Build the OXRS_LOG binary logging string table.
+
+Scans sources for LOGF_* format strings and _LOG_PREFIX definitions and
+writes a JSON table of OXRS_LOG_FRAME ids to strings for log_decode.py.
+
+    log_strings.py [-o log_strings.json] [source dirs...]
+
+Also runs as a PlatformIO extra_script (extra_scripts = pre:...), writing
+log_strings.json into the build directory of builds with OXRS_LOG_BINARY or
+OXRS_LOG_BINARY_ONLY defined, and doing nothing otherwise.
+"""
+
+import json
+import os
+import re
+import sys
+
+LENGTH_MODIFIERS = "hljztL"
+BINARY_DEFINES = ("OXRS_LOG_BINARY", "OXRS_LOG_BINARY_ONLY")
+SOURCE_EXTENSIONS = (".c", ".cpp", ".h", ".hpp", ".ino")
+
+LOGF_CALL = re.compile(r"\bLOGF_(?:DEBUG|INFO|WARN|ERROR|FATAL)\s*\(")
+PREFIX_DEF = re.compile(r"\b_LOG_PREFIX\s*=\s*((?:\"(?:[^\"\\]|\\.)*\"\s*)+);")
+STRING_LITERAL = re.compile(r"\"((?:[^\"\\]|\\.)*)\"")
+PRI_MACRO = re.compile(r"\bPRI([diouxX])(?:8|16|32|64|PTR|MAX|LEAST\d+|FAST\d+)\b")
+ESCAPE = re.compile(r"\\(x[0-9a-fA-F]+|[0-7]{1,3}|.)")
+
+SIMPLE_ESCAPES = {
+    "n": "\n", "t": "\t", "r": "\r", "0": "\0", "a": "\a", "b": "\b",
+    "f": "\f", "v": "\v", "\\": "\\", "'": "'", "\"": "\"", "?": "?",
+}
+
+
+def frame_id(s):
+    """OXRS_LOG_FRAME::id, FNV-1a skipping printf length modifiers"""
+    h = 2166136261
+    spec = False
+    for b in s.encode("utf-8"):
+        c = chr(b)
+        if spec:
+            if c in LENGTH_MODIFIERS:
+                continue
+            if c.isalpha() or c == "%":
+                spec = False
+        elif c == "%":
+            spec = True
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def normalise(fmt):
+    """Drop length modifiers, matching what frame_id hashes"""
+    out = []
+    spec = False
+    for c in fmt:
+        if spec:
+            if c in LENGTH_MODIFIERS:
+                continue
+            if c.isalpha() or c == "%":
+                spec = False
+        elif c == "%":
+            spec = True
+        out.append(c)
+    return "".join(out)
+
+
+def unescape(literal):
+    def replace(m):
+        e = m.group(1)
+        if e[0] == "x":
+            return chr(int(e[1:], 16))
+        if e[0] in "01234567":
+            return chr(int(e, 8))
+        return SIMPLE_ESCAPES.get(e, e)
+    return ESCAPE.sub(replace, literal)
+
+
+def parse_literals(text, pos):
+    """Concatenate adjacent string literals and PRI macros from pos, None if
+    the first argument is not made of them alone"""
+    parts = []
+    while True:
+        while pos < len(text) and text[pos].isspace():
+            pos += 1
+        m = STRING_LITERAL.match(text, pos)
+        if m:
+            parts.append(unescape(m.group(1)))
+            pos = m.end()
+            continue
+        m = PRI_MACRO.match(text, pos)
+        if m:
+            parts.append(m.group(1))
+            pos = m.end()
+            continue
+        break
+    if not parts or pos >= len(text) or text[pos] not in ",)":
+        return None
+    return "".join(parts)
+
+
+def scan(dirs):
+    formats = {}
+    prefixes = {}
+    for root in dirs:
+        for dirpath, _, files in os.walk(root):
+            for name in files:
+                if not name.endswith(SOURCE_EXTENSIONS):
+                    continue
+                with open(os.path.join(dirpath, name), encoding="utf-8", errors="replace") as f:
+                    text = f.read()
+                for m in LOGF_CALL.finditer(text):
+                    fmt = parse_literals(text, m.end())
+                    if fmt is not None:
+                        formats["0x%08x" % frame_id(fmt)] = normalise(fmt)
+                for m in PREFIX_DEF.finditer(text):
+                    prefix = "".join(unescape(s) for s in STRING_LITERAL.findall(m.group(1)))
+                    prefixes["0x%08x" % frame_id(prefix)] = prefix
+    return {"formats": formats, "prefixes": prefixes}
+
+
+def write_table(table, path):
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump(table, f, indent=2, sort_keys=True)
+
+
+def is_binary_build(env):
+    """True if a binary logging define is set, CPPDEFINES entries are names
+    or (name, value) tuples, build_flags may not have been merged in yet"""
+    defines = list(env.get("CPPDEFINES", []))
+    defines += env.ParseFlags(env.get("BUILD_FLAGS", [])).get("CPPDEFINES", [])
+    for define in defines:
+        name = define[0] if isinstance(define, (tuple, list)) else define
+        if name in BINARY_DEFINES:
+            return True
+    return False
+
+
+def main(argv):
+    out = "log_strings.json"
+    if len(argv) > 1 and argv[0] == "-o":
+        out = argv[1]
+        argv = argv[2:]
+    table = scan(argv or ["src", "lib"])
+    write_table(table, out)
+    print("%s: %d formats, %d prefixes" % (out, len(table["formats"]), len(table["prefixes"])))
+
+
+try:
+    Import("env")  # noqa: F821, defined when run by PlatformIO
+except NameError:
+    env = None
+
+if env is not None:
+    if is_binary_build(env):
+        project = env.subst("$PROJECT_DIR")
+        build = env.subst("$BUILD_DIR")
+        os.makedirs(build, exist_ok=True)
+        write_table(scan([os.path.join(project, "src"), os.path.join(project, "lib")]),
+                    os.path.join(build, "log_strings.json"))
+elif __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,118 @@
+#include <OXRS_LOG.h>
+#include <AdoptCache.h>
+
+static const char *_LOG_PREFIX = "[AdoptCache] ";
+
+AdoptCache::AdoptCache() :
+    _partCount(0),
+    _buffer(nullptr),
+    _size(0),
+    _generation(1),
+    _builtGeneration(0),
+    _builtLogGeneration(0),
+    _cached(false),
+    _builds(0)
+{
+};
+
+bool AdoptCache::addPart(const char* key, adoptPart part)
+{
+    if (_partCount == MAX_PARTS)
+        return false;
+
+    _keys[_partCount]  = key;
+    _parts[_partCount] = part;
+    _partCount++;
+    invalidate();
+    return true;
+}
+
+void AdoptCache::invalidate()
+{
+    _generation++;
+}
+
+bool AdoptCache::isValid() const
+{
+    return _cached && isBuilt();
+}
+
+bool AdoptCache::refresh(size_t docSize)
+{
+    if (isBuilt())
+        return _cached;
+
+    // taken first, so a change while building leaves the cache stale
+    _builtGeneration    = _generation;
+    _builtLogGeneration = oxrsLog.getConfigGeneration();
+
+    uint32_t start = millis();
+    DynamicJsonDocument json(docSize);
+    for (uint8_t i = 0; i < _partCount; i++)
+        _parts[i](json.as<JsonVariant>());
+
+    // an overflowed document would cache truncated schemas, keep building in full
+    if (json.overflowed())
+    {
+        LOG_ERROR(F("Adopt payload too large to cache"));
+        clear();
+        return false;
+    }
+
+    size_t size = 1;
+    for (uint8_t i = 0; i < _partCount; i++)
+    {
+        _len[i] = measureJson(json[_keys[i]]);
+        size += _len[i];
+    }
+
+    delete[] _buffer;
+    _buffer = new char[size];
+
+    size_t offset = 0;
+    for (uint8_t i = 0; i < _partCount; i++)
+    {
+        _offset[i] = offset;
+        offset += serializeJson(json[_keys[i]], _buffer + offset, size - offset);
+    }
+
+    _size = offset;
+    _cached = true;
+    _builds++;
+    LOGF_DEBUG("Adopt cache %u bytes built in %lu ms", (unsigned)_size, (unsigned long)(millis() - start));
+    return true;
+}
+
+bool AdoptCache::splice(JsonVariant json) const
+{
+    if (!isValid())
+        return false;
+
+    // linked, not copied, into the document
+    for (uint8_t i = 0; i < _partCount; i++)
+        json[_keys[i]] = serialized((const char*)_buffer + _offset[i], _len[i]);
+    return true;
+}
+
+size_t AdoptCache::getSize() const
+{
+    return _size;
+}
+
+uint32_t AdoptCache::getBuildCount() const
+{
+    return _builds;
+}
+
+void AdoptCache::clear()
+{
+    delete[] _buffer;
+    _buffer = nullptr;
+    _size = 0;
+    _cached = false;
+}
+
+bool AdoptCache::isBuilt() const
+{
+    return _builtGeneration == _generation && _builtLogGeneration == oxrsLog.getConfigGeneration();
+}
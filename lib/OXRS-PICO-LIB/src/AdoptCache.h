@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Adds one part of the adopt payload, as a nested object under its key
+typedef void (*adoptPart)(JsonVariant json);
+
+/*
+ * Parts of the adopt payload that only change with a schema or config,
+ * serialised once into a buffer sized to fit and linked, not copied, into
+ * each adopt document as raw json. The cache is stale once invalidate() is
+ * called, by a schema setter or a config received, or the log config
+ * generation moves on, as a level, logger or log config change alters the
+ * config schema defaults. A stale cache is rebuilt by refresh(), until then
+ * splice() fails and the caller builds the payload in full.
+ */
+class AdoptCache
+{
+public:
+    AdoptCache();
+
+    inline static const uint8_t MAX_PARTS = 4;
+
+    // Register a part, built under key on refresh(), false if full
+    bool addPart(const char* key, adoptPart part);
+
+    void invalidate();
+    bool isValid() const;
+
+    // Rebuild a stale cache in a document of docSize, false if it does not
+    // fit, which is not retried until the next change
+    bool refresh(size_t docSize);
+
+    // Link the cached parts into json, false if stale
+    bool splice(JsonVariant json) const;
+
+    size_t getSize() const;                 // bytes cached, 0 if none
+    uint32_t getBuildCount() const;
+
+private:
+    void clear();
+    bool isBuilt() const;
+
+    const char* _keys[MAX_PARTS];
+    adoptPart   _parts[MAX_PARTS];
+    uint8_t     _partCount;
+
+    char*       _buffer;
+    size_t      _offset[MAX_PARTS];
+    size_t      _len[MAX_PARTS];
+    size_t      _size;
+
+    uint32_t    _generation;                // bumped by invalidate()
+    uint32_t    _builtGeneration;           // generation last built, cached or not
+    uint32_t    _builtLogGeneration;        // log config generation last built
+    bool        _cached;                    // last build fitted
+    uint32_t    _builds;
+};
@@ -0,0 +1,513 @@
+#include <OXRS_LOG.h>
+#include <ApiConnections.h>
+
+static const char *_LOG_PREFIX = "[ApiConnections] ";
+
+/*
+ * Rewrites the handler's response as it is written: the head is buffered
+ * to replace its Connection header, then the body passes through, or is
+ * sent in chunks if it has no length and the connection is kept alive. A
+ * head too long to buffer is sent as it is and the connection closed.
+ */
+class ResponseWriter
+{
+public:
+    ResponseWriter(WiFiClient& client, char* buffer, size_t size, bool keepAlive, bool bodyless) :
+        _client(client), _buffer(buffer), _size(size), _len(0),
+        _keepAlive(keepAlive), _bodyless(bodyless), _state(HEAD) {};
+
+    size_t write(const uint8_t* data, size_t size)
+    {
+        size_t written = size;
+        while (size)
+        {
+            size_t n;
+            switch (_state)
+            {
+            case HEAD:
+                n = bufferHead(data, size);
+                break;
+            case CHUNKED:
+                n = min(size, _size - _len);
+                memcpy(_buffer + _len, data, n);
+                _len += n;
+                if (_len == _size)
+                    writeChunk();
+                break;
+            default:
+                n = size;
+                _client.write(data, size);
+                break;
+            }
+            data += n;
+            size -= n;
+        }
+        return written;
+    }
+
+    // Complete the response, true if the connection can be kept alive
+    bool finish()
+    {
+        switch (_state)
+        {
+        case HEAD:
+            _client.write((const uint8_t*)_buffer, _len);
+            return false;
+        case CHUNKED:
+            writeChunk();
+            _client.write((const uint8_t*)"0\r\n\r\n", 5);
+            break;
+        default:
+            break;
+        }
+        return _keepAlive;
+    }
+
+private:
+    enum State_t { HEAD, BODY, CHUNKED };
+
+    // Buffer the head, returns the bytes of data used, which stop at its end
+    size_t bufferHead(const uint8_t* data, size_t size)
+    {
+        size_t n = min(size, _size - _len);
+        size_t from = _len > 3 ? _len - 3 : 0;
+        memcpy(_buffer + _len, data, n);
+        _len += n;
+
+        for (size_t i = from; i + 4 <= _len; i++)
+        {
+            if (memcmp(_buffer + i, "\r\n\r\n", 4) == 0)
+            {
+                size_t used = n - (_len - (i + 4));
+                writeHead(i + 2);
+                return used;
+            }
+        }
+
+        if (_len == _size)
+        {
+            _client.write((const uint8_t*)_buffer, _len);
+            _len = 0;
+            _keepAlive = false;
+            _state = BODY;
+        }
+        return n;
+    }
+
+    // Write the head, its header lines ending at end, with the Connection
+    // header replaced and chunked encoding added if needed
+    void writeHead(size_t end)
+    {
+        int status = 0;
+        bool hasLength = false;
+        size_t len = 0;
+
+        for (size_t line = 0; line < end; )
+        {
+            const char* eol = (const char*)memchr(_buffer + line, '\n', end - line);
+            size_t lineLen = eol ? eol - (_buffer + line) + 1 : end - line;
+
+            bool keep = true;
+            if (line == 0)
+            {
+                const char* space = (const char*)memchr(_buffer, ' ', lineLen);
+                status = space ? atoi(space + 1) : 0;
+            }
+            else if (strncasecmp(_buffer + line, "connection:", 11) == 0)
+            {
+                keep = false;
+            }
+            else if (strncasecmp(_buffer + line, "content-length:", 15) == 0 ||
+                     strncasecmp(_buffer + line, "transfer-encoding:", 18) == 0)
+            {
+                hasLength = true;
+            }
+
+            // kept lines are moved down over any dropped
+            if (keep)
+            {
+                memmove(_buffer + len, _buffer + line, lineLen);
+                len += lineLen;
+            }
+            line += lineLen;
+        }
+
+        bool noBody = _bodyless || (status >= 100 && status < 200) || status == 204 || status == 304;
+        const char* added;
+        if (!_keepAlive)
+        {
+            added = "Connection: close\r\n\r\n";
+            _state = BODY;
+        }
+        else if (hasLength || noBody)
+        {
+            added = "Connection: keep-alive\r\n\r\n";
+            _state = BODY;
+        }
+        else
+        {
+            added = "Transfer-Encoding: chunked\r\nConnection: keep-alive\r\n\r\n";
+            _state = CHUNKED;
+        }
+
+        // in one write if it fits
+        size_t addedLen = strlen(added);
+        if (len + addedLen <= _size)
+        {
+            memcpy(_buffer + len, added, addedLen);
+            _client.write((const uint8_t*)_buffer, len + addedLen);
+        }
+        else
+        {
+            _client.write((const uint8_t*)_buffer, len);
+            _client.write((const uint8_t*)added, addedLen);
+        }
+        _len = 0;
+    }
+
+    void writeChunk()
+    {
+        if (_len == 0)
+            return;
+
+        char size[12];
+        int n = snprintf(size, sizeof(size), "%x\r\n", (unsigned)_len);
+        _client.write((const uint8_t*)size, n);
+        _client.write((const uint8_t*)_buffer, _len);
+        _client.write((const uint8_t*)"\r\n", 2);
+        _len = 0;
+    }
+
+    WiFiClient& _client;
+    char*       _buffer;
+    size_t      _size;
+    size_t      _len;
+    bool        _keepAlive;
+    bool        _bodyless;
+    State_t     _state;
+};
+
+/*
+ * Client handed to the handler, exposing exactly one buffered request, its
+ * head then its body, and writing the response through a ResponseWriter.
+ * stop() only marks the request finished, the connection is kept.
+ */
+class ReplayClient : public Client
+{
+public:
+    ReplayClient(const char* head, size_t headLen, const char* body, size_t bodyLen, ResponseWriter& response) :
+        _head((const uint8_t*)head), _headLen(headLen), _body((const uint8_t*)body),
+        _len(headLen + bodyLen), _pos(0), _response(response), _finished(false) {};
+
+    int connect(IPAddress ip, uint16_t port) override { return 0; }
+    int connect(const char* host, uint16_t port) override { return 0; }
+
+    size_t write(uint8_t b) override { return _response.write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override { return _response.write(buffer, size); }
+
+    int available() override
+    {
+        return _finished ? 0 : _len - _pos;
+    }
+
+    int read() override
+    {
+        return available() ? at(_pos++) : -1;
+    }
+
+    int read(uint8_t* buffer, size_t size) override
+    {
+        size_t n = min(size, (size_t)available());
+        for (size_t i = 0; i < n; i++)
+            buffer[i] = at(_pos++);
+        return n ? n : -1;
+    }
+
+    int peek() override
+    {
+        return available() ? at(_pos) : -1;
+    }
+
+    void flush() override {};
+    void stop() override { _finished = true; }
+    uint8_t connected() override { return !_finished; }
+    operator bool() override { return connected(); }
+
+private:
+    uint8_t at(size_t pos) const
+    {
+        return pos < _headLen ? _head[pos] : _body[pos - _headLen];
+    }
+
+    const uint8_t*  _head;
+    size_t          _headLen;
+    const uint8_t*  _body;
+    size_t          _len;
+    size_t          _pos;
+    ResponseWriter& _response;
+    bool            _finished;
+};
+
+// Value of a header, after any spaces, null if absent
+static const char* headerValue(const char* head, size_t len, const char* name)
+{
+    const size_t nameLen = strlen(name);
+
+    for (size_t i = 0; i + nameLen < len; i++)
+    {
+        // only at the start of a header line
+        if (i && head[i - 1] != '\n')
+            continue;
+        if (strncasecmp(head + i, name, nameLen) != 0)
+            continue;
+
+        for (i += nameLen; i < len && head[i] == ' '; i++);
+        return head + i;
+    }
+    return nullptr;
+}
+
+ApiConnections::ApiConnections() :
+    _bodyOwner(-1),
+    _bodyRead(0),
+    _requests(0),
+    _rejected(0),
+    _keptAlive(0),
+    _servedMax_ms(0)
+{
+    for (uint8_t i = 0; i < SLOT_COUNT; i++)
+        _slots[i].active = false;
+};
+
+void ApiConnections::loop(WiFiServer& server, apiHandler handler)
+{
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < SLOT_COUNT; i++)
+    {
+        Slot_t& slot = _slots[i];
+        if (!slot.active)
+        {
+            slot.client = server.accept();
+            if (!slot.client)
+                continue;
+
+            slot.active   = true;
+            slot.since_ms = now;
+            slot.len      = 0;
+            slot.scanned  = 0;
+            slot.headLen  = 0;
+            slot.served   = false;
+        }
+        service(i, now, handler);
+    }
+}
+
+void ApiConnections::service(uint8_t index, uint32_t now, apiHandler handler)
+{
+    Slot_t& slot = _slots[index];
+    bool closed = !slot.client.connected() && !slot.client.available();
+
+    if (!slot.headLen)
+    {
+        readSlot(slot, now);
+        if (!findHead(slot))
+        {
+            if (slot.len == SLOT_LEN)
+                reject(slot, "431 Request Header Fields Too Large");
+            else if (closed)
+                close(slot);
+            else if (slot.len && now - slot.since_ms >= REQUEST_TIMEOUT_MS)
+                reject(slot, "408 Request Timeout");
+            else if (!slot.len && now - slot.since_ms >= IDLE_TIMEOUT_MS)
+                close(slot);
+            return;
+        }
+
+        if (headerValue(slot.buffer, slot.headLen, "transfer-encoding:"))
+        {
+            reject(slot, "411 Length Required");
+            return;
+        }
+        if (slot.bodyLen > BODY_MAX_LEN)
+        {
+            reject(slot, "413 Payload Too Large");
+            return;
+        }
+    }
+
+    if (!readBody(index))
+    {
+        if (closed)
+            close(slot);
+        else if (now - slot.since_ms >= REQUEST_TIMEOUT_MS)
+            reject(slot, "408 Request Timeout");
+        return;
+    }
+
+    if (!serve(index, handler))
+        close(slot);
+}
+
+// Read what has arrived into the slot
+void ApiConnections::readSlot(Slot_t& slot, uint32_t now)
+{
+    int available = slot.client.available();
+    if (available <= 0 || slot.len == SLOT_LEN)
+        return;
+
+    int n = slot.client.read((uint8_t*)slot.buffer + slot.len, min((size_t)available, SLOT_LEN - slot.len));
+    if (n <= 0)
+        return;
+
+    // a request is timed from its first byte
+    if (slot.len == 0)
+        slot.since_ms = now;
+    slot.len += n;
+}
+
+// True once the blank line ending the head is buffered, which is then parsed
+bool ApiConnections::findHead(Slot_t& slot)
+{
+    // the blank line may straddle the previous read
+    size_t from = slot.scanned > 3 ? slot.scanned - 3 : 0;
+    slot.scanned = slot.len;
+
+    for (size_t i = from; i + 4 <= slot.len; i++)
+    {
+        if (memcmp(slot.buffer + i, "\r\n\r\n", 4) == 0)
+        {
+            slot.headLen = i + 4;
+            break;
+        }
+    }
+    if (!slot.headLen)
+        return false;
+
+    const char* value = headerValue(slot.buffer, slot.headLen, "content-length:");
+    slot.bodyLen = value ? strtoul(value, nullptr, 10) : 0;
+
+    // HTTP/1.1 keeps the connection alive unless asked to close, HTTP/1.0 closes
+    const char* eol = (const char*)memchr(slot.buffer, '\r', slot.headLen);
+    value = headerValue(slot.buffer, slot.headLen, "connection:");
+    slot.keepAlive = eol - slot.buffer >= 8 && memcmp(eol - 8, "HTTP/1.1", 8) == 0 &&
+        !(value && strncasecmp(value, "close", 5) == 0);
+    slot.bodyless = strncmp(slot.buffer, "HEAD ", 5) == 0;
+    return true;
+}
+
+// True once the body is buffered, a small one in the slot after the head,
+// a larger one in the shared body buffer once no other slot is using it
+bool ApiConnections::readBody(uint8_t index)
+{
+    Slot_t& slot = _slots[index];
+
+    if (slot.headLen + slot.bodyLen <= SLOT_LEN)
+    {
+        if (slot.len - slot.headLen < slot.bodyLen)
+            readSlot(slot, slot.since_ms);
+        return slot.len - slot.headLen >= slot.bodyLen;
+    }
+
+    if (_bodyOwner != index)
+    {
+        if (_bodyOwner >= 0)
+            return false;
+
+        // what was read with the head moves across
+        _bodyOwner = index;
+        _bodyRead = slot.len - slot.headLen;
+        memcpy(_body, slot.buffer + slot.headLen, _bodyRead);
+        slot.len = slot.headLen;
+    }
+
+    int available = slot.client.available();
+    if (available > 0 && _bodyRead < slot.bodyLen)
+    {
+        int n = slot.client.read((uint8_t*)_body + _bodyRead, min((size_t)available, slot.bodyLen - _bodyRead));
+        if (n > 0)
+            _bodyRead += n;
+    }
+    return _bodyRead == slot.bodyLen;
+}
+
+// Hand the buffered request to the handler, false if the connection is
+// then to be closed. Otherwise any pipelined request behind it moves to the
+// front of the slot, to be served next.
+bool ApiConnections::serve(uint8_t index, apiHandler handler)
+{
+    Slot_t& slot = _slots[index];
+    bool shared = _bodyOwner == index;
+
+    ResponseWriter response(slot.client, _responseHead, sizeof(_responseHead), slot.keepAlive, slot.bodyless);
+    ReplayClient client(slot.buffer, slot.headLen, shared ? _body : slot.buffer + slot.headLen, slot.bodyLen, response);
+    handler(&client);
+    bool keepAlive = response.finish();
+
+    _requests++;
+    if (slot.served)
+        _keptAlive++;
+    slot.served = true;
+
+    uint32_t now = millis();
+    if (now - slot.since_ms > _servedMax_ms)
+        _servedMax_ms = now - slot.since_ms;
+
+    if (shared)
+        _bodyOwner = -1;
+    if (!keepAlive || !slot.client.connected())
+        return false;
+
+    size_t used = slot.headLen + (shared ? 0 : slot.bodyLen);
+    slot.len -= used;
+    memmove(slot.buffer, slot.buffer + used, slot.len);
+    slot.scanned  = 0;
+    slot.headLen  = 0;
+    slot.since_ms = now;
+    return true;
+}
+
+void ApiConnections::reject(Slot_t& slot, const char* status)
+{
+    LOGF_WARN("Rejected API request: %s", status);
+    _rejected++;
+
+    slot.client.print("HTTP/1.1 ");
+    slot.client.print(status);
+    slot.client.print("\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+    close(slot);
+}
+
+void ApiConnections::close(Slot_t& slot)
+{
+    if (_bodyOwner == &slot - _slots)
+        _bodyOwner = -1;
+
+    slot.client.stop();
+    slot.client = WiFiClient();
+    slot.active = false;
+}
+
+void ApiConnections::getApiJson(JsonVariant json) const
+{
+    uint8_t open = 0;
+    for (uint8_t i = 0; i < SLOT_COUNT; i++)
+        open += _slots[i].active;
+
+    JsonObject api = json.createNestedObject("api");
+    api["connections"]    = open;
+    api["requestCount"]   = _requests;
+    api["keptAliveCount"] = _keptAlive;
+    api["rejectedCount"]  = _rejected;
+    api["servedMaxMs"]    = _servedMax_ms;
+}
+
+uint32_t ApiConnections::getRequestCount() const
+{
+    return _requests;
+}
+
+uint32_t ApiConnections::getRejectedCount() const
+{
+    return _rejected;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+
+// Serves one complete request, read from and responded to through client
+typedef void (*apiHandler)(Client* client);
+
+/*
+ * Non-blocking HTTP/1.1 front end for the REST API. Accepted sockets are
+ * held in a few slots and each request is read as it arrives, so an idle
+ * or slow client does not stall the loop, or the clients queued behind it.
+ * A request is only handed to the handler once its head and body are fully
+ * buffered: the head, and a small body, in the slot, a larger body in one
+ * body buffer shared by the slots a request at a time. The handler's
+ * response is rewritten to keep the connection alive, chunked if it has no
+ * Content-Length, and any pipelined request behind it is served next.
+ * Requests that do not fit, or do not arrive in time, are rejected.
+ */
+class ApiConnections
+{
+public:
+    ApiConnections();
+
+    inline static const uint8_t  SLOT_COUNT          = 4;
+    inline static const size_t   SLOT_LEN            = 1024;    // per slot, request line, headers and a small body
+    inline static const size_t   BODY_MAX_LEN        = 16384;   // shared, as JSON_CONFIG_MAX_SIZE
+    inline static const size_t   RESPONSE_HEAD_LEN   = 512;     // response head rewritten, then chunks buffered
+    inline static const uint32_t REQUEST_TIMEOUT_MS  = 5000;    // from the first byte to a complete request
+    inline static const uint32_t IDLE_TIMEOUT_MS     = 15000;   // kept alive between requests
+
+    // Accept into free slots, read what has arrived and serve complete requests
+    void loop(WiFiServer& server, apiHandler handler);
+
+    void getApiJson(JsonVariant json) const;
+    uint32_t getRequestCount() const;
+    uint32_t getRejectedCount() const;
+
+private:
+    typedef struct {
+        WiFiClient client;
+        bool       active;
+        uint32_t   since_ms;                // accepted, last served, or first byte of a request
+        size_t     len;                     // bytes buffered
+        size_t     scanned;                 // of which searched for the end of the head
+        size_t     headLen;                 // including the blank line, 0 until seen
+        size_t     bodyLen;                 // Content-Length
+        bool       keepAlive;               // HTTP/1.1 without "Connection: close"
+        bool       bodyless;                // HEAD, so a response has no body
+        bool       served;                  // a request was served on this connection
+        char       buffer[SLOT_LEN];
+    } Slot_t;
+
+    void service(uint8_t index, uint32_t now, apiHandler handler);
+    void readSlot(Slot_t& slot, uint32_t now);
+    bool findHead(Slot_t& slot);
+    bool readBody(uint8_t index);
+    bool serve(uint8_t index, apiHandler handler);
+    void reject(Slot_t& slot, const char* status);
+    void close(Slot_t& slot);
+
+    Slot_t   _slots[SLOT_COUNT];
+    char     _body[BODY_MAX_LEN];           // body too large for its slot
+    int8_t   _bodyOwner;                    // slot using _body, -1 if none
+    size_t   _bodyRead;
+    char     _responseHead[RESPONSE_HEAD_LEN];
+
+    uint32_t _requests;
+    uint32_t _rejected;
+    uint32_t _keptAlive;                    // requests served on an already used connection
+    uint32_t _servedMax_ms;                 // longest first byte to response
+};
@@ -0,0 +1,148 @@
+#include <OXRS_LOG.h>
+#include <ConnectionSupervisor.h>
+
+static const char *_LOG_PREFIX = "[ConnectionSupervisor] ";
+
+ConnectionSupervisor::ConnectionSupervisor() :
+    _state(OFFLINE),
+    _stateSince_ms(0),
+    _wifiWasUp(false),
+    _mqttWasUp(false),
+    _wifiJoins(0),
+    _mqttConnects(0),
+    _wifiBackoff(MAX_WIFI_BACKOFF_MS),
+    _mqttBackoff(MAX_MQTT_BACKOFF_MS),
+    _rssi(0),
+    _rssiSample_ms(0),
+    _poorSamples(0),
+    _roam_ms(0),
+    _roams(0)
+{
+    memset(_state_ms, 0, sizeof(_state_ms));
+    memset(_rssiHistogram, 0, sizeof(_rssiHistogram));
+};
+
+void ConnectionSupervisor::Backoff::attempted(uint32_t now)
+{
+    _base_ms = _delay_ms == 0 ? MIN_BACKOFF_MS : min(_base_ms * 2, _max_ms);
+
+    // +/-25% so devices sharing an AP or broker do not retry in step
+    _delay_ms = _base_ms - _base_ms / 4 + random(_base_ms / 2 + 1);
+    _last_ms  = now;
+}
+
+ConnectionSupervisor::Action_t ConnectionSupervisor::loop(bool wifiUp, bool mqttUp, int32_t rssi)
+{
+    uint32_t now = millis();
+    mqttUp = wifiUp && mqttUp;
+
+    account(now);
+    _state = !wifiUp ? OFFLINE : (mqttUp ? CONNECTED : RECONNECTING);
+
+    if (wifiUp != _wifiWasUp)
+    {
+        _wifiWasUp = wifiUp;
+        if (wifiUp)
+        {
+            _wifiJoins++;
+            _wifiBackoff.reset();
+        }
+        else
+        {
+            _poorSamples = 0;
+            LOG_WARN(F("WiFi lost"));
+        }
+    }
+
+    if (mqttUp != _mqttWasUp)
+    {
+        _mqttWasUp = mqttUp;
+        if (mqttUp)
+        {
+            _mqttConnects++;
+            _mqttBackoff.reset();
+        }
+    }
+
+    if (!wifiUp)
+    {
+        if (!_wifiBackoff.isDue(now))
+            return NONE;
+        _wifiBackoff.attempted(now);
+        return REJOIN_WIFI;
+    }
+
+    // rejoin on a signal that has stayed weak, hopefully to a stronger AP
+    sampleRssi(now, rssi);
+    if (_poorSamples >= ROAM_POOR_SAMPLES && (_roams == 0 || now - _roam_ms >= ROAM_MIN_INTERVAL_MS))
+    {
+        LOGF_WARN("RSSI %ld dBm for %u samples, rejoining WiFi", (long)_rssi, (unsigned)_poorSamples);
+        _poorSamples = 0;
+        _roam_ms = now;
+        _roams++;
+        return REJOIN_WIFI;
+    }
+
+    if (!mqttUp && _mqttBackoff.isDue(now))
+    {
+        _mqttBackoff.attempted(now);
+        return CONNECT_MQTT;
+    }
+    return NONE;
+}
+
+ConnectionSupervisor::State_t ConnectionSupervisor::getState() const
+{
+    return _state;
+}
+
+int32_t ConnectionSupervisor::getRssi() const
+{
+    return _rssi;
+}
+
+void ConnectionSupervisor::account(uint32_t now)
+{
+    _state_ms[_state] += now - _stateSince_ms;
+    _stateSince_ms = now;
+}
+
+void ConnectionSupervisor::sampleRssi(uint32_t now, int32_t rssi)
+{
+    if (_rssiSample_ms && now - _rssiSample_ms < RSSI_SAMPLE_MS)
+        return;
+    _rssiSample_ms = now;
+    _rssi = rssi;
+
+    uint8_t bucket = 0;
+    while (bucket < RSSI_BUCKET_COUNT - 1 && rssi < RSSI_BUCKETS[bucket])
+        bucket++;
+    _rssiHistogram[bucket]++;
+
+    _poorSamples = rssi < ROAM_RSSI ? _poorSamples + 1 : 0;
+}
+
+void ConnectionSupervisor::getLinkJson(JsonVariant json) const
+{
+    uint32_t now = millis();
+
+    JsonObject link = json.createNestedObject("link");
+    link["state"]          = stateStr[_state];
+    link["uptimeSeconds"]  = now / 1000;
+    link["rssi"]           = _rssi;
+    link["wifiReconnects"] = _wifiJoins ? _wifiJoins - 1 : 0;
+    link["mqttReconnects"] = _mqttConnects ? _mqttConnects - 1 : 0;
+    link["wifiRoams"]      = _roams;
+
+    JsonObject stateSeconds = link.createNestedObject("stateSeconds");
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+    {
+        uint64_t ms = _state_ms[state] + (state == _state ? now - _stateSince_ms : 0);
+        stateSeconds[stateStr[state]] = (uint32_t)(ms / 1000);
+    }
+
+    // counts of samples >= -50, -60, -70, -80 dBm, then weaker
+    JsonArray histogram = link.createNestedArray("rssiHistogram");
+    for (uint8_t bucket = 0; bucket < RSSI_BUCKET_COUNT; bucket++)
+        histogram.add(_rssiHistogram[bucket]);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/*
+ * Owns the WiFi and MQTT reconnect lifecycle. Called every loop with the
+ * link status, it returns what to try next: reconnect attempts are spaced
+ * by jittered exponential backoff, reset once the link is back, and WiFi
+ * is rejoined when the signal has stayed weak so a stronger AP can be
+ * picked. It also accounts time spent in each state and keeps reconnect
+ * counts and an RSSI histogram.
+ */
+class ConnectionSupervisor
+{
+public:
+    ConnectionSupervisor();
+
+    enum State_t {
+        OFFLINE=0,          // WiFi down
+        RECONNECTING,       // WiFi up, MQTT down
+        CONNECTED,          // WiFi and MQTT up
+        STATE_COUNT
+    };
+
+    enum Action_t {
+        NONE=0,
+        REJOIN_WIFI,        // (re)connect WiFi, disconnecting first if up
+        CONNECT_MQTT,       // one MQTT connect attempt
+    };
+
+    inline static const char *stateStr[] = {
+        "offline",
+        "reconnecting",
+        "connected"
+    };
+
+    // RSSI histogram bucket lower bounds (dBm), the last bucket takes the rest
+    inline static const int8_t RSSI_BUCKETS[] = { -50, -60, -70, -80 };
+    inline static const uint8_t RSSI_BUCKET_COUNT = sizeof(RSSI_BUCKETS) + 1;
+
+    inline static const uint32_t MIN_BACKOFF_MS      = 1000;
+    inline static const uint32_t MAX_WIFI_BACKOFF_MS = 300000;
+    inline static const uint32_t MAX_MQTT_BACKOFF_MS = 120000;
+    inline static const uint32_t RSSI_SAMPLE_MS      = 10000;
+    inline static const int8_t   ROAM_RSSI           = -80;     // dBm, weaker is poor
+    inline static const uint8_t  ROAM_POOR_SAMPLES   = 6;       // consecutive, before rejoining
+    inline static const uint32_t ROAM_MIN_INTERVAL_MS = 600000;
+
+    Action_t loop(bool wifiUp, bool mqttUp, int32_t rssi);
+
+    State_t getState() const;
+    int32_t getRssi() const;            // last sampled, dBm
+    void getLinkJson(JsonVariant json) const;
+
+private:
+    // Jittered exponential backoff between attempts
+    class Backoff {
+    public:
+        Backoff(uint32_t max_ms) :
+            _max_ms(max_ms), _delay_ms(0), _last_ms(0), _base_ms(0) {};
+
+        bool isDue(uint32_t now) const {
+            return _delay_ms == 0 || now - _last_ms >= _delay_ms;
+        }
+
+        void attempted(uint32_t now);
+
+        void reset() {
+            _delay_ms = 0;
+        }
+
+    private:
+        uint32_t _max_ms;
+        uint32_t _delay_ms;             // 0 until the first attempt
+        uint32_t _last_ms;              // time of last attempt
+        uint32_t _base_ms;              // unjittered delay
+    };
+
+    void account(uint32_t now);
+    void sampleRssi(uint32_t now, int32_t rssi);
+
+    State_t  _state;
+    uint32_t _stateSince_ms;            // last accounted
+    uint64_t _state_ms[STATE_COUNT];    // time spent in each state
+
+    bool     _wifiWasUp;
+    bool     _mqttWasUp;
+    uint32_t _wifiJoins;                // the first is not a reconnect
+    uint32_t _mqttConnects;
+
+    Backoff  _wifiBackoff;
+    Backoff  _mqttBackoff;
+
+    int32_t  _rssi;                     // last sampled
+    uint32_t _rssiSample_ms;
+    uint32_t _rssiHistogram[RSSI_BUCKET_COUNT];
+    uint8_t  _poorSamples;              // consecutive below ROAM_RSSI
+    uint32_t _roam_ms;                  // time of last roaming rejoin
+    uint32_t _roams;
+};
@@ -0,0 +1,101 @@
+#include <MetricsWriter.h>
+
+MetricsWriter::MetricsWriter(Print& out) :
+    _out(out)
+{
+};
+
+void MetricsWriter::describe(const char* name, const char* type, const char* help)
+{
+    _out.print("# HELP ");
+    _out.print(name);
+    _out.print(" ");
+    _out.print(help);
+    _out.print("\n# TYPE ");
+    _out.print(name);
+    _out.print(" ");
+    _out.print(type);
+    _out.print("\n");
+}
+
+void MetricsWriter::sample(const char* name, uint32_t value, const char* label, const char* labelValue)
+{
+    writeName(name, label, labelValue);
+    writeUnsigned(value);
+    _out.print("\n");
+}
+
+// value / scale, to three decimal places unless scale is 1
+void MetricsWriter::sample(const char* name, int32_t value, uint32_t scale, const char* label, const char* labelValue)
+{
+    writeName(name, label, labelValue);
+
+    if (scale <= 1)
+    {
+        if (value < 0)
+            _out.print("-");
+        writeUnsigned(value < 0 ? 0 - (uint32_t)value : (uint32_t)value);
+        _out.print("\n");
+        return;
+    }
+
+    int64_t milli = (int64_t)value * 1000 / scale;
+    if (milli < 0)
+    {
+        _out.print("-");
+        milli = -milli;
+    }
+    writeUnsigned((uint32_t)(milli / 1000));
+    _out.print(".");
+    writeUnsigned((uint32_t)(milli % 1000), 3);
+    _out.print("\n");
+}
+
+void MetricsWriter::gauge(const char* name, const char* help, uint32_t value)
+{
+    describe(name, "gauge", help);
+    sample(name, value);
+}
+
+void MetricsWriter::gauge(const char* name, const char* help, int32_t value, uint32_t scale)
+{
+    describe(name, "gauge", help);
+    sample(name, value, scale);
+}
+
+void MetricsWriter::counter(const char* name, const char* help, uint32_t value)
+{
+    describe(name, "counter", help);
+    sample(name, value);
+}
+
+void MetricsWriter::writeName(const char* name, const char* label, const char* labelValue)
+{
+    _out.print(name);
+    if (label)
+    {
+        _out.print("{");
+        _out.print(label);
+        _out.print("=\"");
+        _out.print(labelValue);
+        _out.print("\"}");
+    }
+    _out.print(" ");
+}
+
+void MetricsWriter::writeUnsigned(uint32_t value, uint8_t minDigits)
+{
+    char digits[10];
+    uint8_t n = 0;
+    do
+    {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value || n < minDigits);
+
+    char text[sizeof(digits) + 1];
+    for (uint8_t i = 0; i < n; i++)
+        text[i] = digits[n - 1 - i];
+    text[n] = '\0';
+    _out.print(text);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+ * Writes metrics in the Prometheus text exposition format straight to a
+ * Print, such as an API response. Values are formatted on the stack, so a
+ * scrape makes no heap allocations. Scaled integers (as the SEN5x reports
+ * them) are written as decimals without floating point.
+ */
+class MetricsWriter
+{
+public:
+    MetricsWriter(Print& out);
+
+    // HELP and TYPE lines, once per metric before its samples
+    void describe(const char* name, const char* type, const char* help);
+
+    // Sample of the last described metric, with an optional label
+    void sample(const char* name, uint32_t value, const char* label = nullptr, const char* labelValue = nullptr);
+    void sample(const char* name, int32_t value, uint32_t scale, const char* label = nullptr, const char* labelValue = nullptr);
+
+    // Metric with a single sample
+    void gauge(const char* name, const char* help, uint32_t value);
+    void gauge(const char* name, const char* help, int32_t value, uint32_t scale);
+    void counter(const char* name, const char* help, uint32_t value);
+
+private:
+    void writeName(const char* name, const char* label, const char* labelValue);
+    void writeUnsigned(uint32_t value, uint8_t minDigits = 1);
+
+    Print& _out;
+};
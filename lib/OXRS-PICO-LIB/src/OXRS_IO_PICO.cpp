@@ -11,12 +11,19 @@
 #include <OXRS_LOG.h>
 #include <OXRS_IO_PICO.h>
 #include <OXRS_TIME.h>
+#include <TelemetryBacklog.h>
+#include <ConnectionSupervisor.h>
+#include <ApiConnections.h>
+#include <AdoptCache.h>
 #include <WiFiManager.h>
 
 // #define __WATCHDOG
 // #define __USE_OXRS_TIME_LIB
 static const char *_LOG_PREFIX = "[OXRS_IO_PICO] ";
 
+// earlier times mean the clock has not been set
+static const time_t CLOCK_VALID_EPOCH = 1672531200;     // 2023-01-01
+
 // Supported firmware config and command schemas
 DynamicJsonDocument _fwConfigSchema(JSON_CONFIG_MAX_SIZE);
 DynamicJsonDocument _fwCommandSchema(JSON_CONFIG_MAX_SIZE);
@@ -29,12 +36,44 @@ WiFiClient _client;
 PubSubClient _mqttClient(_client);
 OXRS_MQTT    _mqtt(_mqttClient);
 
-// REST API
-OXRS_API _api(_mqtt);
+// REST API, requests read without blocking by _apiConnections
+OXRS_API       _api(_mqtt);
+ApiConnections _apiConnections;
 
 // Logging
 OXRS_LOG::MQTTLogger _mqttLogger(_mqttClient);   // Logging (topic updated once MQTT connects successfully)
 OXRS_LOG::SysLogger  _sysLogger;                 // Updated on config
+WiFiClient           _lokiClient;
+OXRS_LOG::LokiLogger _lokiLogger(_lokiClient);   // Updated on config
+
+// WiFi, joined in the background from loop()
+WiFiManager                  _wifiManager("OXRS_WiFi", "superhouse");     // saved credentials and the portal
+OXRS_IO_PICO::NetworkState_t _networkState = OXRS_IO_PICO::NETWORK_DOWN;
+uint32_t                     _networkJoin_ms;   // time the join was started
+bool                         _serverListening;
+
+// WiFi and MQTT reconnects, once WiFi has first joined
+ConnectionSupervisor _supervisor;
+bool                 _networkRejoining;         // a rejoin was started, at _networkJoin_ms
+uint32_t             _linkPublish_ms;           // time link quality was last published
+
+// millis() each boot phase was reached, 0 if not yet
+uint32_t _bootPhase_ms[OXRS_IO_PICO::BOOT_PHASE_COUNT];
+
+// Telemetry taken while MQTT is unavailable, drained once it reconnects
+TelemetryBacklog _telemetryBacklog;
+uint32_t         _telemetryDrain_ms;            // time of the last drained batch
+char             _telemetryPayload[TelemetryBacklog::MAX_PAYLOAD_LEN];
+uint32_t         _telemetryPublished;           // live and drained
+uint8_t          _telemetryHeadFailures;        // failed publishes of the oldest in the backlog
+bool             _telemetryStampLive;           // live telemetry stamped as replays are, if configured
+
+// Loop timing, the longest pass over fixed windows so every scrape sees the same
+uint32_t _loopCount;
+uint32_t _loop_us;                              // micros() at the start of the last pass
+uint32_t _loopMax_us;                           // in the current window
+uint32_t _loopMaxLast_us;                       // in the last complete window
+uint32_t _loopWindow_ms;                        // start of the current window
 
 // Time
 #ifdef __USE_OXRS_TIME_LIB
@@ -45,11 +84,38 @@ OXRS_TIME oxrsTime;
 jsonCallback _onConfig;
 jsonCallback _onCommand;
 
+// Firmware metrics appended to the device metrics
+metricsCallback _onMetrics;
+
+// Firmware, config schema and command schema parts of the adopt payload
+AdoptCache _adoptCache;
+
 void _apiAdoptCallback(JsonVariant json)
 {
     OXRS_IO_PICO::apiAdoptCallback(json);
 }
 
+// A complete request, buffered by _apiConnections
+void _apiRequest(Client* client)
+{
+    _api.loop(client);
+}
+
+// Lines logged before the last warm reboot
+void _apiCrashLog(Request &req, Response &res)
+{
+    res.set("Content-Type", "text/plain");
+    oxrsLog.printRetained(res);
+}
+
+// Prometheus scrape, streamed to the response from cached values
+void _apiMetrics(Request &req, Response &res)
+{
+    res.set("Content-Type", "text/plain; version=0.0.4");
+    MetricsWriter metrics(res);
+    OXRS_IO_PICO::writeMetrics(metrics);
+}
+
 void _mqttConnected()
 {
     // update log topic
@@ -59,6 +125,13 @@ void _mqttConnected()
     DynamicJsonDocument json(JSON_ADOPT_MAX_SIZE);
     _mqtt.publishAdopt(_api.getAdopt(json.as<JsonVariant>()));
 
+    // drain any backlog a batch at a time, starting after one period
+    _telemetryDrain_ms = millis();
+
+    // link quality straight away, with the reconnect counted
+    _linkPublish_ms = millis() - OXRS_IO_PICO::LINK_PUBLISH_MS;
+    OXRS_IO_PICO::setBootPhase(OXRS_IO_PICO::BOOT_MQTT);
+
     LOG_INFO(F("mqtt connected"));
 }
 
@@ -100,6 +173,15 @@ void _mqttDisconnected(int state)
 
 void _mqttConfig(JsonVariant json)
 {
+    // the config schema may reflect current config
+    _adoptCache.invalidate();
+
+    // replayed telemetry is always stamped, live only if asked for
+    if (json.containsKey(OXRS_IO_PICO::TELEMETRY_TIMESTAMP_CONFIG))
+    {
+        _telemetryStampLive = json[OXRS_IO_PICO::TELEMETRY_TIMESTAMP_CONFIG].as<bool>();
+    }
+
     // parse any logging config updates
     oxrsLog.onConfig(json);
 
@@ -158,6 +240,7 @@ void OXRS_IO_PICO::initialiseMqtt(byte *mac)
     char clientId[32];
     sprintf_P(clientId, PSTR("%02x%02x%02x"), mac[3], mac[4], mac[5]);
     _mqtt.setClientId(clientId);
+    _lokiLogger.setDevice(clientId);
 
     // Register callbacks
     _mqtt.onConnected(_mqttConnected);
@@ -180,10 +263,14 @@ void OXRS_IO_PICO::initialiseRestApi()
     _api.begin();
 
     // Register callbacks
+    _adoptCache.addPart("firmware", getFirmwareJson);
+    _adoptCache.addPart("configSchema", getConfigSchemaJson);
+    _adoptCache.addPart("commandSchema", getCommandSchemaJson);
     _api.onAdopt(_apiAdoptCallback);
+    _api.get("/crashlog", &_apiCrashLog);
+    _api.get("/metrics", &_apiMetrics);
 
-    // Start listenging
-    _server.begin();
+    // Start listening once WiFi has joined, the captive portal uses port 80
 }
 
 boolean OXRS_IO_PICO::isNetworkConnected()
@@ -201,18 +288,107 @@ void OXRS_IO_PICO::initialiseNetwork(byte *mac)
     sprintf_P(mac_display, PSTR("%02X:%02X:%02X:%02X:%02X:%02X"), mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     LOG_INFO(mac_display);
 
-    // Connect using saved creds, or start captive portal if none found
-    // NOTE: Blocks until connected or the portal is closed
-    WiFiManager wm("OXRS_WiFi", "superhouse");
+    // Join with the saved credentials without waiting, loop() polls the
+    // join and starts the captive portal if there are none or it fails
     String title("PicoW");
     String name(FW_NAME);
     String shortname(FW_SHORT_NAME);
     String maker(FW_MAKER);
     String version(FW_VERSION);
-    wm.setContentText(title, name, shortname, maker, version);
-    bool success = wm.autoConnect();
-    String ip = success ? WiFi.localIP().toString() : IPAddress(0, 0, 0, 0).toString();
-    LOGF_INFO("network %s", ip.c_str());
+    _wifiManager.setContentText(title, name, shortname, maker, version);
+    _wifiManager.setConfigPortalBlocking(false);
+
+    if (_wifiManager.getWiFiIsSaved())
+    {
+        WiFi.beginNoBlock(_wifiManager.getWiFiSSID().c_str(), _wifiManager.getWiFiPass().c_str());
+        _networkState = NETWORK_JOINING;
+        _networkJoin_ms = millis();
+    }
+}
+
+// Poll the first join, serving the captive portal if it is needed, then
+// reconnect as the supervisor decides. True if an MQTT connect attempt is due.
+bool OXRS_IO_PICO::loopNetwork()
+{
+    switch (_networkState)
+    {
+    case NETWORK_DOWN:
+        _wifiManager.startConfigPortal();
+        _networkState = NETWORK_PORTAL;
+        LOG_INFO(F("network not joined, captive portal started"));
+        return false;
+
+    case NETWORK_JOINING:
+        if (isNetworkConnected())
+            networkJoined();
+        else if (millis() - _networkJoin_ms >= NETWORK_JOIN_TIMEOUT_MS)
+            _networkState = NETWORK_DOWN;
+        return false;
+
+    case NETWORK_PORTAL:
+        if (_wifiManager.process() || isNetworkConnected())
+            networkJoined();
+        return false;
+
+    default:
+        break;
+    }
+
+    bool wifiUp = isNetworkConnected();
+    if (wifiUp)
+        _networkRejoining = false;
+
+    switch (_supervisor.loop(wifiUp, _mqtt.connected(), wifiUp ? WiFi.RSSI() : 0))
+    {
+    case ConnectionSupervisor::REJOIN_WIFI:
+        rejoinNetwork();
+        return false;
+    case ConnectionSupervisor::CONNECT_MQTT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Start joining with the saved credentials, without waiting, the portal is
+// only for first setup. The supervisor sees the link come up from loop().
+void OXRS_IO_PICO::rejoinNetwork()
+{
+    // a join still in progress is left to complete
+    if (_networkRejoining && millis() - _networkJoin_ms < NETWORK_REJOIN_MS)
+        return;
+
+    LOG_INFO(F("rejoining network"));
+    if (isNetworkConnected())
+        WiFi.disconnect();
+
+    WiFi.beginNoBlock(_wifiManager.getWiFiSSID().c_str(), _wifiManager.getWiFiPass().c_str());
+    _networkRejoining = true;
+    _networkJoin_ms = millis();
+}
+
+void OXRS_IO_PICO::networkJoined()
+{
+    _networkState = NETWORK_UP;
+    LOGF_INFO("network %s", WiFi.localIP().toString().c_str());
+
+    // Start listening
+    if (!_serverListening)
+    {
+        _server.begin();
+        _serverListening = true;
+    }
+    setBootPhase(BOOT_WIFI);
+}
+
+void OXRS_IO_PICO::setBootPhase(BootPhase_t phase)
+{
+    if (_bootPhase_ms[phase])
+        return;
+
+    // 0 means not reached
+    _bootPhase_ms[phase] = max(millis(), 1UL);
+    LOGF_INFO("Boot phase %s at %lu ms", bootPhaseStr[phase], (unsigned long)_bootPhase_ms[phase]);
 }
 
 void OXRS_IO_PICO::initialiseTempSensor()
@@ -246,17 +422,44 @@ float OXRS_IO_PICO::readOnboardTemperature(bool celsiusNotFahr)
 
 void OXRS_IO_PICO::loop()
 {
+    // time between passes, so the whole firmware loop
+    uint32_t now_us = micros();
+    if (_loopCount++)
+        _loopMax_us = max(_loopMax_us, now_us - _loop_us);
+    _loop_us = now_us;
+
+    if (millis() - _loopWindow_ms >= LOOP_WINDOW_MS)
+    {
+        _loopMaxLast_us = _loopMax_us;
+        _loopMax_us = 0;
+        _loopWindow_ms = millis();
+    }
+
+    // bring the network up in the background
+    bool connectMqtt = loopNetwork();
+
     // check network connection
-    if (isNetworkConnected())
+    if (_networkState == NETWORK_UP && isNetworkConnected())
     {
-        // handle mqtt messages
-        int res = _mqtt.loop();
+        // before anything might adopt, so the build document is not held
+        // alongside one being adopted
+        _adoptCache.refresh(JSON_ADOPT_MAX_SIZE);
+
+        // handle mqtt messages, only attempting to connect when the supervisor's backoff allows
+        if (_mqtt.connected() || connectMqtt)
+            _mqtt.loop();
+
+        // publish telemetry taken while disconnected
+        drainTelemetry();
+        publishLink();
 
         // handle api requests
-        WiFiClient client = _server.available();
-        _api.loop(&client);
+        _apiConnections.loop(_server, _apiRequest);
     }
 
+    // write any async log records
+    oxrsLog.pump();
+
 #ifdef __WATCHDOG
     watchdog_update();
 #endif
@@ -269,11 +472,136 @@ OXRS_MQTT* OXRS_IO_PICO::getMQTT()
 
 void OXRS_IO_PICO::publishTelemetry(JsonVariant telemetry)
 {
-    // publish something to OXRS_
-    if (isNetworkConnected)
+    size_t len = serializeJson(telemetry, _telemetryPayload, sizeof(_telemetryPayload));
+    publishTelemetry(_telemetryPayload, len);
+}
+
+void OXRS_IO_PICO::publishTelemetry(const char* payload, size_t len)
+{
+    setBootPhase(BOOT_FIRST_TELEMETRY);
+
+    time_t now = time(nullptr);
+    uint32_t time_s = now < CLOCK_VALID_EPOCH ? 0 : now;
+
+    // behind any backlog, so telemetry is published in the order sampled
+    if (_telemetryBacklog.isEmpty() && isNetworkConnected() && _mqtt.connected())
+    {
+        bool published = _telemetryStampLive ?
+            publishStamped(payload, len, time_s, millis()) :
+            publishUnstamped(payload, len);
+        if (published)
+        {
+            _telemetryPublished++;
+            return;
+        }
+    }
+
+    // keep it, with when it was sampled, until the broker is back
+    _telemetryBacklog.push(payload, len, time_s, millis());
+}
+
+// Publish a batch of the backlog, at most once a period so a reconnect
+// does not swamp the broker
+void OXRS_IO_PICO::drainTelemetry()
+{
+    if (_telemetryBacklog.isEmpty() || !_mqtt.connected())
+        return;
+
+    if (millis() - _telemetryDrain_ms < TELEMETRY_DRAIN_MS)
+        return;
+    _telemetryDrain_ms = millis();
+
+    for (uint8_t i = 0; i < TELEMETRY_DRAIN_BATCH; i++)
     {
-        _mqtt.publishTelemetry(telemetry);
+        uint32_t time_s, time_ms;
+        size_t len = _telemetryBacklog.peek(_telemetryPayload, sizeof(_telemetryPayload), time_s, time_ms);
+        if (len == 0)
+            break;
+
+        if (!publishStamped(_telemetryPayload, len, time_s, time_ms))
+        {
+            // rejected while connected, e.g. too big for the MQTT buffer once
+            // stamped, would otherwise hold up the backlog for good
+            if (_mqtt.connected() && ++_telemetryHeadFailures >= TELEMETRY_DRAIN_ATTEMPTS)
+            {
+                LOG_WARN(F("Telemetry rejected by the broker, dropped"));
+                _telemetryBacklog.drop();
+                _telemetryHeadFailures = 0;
+            }
+            break;
+        }
+        _telemetryBacklog.pop();
+        _telemetryHeadFailures = 0;
+        _telemetryPublished++;
     }
+
+    if (_telemetryBacklog.isEmpty())
+        LOG_INFO(F("Telemetry backlog drained"));
+}
+
+// Publish a payload with when it was sampled as the first field, "timestamp"
+// (epoch) if known, otherwise "ageMs", for replays from the backlog and live
+// telemetry if configured
+bool OXRS_IO_PICO::publishStamped(const char* payload, size_t len, uint32_t time_s, uint32_t time_ms)
+{
+    // not an object with fields to splice into, as it is
+    if (len < 3 || payload[0] != '{')
+        return publishUnstamped(payload, len);
+
+    // the clock may have been set since
+    time_t now = time(nullptr);
+    if (time_s == 0 && now >= CLOCK_VALID_EPOCH)
+        time_s = now - (millis() - time_ms) / 1000;
+
+    char field[32];
+    int n = time_s ?
+        snprintf(field, sizeof(field), "\"timestamp\":%lu", (unsigned long)time_s) :
+        snprintf(field, sizeof(field), "\"ageMs\":%lu", (unsigned long)(millis() - time_ms));
+
+    return publishSpliced(field, n, payload, len);
+}
+
+// Publish a payload to the telemetry topic as it is
+bool OXRS_IO_PICO::publishUnstamped(const char* payload, size_t len)
+{
+    char topic[64];
+    return _mqttClient.publish(_mqtt.getTelemetryTopic(topic), (const uint8_t*)payload, len, false);
+}
+
+// Publish link quality to its own topic, below the telemetry topic, at its
+// own interval rather than with every telemetry message
+void OXRS_IO_PICO::publishLink()
+{
+    if (!_mqtt.connected() || millis() - _linkPublish_ms < LINK_PUBLISH_MS)
+        return;
+    _linkPublish_ms = millis();
+
+    StaticJsonDocument<384> json;
+    _supervisor.getLinkJson(json.as<JsonVariant>());
+    char payload[320];
+    size_t len = serializeJson(json["link"], payload, sizeof(payload));
+
+    char telemetryTopic[64];
+    char topic[72];
+    snprintf(topic, sizeof(topic), "%s/link", _mqtt.getTelemetryTopic(telemetryTopic));
+    _mqttClient.publish(topic, (const uint8_t*)payload, len, false);
+}
+
+// Publish a json object payload to the telemetry topic with fields (one or
+// more "key":value, no braces) spliced in first, without copying it
+bool OXRS_IO_PICO::publishSpliced(const char* fields, size_t fieldsLen, const char* payload, size_t len)
+{
+    if (len < 3 || payload[0] != '{')
+        return false;
+
+    char topic[64];
+    if (!_mqttClient.beginPublish(_mqtt.getTelemetryTopic(topic), 1 + fieldsLen + len, false))
+        return false;
+    _mqttClient.write((const uint8_t*)"{", 1);
+    _mqttClient.write((const uint8_t*)fields, fieldsLen);
+    _mqttClient.write((const uint8_t*)",", 1);
+    _mqttClient.write((const uint8_t*)payload + 1, len - 1);
+    return _mqttClient.endPublish();
 }
 
 // json helper
@@ -343,6 +671,48 @@ void OXRS_IO_PICO::getSystemJson(JsonVariant json)
     LittleFS.info64(fs);
     system["fileSystemUsedBytes"]  = fs.usedBytes;
     system["fileSystemTotalBytes"] = fs.totalBytes;
+
+    system["logDroppedCount"]     = oxrsLog.getDroppedCount();
+    system["logRateLimitedCount"] = oxrsLog.getRateLimitedCount();
+    system["logRepeatedCount"]    = oxrsLog.getRepeatedCount();
+
+    system["telemetryBacklogCount"]        = _telemetryBacklog.getCount();
+    system["telemetryBacklogSpilledCount"] = _telemetryBacklog.getSpilledCount();
+    system["telemetryDroppedCount"]        = _telemetryBacklog.getDroppedCount();
+
+    _supervisor.getLinkJson(system);
+    _apiConnections.getApiJson(system);
+
+    JsonObject bootPhases = system.createNestedObject("bootPhasesMs");
+    for (uint8_t phase = 0; phase < BOOT_PHASE_COUNT; phase++)
+        bootPhases[bootPhaseStr[phase]] = _bootPhase_ms[phase];
+}
+
+void OXRS_IO_PICO::writeMetrics(MetricsWriter& metrics)
+{
+    metrics.gauge("oxrs_uptime_seconds", "Time since boot", (int32_t)(millis() / 1000), 1);
+    metrics.gauge("oxrs_heap_used_bytes", "Heap in use", (uint32_t)rp2040.getUsedHeap());
+    metrics.gauge("oxrs_heap_free_bytes", "Heap free", (uint32_t)rp2040.getFreeHeap());
+    metrics.gauge("oxrs_heap_total_bytes", "Heap size", (uint32_t)rp2040.getTotalHeap());
+
+    metrics.gauge("oxrs_wifi_rssi_dbm", "Last sampled WiFi signal strength", _supervisor.getRssi(), 1);
+    metrics.describe("oxrs_link_state", "gauge", "WiFi and MQTT link state");
+    for (uint8_t state = 0; state < ConnectionSupervisor::STATE_COUNT; state++)
+        metrics.sample("oxrs_link_state", (uint32_t)(_supervisor.getState() == state),
+            "state", ConnectionSupervisor::stateStr[state]);
+
+    metrics.counter("oxrs_loop_total", "Loop passes", _loopCount);
+    metrics.gauge("oxrs_loop_max_seconds", "Longest loop pass in the last complete minute", (int32_t)_loopMaxLast_us, 1000000);
+
+    metrics.counter("oxrs_telemetry_published_total", "Telemetry published, live or from the backlog", _telemetryPublished);
+    metrics.gauge("oxrs_telemetry_backlog", "Telemetry waiting for MQTT", _telemetryBacklog.getCount());
+    metrics.counter("oxrs_telemetry_dropped_total", "Telemetry dropped with the backlog full", _telemetryBacklog.getDroppedCount());
+    metrics.counter("oxrs_log_dropped_total", "Log records dropped", oxrsLog.getDroppedCount());
+    metrics.counter("oxrs_api_requests_total", "REST API requests served", _apiConnections.getRequestCount());
+    metrics.counter("oxrs_api_rejected_total", "REST API requests rejected", _apiConnections.getRejectedCount());
+
+    if (_onMetrics)
+        _onMetrics(metrics);
 }
 
 void OXRS_IO_PICO::getNetworkJson(JsonVariant json)
@@ -379,6 +749,13 @@ void OXRS_IO_PICO::getConfigSchemaJson(JsonVariant json)
         mergeJson(props, _fwConfigSchema.as<JsonVariant>());
     }
 
+    // Live telemetry timestamps
+    JsonObject timestamp     = props.createNestedObject(TELEMETRY_TIMESTAMP_CONFIG);
+    timestamp["title"]       = "Timestamp Live Telemetry";
+    timestamp["description"] = "Add \"timestamp\" (epoch seconds), or \"ageMs\" if the clock is not set, to live telemetry. Telemetry replayed from the backlog always has it.";
+    timestamp["type"]        = "boolean";
+    timestamp["default"]     = _telemetryStampLive;
+
     // Append other config
     oxrsLog.setConfig(props);
 #ifdef __USE_OXRS_TIME_LIB
@@ -388,6 +765,7 @@ void OXRS_IO_PICO::getConfigSchemaJson(JsonVariant json)
 
 void OXRS_IO_PICO::setConfigSchema(JsonVariant json)
 {
+    _adoptCache.invalidate();
     _fwConfigSchema.clear();
     mergeJson(_fwConfigSchema.as<JsonVariant>(), json);
 }
@@ -417,21 +795,30 @@ void OXRS_IO_PICO::getCommandSchemaJson(JsonVariant json)
 
 void OXRS_IO_PICO::setCommandSchema(JsonVariant json)
 {
+    _adoptCache.invalidate();
     _fwCommandSchema.clear();
     mergeJson(_fwCommandSchema.as<JsonVariant>(), json);
 }
 
 void OXRS_IO_PICO::apiAdoptCallback(JsonVariant json)
 {
-    getFirmwareJson(json);
+    // built in full if a schema or config changed since the cache was refreshed
+    if (!_adoptCache.splice(json))
+    {
+        getFirmwareJson(json);
+        getConfigSchemaJson(json);
+        getCommandSchemaJson(json);
+    }
+
     getSystemJson(json);
     getNetworkJson(json);
-    getConfigSchemaJson(json);
-    getCommandSchemaJson(json);
 }
 
 void OXRS_IO_PICO::initialiseWatchdog()
 {
+    // lines logged before a warm reboot, whatever caused it
+    oxrsLog.replayRetained();
+
 #ifdef __WATCHDOG
     if (watchdog_caused_reboot())
     {
@@ -451,14 +838,21 @@ void OXRS_IO_PICO::initialiseTime()
 #endif
 }
 
+void OXRS_IO_PICO::onMetrics(metricsCallback metrics)
+{
+    _onMetrics = metrics;
+}
+
 void OXRS_IO_PICO::begin(jsonCallback config, jsonCallback command)
 {
 // FIXME: Move this to after initaliseNetwork?
     // add MQTT and other logging
     oxrsLog.addLogger(&_sysLogger);
     oxrsLog.addLogger(&_mqttLogger);
+    oxrsLog.addLogger(&_lokiLogger);
 
     LOG_DEBUG(F("begin"));
+    setBootPhase(BOOT_BEGIN);
 
     // get our firmware details
     DynamicJsonDocument json(256);
@@ -484,6 +878,9 @@ void OXRS_IO_PICO::begin(jsonCallback config, jsonCallback command)
     // setup the REST API
     initialiseRestApi();
 
+    // after the API has mounted LittleFS, drop any telemetry spilled before a reboot
+    _telemetryBacklog.begin();
+
     // setup watchdog
     initialiseWatchdog();
 
@@ -492,4 +889,7 @@ void OXRS_IO_PICO::begin(jsonCallback config, jsonCallback command)
 
     // setup ntp/tz
     initialiseTime();
+
+    // network, MQTT and API come up from loop()
+    setBootPhase(BOOT_READY);
 }
@@ -5,6 +5,10 @@
 
 #include <ArduinoJson.h>
 #include <OXRS_MQTT.h>
+#include <MetricsWriter.h>
+
+// Firmware metrics appended to /metrics, from cached values only
+typedef void (*metricsCallback)(MetricsWriter& metrics);
 
 /*
 Utility class to enable OXRS API, MQTT libraries and
@@ -15,9 +19,42 @@ class OXRS_IO_PICO
 public:
     OXRS_IO_PICO(bool useOnBoardTempSensor);
 
+    enum NetworkState_t {
+        NETWORK_DOWN=0,     // no saved credentials or the join failed, loop() starts the portal
+        NETWORK_JOINING,    // joining with the saved credentials, polled from loop()
+        NETWORK_PORTAL,     // captive portal served from loop() until WiFi joins
+        NETWORK_UP,         // joined once, reconnects are owned by the supervisor
+    };
+
+    inline static const uint32_t NETWORK_JOIN_TIMEOUT_MS = 30000;   // before the portal is started
+    inline static const uint32_t NETWORK_REJOIN_MS       = 10000;   // a rejoin is left to complete
+    inline static const uint32_t LINK_PUBLISH_MS         = 60000;   // link quality, on <telemetry topic>/link
+
+    // Boot milestones, timed to measure boot to first sample and publish
+    enum BootPhase_t {
+        BOOT_BEGIN=0,           // begin() called
+        BOOT_READY,             // begin() returned, sensing can start
+        BOOT_WIFI,              // WiFi joined
+        BOOT_MQTT,              // MQTT connected
+        BOOT_FIRST_TELEMETRY,   // first telemetry published or backlogged
+        BOOT_PHASE_COUNT
+    };
+
+    inline static const char *bootPhaseStr[] = {
+        "begin",
+        "ready",
+        "wifi",
+        "mqtt",
+        "firstTelemetry"
+    };
+
     void begin(jsonCallback config, jsonCallback command);
     void loop();
 
+    // Firmware can add its own Prometheus metrics to those of the device
+    void onMetrics(metricsCallback metrics);
+    static void writeMetrics(MetricsWriter& metrics);
+
     // Firmware can define the config/commands it supports - for device discovery and adoption
     void setConfigSchema(JsonVariant json);
     void setCommandSchema(JsonVariant json);
@@ -28,12 +65,22 @@ public:
 
     // Helper for publishing to tele/ topic
     void publishTelemetry(JsonVariant telemetry);
+    void publishTelemetry(const char* payload, size_t len);    // pre-serialised json
 
     static JsonVariant findNestedKey(JsonObject obj, const String &key);
     inline static const String RESTART_COMMAND = "restart";
+    inline static const String TELEMETRY_TIMESTAMP_CONFIG = "telemetryTimestamp";
+
+    inline static const uint8_t  TELEMETRY_DRAIN_BATCH    = 5;      // backlog published per period
+    inline static const uint32_t TELEMETRY_DRAIN_MS       = 1000;
+    inline static const uint8_t  TELEMETRY_DRAIN_ATTEMPTS = 3;      // before a rejected payload is dropped
+
+    inline static const uint32_t LOOP_WINDOW_MS = 60000;            // longest loop pass is reported per window
 
     float readOnboardTemperature(bool celsiusNotFahr = true);
 
+    static void setBootPhase(BootPhase_t phase);     // records the first time phase is reached
+
 private:
     void initialiseRestApi();
     void initialiseNetwork(byte *mac);
@@ -43,6 +90,16 @@ private:
     void initialiseTime();
 
     static boolean isNetworkConnected();
+    static bool loopNetwork();
+    static void rejoinNetwork();
+    static void networkJoined();
+
+    // Telemetry backlog
+    static void drainTelemetry();
+    static bool publishStamped(const char* payload, size_t len, uint32_t time_s, uint32_t time_ms);
+    static bool publishUnstamped(const char* payload, size_t len);
+    static bool publishSpliced(const char* fields, size_t fieldsLen, const char* payload, size_t len);
+    static void publishLink();
 
     // Config helpers
     static void getFirmwareJson(JsonVariant json);
@@ -0,0 +1,214 @@
+#include <LittleFS.h>
+#include <OXRS_LOG.h>
+#include <TelemetryBacklog.h>
+
+static const char *_LOG_PREFIX = "[TelemetryBacklog] ";
+
+TelemetryBacklog::TelemetryBacklog() :
+    _ramHead(0),
+    _ramTail(0),
+    _ramUsed(0),
+    _ramCount(0),
+    _fileSize(0),
+    _fileRead(0),
+    _fileCount(0),
+    _peekSize(0),
+    _peekFromFile(false),
+    _dropped(0)
+{
+};
+
+void TelemetryBacklog::begin()
+{
+    clearFile();
+}
+
+bool TelemetryBacklog::push(const char* payload, size_t len, uint32_t time_s, uint32_t time_ms)
+{
+    if (len == 0 || len > MAX_PAYLOAD_LEN)
+    {
+        _dropped++;
+        return false;
+    }
+
+    header_t header;
+    header.len     = len;
+    header.time_s  = time_s;
+    header.time_ms = time_ms;
+
+    // spilled payloads are older, newer ones must queue behind them
+    if ((_fileCount == 0 && pushRam(header, payload)) || pushFile(header, payload))
+        return true;
+
+    _dropped++;
+    LOG_WARN(F("Telemetry backlog full, dropped"));
+    return false;
+}
+
+bool TelemetryBacklog::pushRam(const header_t& header, const char* payload)
+{
+    if (RAM_SIZE - _ramUsed < sizeof(header) + header.len)
+        return false;
+
+    copyIn(&header, sizeof(header));
+    copyIn(payload, header.len);
+    _ramCount++;
+    return true;
+}
+
+bool TelemetryBacklog::pushFile(const header_t& header, const char* payload)
+{
+    if (_fileSize + sizeof(header) + header.len > FILE_MAX_SIZE)
+        return false;
+
+    File file = LittleFS.open(SEGMENT_FILE, "a");
+    if (!file)
+    {
+        LOG_ERROR(F("Failed to open telemetry backlog segment"));
+        return false;
+    }
+    size_t written = file.write((const uint8_t*)&header, sizeof(header));
+    written += file.write((const uint8_t*)payload, header.len);
+    file.close();
+
+    // a partial record would misalign every later one
+    if (written != sizeof(header) + header.len)
+    {
+        LOG_ERROR(F("Failed to write telemetry backlog segment"));
+        clearFile();
+        return false;
+    }
+
+    if (_fileCount == 0)
+        LOG_INFO(F("Telemetry backlog spilling to flash"));
+
+    _fileSize += written;
+    _fileCount++;
+    return true;
+}
+
+size_t TelemetryBacklog::peek(char* buffer, size_t size, uint32_t& time_s, uint32_t& time_ms)
+{
+    _peekSize = 0;
+    header_t header;
+
+    if (_ramCount)
+    {
+        copyOut(&header, 0, sizeof(header));
+        if (header.len > size)
+            return 0;
+        copyOut(buffer, sizeof(header), header.len);
+        _peekFromFile = false;
+    }
+    else if (_fileCount)
+    {
+        File file = LittleFS.open(SEGMENT_FILE, "r");
+        if (!file)
+            return 0;
+        bool ok = file.seek(_fileRead) &&
+            file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.len <= size &&
+            file.read((uint8_t*)buffer, header.len) == header.len;
+        file.close();
+
+        if (!ok)
+        {
+            LOG_ERROR(F("Corrupt telemetry backlog segment, discarded"));
+            _dropped += _fileCount;
+            clearFile();
+            return 0;
+        }
+        _peekFromFile = true;
+    }
+    else
+    {
+        return 0;
+    }
+
+    time_s    = header.time_s;
+    time_ms   = header.time_ms;
+    _peekSize = sizeof(header) + header.len;
+    return header.len;
+}
+
+void TelemetryBacklog::pop()
+{
+    if (_peekSize == 0)
+        return;
+
+    if (_peekFromFile)
+    {
+        _fileRead += _peekSize;
+        if (--_fileCount == 0)
+            clearFile();
+    }
+    else
+    {
+        _ramTail = (_ramTail + _peekSize) % RAM_SIZE;
+        _ramUsed -= _peekSize;
+        _ramCount--;
+    }
+    _peekSize = 0;
+}
+
+void TelemetryBacklog::drop()
+{
+    if (_peekSize == 0)
+        return;
+
+    pop();
+    _dropped++;
+}
+
+bool TelemetryBacklog::isEmpty() const
+{
+    return _ramCount == 0 && _fileCount == 0;
+}
+
+uint32_t TelemetryBacklog::getCount() const
+{
+    return _ramCount + _fileCount;
+}
+
+uint32_t TelemetryBacklog::getSpilledCount() const
+{
+    return _fileCount;
+}
+
+uint32_t TelemetryBacklog::getDroppedCount() const
+{
+    return _dropped;
+}
+
+// Append to the RAM ring, wrapping at its end
+void TelemetryBacklog::copyIn(const void* src, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)src;
+    size_t first = min(len, RAM_SIZE - _ramHead);
+    memcpy(_ram + _ramHead, p, first);
+    memcpy(_ram, p + first, len - first);
+    _ramHead = (_ramHead + len) % RAM_SIZE;
+    _ramUsed += len;
+}
+
+// Copy from offset bytes after the oldest byte of the RAM ring
+void TelemetryBacklog::copyOut(void* dst, size_t offset, size_t len) const
+{
+    uint8_t* p = (uint8_t*)dst;
+    size_t start = (_ramTail + offset) % RAM_SIZE;
+    size_t first = min(len, RAM_SIZE - start);
+    memcpy(p, _ram + start, first);
+    memcpy(p + first, _ram, len - first);
+}
+
+void TelemetryBacklog::clearFile()
+{
+    if (LittleFS.exists(SEGMENT_FILE))
+        LittleFS.remove(SEGMENT_FILE);
+    _fileSize  = 0;
+    _fileRead  = 0;
+    _fileCount = 0;
+
+    if (_peekFromFile)
+        _peekSize = 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+ * Bounded FIFO of telemetry payloads taken while MQTT is unavailable, each
+ * with the time it was sampled. Payloads fill a RAM ring first, then spill
+ * to a LittleFS segment file once the ring is full; while any are spilled
+ * new payloads also go to the file, so order is kept. When both are full
+ * new payloads are dropped and counted. The segment is removed once
+ * drained, and at begin() as its sample times do not survive a reboot.
+ */
+class TelemetryBacklog
+{
+public:
+    TelemetryBacklog();
+
+    inline static const size_t   RAM_SIZE        = 8192;    // bytes of headers and payloads
+    inline static const size_t   FILE_MAX_SIZE   = 65536;
+    inline static const uint16_t MAX_PAYLOAD_LEN = 1024;
+
+    void begin();
+
+    // Queue a payload sampled at time_s (epoch, 0 if the clock is not set)
+    // and time_ms (millis), false if dropped
+    bool push(const char* payload, size_t len, uint32_t time_s, uint32_t time_ms);
+
+    // Copy the oldest payload into buffer, returns its length, 0 if empty or
+    // it could not be read. pop() then removes it, or drop() if it could not
+    // be published, which counts it as dropped.
+    size_t peek(char* buffer, size_t size, uint32_t& time_s, uint32_t& time_ms);
+    void pop();
+    void drop();
+
+    bool isEmpty() const;
+    uint32_t getCount() const;              // payloads queued
+    uint32_t getSpilledCount() const;       // of which in the segment file
+    uint32_t getDroppedCount() const;       // payloads dropped since boot, full or rejected
+
+private:
+    inline static const char* SEGMENT_FILE = "/telemetry.seg";
+
+    typedef struct {
+        uint16_t len;
+        uint32_t time_s;
+        uint32_t time_ms;
+    } header_t;
+
+    bool pushRam(const header_t& header, const char* payload);
+    bool pushFile(const header_t& header, const char* payload);
+    void copyIn(const void* src, size_t len);
+    void copyOut(void* dst, size_t offset, size_t len) const;
+    void clearFile();
+
+    uint8_t  _ram[RAM_SIZE];
+    size_t   _ramHead;                  // next byte written
+    size_t   _ramTail;                  // oldest byte
+    size_t   _ramUsed;
+    uint32_t _ramCount;
+
+    uint32_t _fileSize;                 // bytes appended
+    uint32_t _fileRead;                 // bytes popped
+    uint32_t _fileCount;
+
+    size_t   _peekSize;                 // header and payload of the last peek, 0 if none
+    bool     _peekFromFile;
+    uint32_t _dropped;
+};
@@ -0,0 +1,10 @@
+# PlatformIO library build script.
+#
+# Native builds (pio test -e native) leave out the firmware glue, which
+# needs the Pico SDK, WiFiManager and the OXRS MQTT and REST API libraries,
+# and test the rest of the library on the host.
+
+Import("env")
+
+if env.get("PIOPLATFORM") == "native":
+    env.Replace(SRC_FILTER=["+<*>", "-<OXRS_IO_PICO.cpp>"])
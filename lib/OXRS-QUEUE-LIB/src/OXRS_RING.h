@@ -0,0 +1,109 @@
+/**
+ * OXRS-QUEUE
+ *
+ * Lock-free single producer/single consumer ring buffer that the producer
+ * may overrun. Unlike OXRS_SPSC the producer never waits on the consumer:
+ * when full, push() overwrites the oldest item and the consumer skips any
+ * items overwritten before (or while) it read them, counting them as lost.
+ *
+ * Each slot carries a sequence number so overwrites can be detected with
+ * atomic loads and stores alone (no read-modify-write, which the
+ * Cortex-M0+ does not support natively). Depends only on the C++ standard
+ * library so it can be built and stress tested on a host.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T, size_t N>
+class OXRS_RING
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "OXRS_RING capacity must be a power of 2");
+
+public:
+    OXRS_RING() : _head(0), _tail(0)
+    {
+        for (size_t i = 0; i < N; i++)
+            _slots[i].seq.store(0, std::memory_order_relaxed);
+    };
+
+    // prevent copy construction
+    OXRS_RING(const OXRS_RING&) = delete;
+    OXRS_RING& operator=(const OXRS_RING&) = delete;
+
+    // Producer: true if the next push() would overwrite an unread item
+    bool full() const
+    {
+        return _head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire) >= N;
+    }
+
+    // Producer: always succeeds, overwriting the oldest item if full
+    void push(const T& item)
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        Slot& slot = _slots[head & (N - 1)];
+
+        // odd while being written
+        slot.seq.store(2 * head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.item = item;
+        slot.seq.store(2 * head + 2, std::memory_order_release);
+
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    // Consumer: false if empty, lost is incremented by any items overwritten
+    // before they could be read
+    bool pop(T& item, uint32_t& lost)
+    {
+        for (;;)
+        {
+            uint32_t tail = _tail.load(std::memory_order_relaxed);
+            uint32_t head = _head.load(std::memory_order_acquire);
+            if (tail == head)
+                return false;
+
+            // producer lapped the consumer
+            if (head - tail > N)
+            {
+                lost += head - tail - N;
+                tail = head - N;
+            }
+
+            Slot& slot = _slots[tail & (N - 1)];
+            uint32_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq == 2 * tail + 2)
+            {
+                item = slot.item;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) == seq)
+                {
+                    _tail.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+
+            // overwritten since head was read
+            lost++;
+            _tail.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+private:
+    typedef struct {
+        std::atomic<uint32_t> seq;          // 2 * position + 2 once written
+        T item;
+    } Slot;
+
+    Slot _slots[N];
+    std::atomic<uint32_t> _head;            // next position to write, producer owned
+    std::atomic<uint32_t> _tail;            // next position to read, consumer owned
+};
@@ -0,0 +1,85 @@
+/**
+ * OXRS-QUEUE
+ *
+ * Lock-free single producer/single consumer ring buffer, for passing items
+ * between the two RP2040 cores (or a core and an interrupt) without locks.
+ *
+ * The producer only writes _head and the consumer only writes _tail, so
+ * only atomic loads and stores are needed (no read-modify-write, which the
+ * Cortex-M0+ does not support natively). Depends only on the C++ standard
+ * library so it can be built and stress tested on a host.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T, size_t N>
+class OXRS_SPSC
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "OXRS_SPSC capacity must be a power of 2");
+
+public:
+    OXRS_SPSC() : _head(0), _tail(0), _dropped(0) {};
+
+    // prevent copy construction
+    OXRS_SPSC(const OXRS_SPSC&) = delete;
+    OXRS_SPSC& operator=(const OXRS_SPSC&) = delete;
+
+    // Producer: false (and item counted as dropped) if full
+    bool push(const T& item)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= N)
+        {
+            _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: false if empty
+    bool pop(T& item)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+            return false;
+
+        item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with push/pop
+    size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+    // Items rejected by push because the queue was full
+    uint32_t dropped() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    T _items[N];                        // ring storage
+    std::atomic<size_t>   _head;        // next slot to write, producer owned
+    std::atomic<size_t>   _tail;        // next slot to read, consumer owned
+    std::atomic<uint32_t> _dropped;     // producer owned
+};
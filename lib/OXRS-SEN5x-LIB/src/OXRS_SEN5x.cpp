@@ -17,21 +17,96 @@
 
 static const char *_LOG_PREFIX = "[OXRS_SEN5x] ";
 
+// Field json keys, scale factors and config titles, indexed by SEN5x_field_t
+static const struct {
+    const char* key;
+    uint16_t    scale;
+    const char* title;
+} fields[SEN5x_FIELD_COUNT] = {
+    { "pm1p0",  SEN5x_PM_SCALE,          "PM1.0 (µg/m³)" },
+    { "pm2p5",  SEN5x_PM_SCALE,          "PM2.5 (µg/m³)" },
+    { "pm4p0",  SEN5x_PM_SCALE,          "PM4.0 (µg/m³)" },
+    { "pm10p0", SEN5x_PM_SCALE,          "PM10.0 (µg/m³)" },
+    { "hum",    SEN5x_HUMIDITY_SCALE,    "Humidity (%)" },
+    { "temp",   SEN5x_TEMPERATURE_SCALE, "Temperature (°C)" },
+    { "vox",    SEN5x_INDEX_SCALE,       "VOC Index" },
+    { "nox",    SEN5x_INDEX_SCALE,       "NOx Index" },
+};
+
+// 1 µg/m³, 1 %RH, 0.2 °C and 5 index points
+static const int32_t DEFAULT_DEADBAND[SEN5x_FIELD_COUNT] = { 10, 10, 10, 10, 100, 40, 50, 50 };
+
+// Persisted state is timestamped, so needs the clock to have been set by NTP
+static bool isClockValid()
+{
+    return time(nullptr) > 1672531200;     // 2023-01-01
+}
+
 OXRS_SEN5x::OXRS_SEN5x(SEN5x_model_t model) :
     _model(model),
     _deviceStatus(model),
     _publishTelemetry_ms(DEFAULT_PUBLISH_TELEMETRY_MS),
-    _tempOffset_celsius(DEFAULT_TEMP_OFFSET_C),
     _lastPublishTelemetry_ms(0),
-    _deviceReady(false)
+    _lastSample_ms(0),
+    _commandIssued_ms(0),
+    _commandExecution_ms(CMD_EXECUTION_MS),
+    _verifyConfig_ms(DEFAULT_VERIFY_CONFIG_MS),
+    _lastVerifyConfig_ms(0),
+    _configSeq(0),
+    _configSeqSeen(0),
+    _configDirty(0),
+    _configItem(0),
+    _verifyPending(0),
+    _verifyMismatch(0),
+    _i2cTransactions(0),
+    _i2cTransactionsPerMinute(0),
+    _i2cWindowStart_ms(0),
+    _wire(nullptr),
+    _deviceReady(false),
+    _measuring(false),
+    _resetPending(false),
+    _acqState(ACQ_IDLE),
+    _hasLatest(false),
+    _windowSamples(0),
+    _statistics(DEFAULT_STATISTICS),
+    _deadbandEnabled(false),
+    _hasPublished(false),
+    _maxSilence_ms(DEFAULT_MAX_SILENCE_MS),
+    _lastSent_ms(0),
+    _publishedCount(0),
+    _suppressedCount(0),
+    _vocStateSnapshot_ms(DEFAULT_VOC_STATE_SNAPSHOT_MS),
+    _vocStateMaxAge_s(DEFAULT_VOC_STATE_MAX_AGE_S),
+    _lastVocStateSnapshot_ms(0),
+    _vocStateRestorePending(false),
+    _vocStateRestored(false),
+    _vocStateRestoreAge_s(0),
+    _vocIndexPending(false),
+    _measurementStart_ms(0)
 {
+    _config.tempOffset_celsius  = DEFAULT_TEMP_OFFSET_C;
+    _config.warmStart           = DEFAULT_WARM_START;
+    _config.rhtAccelerationMode = DEFAULT_RHT_ACCELERATION;
+    _config.vocTuning           = DEFAULT_VOC_TUNING;
+    _config.noxTuning           = DEFAULT_NOX_TUNING;
+    _deviceConfig = _config;
+    _configWritten = _config;
+
+    for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+    {
+        _deadband[f].absolute = DEFAULT_DEADBAND[f];
+        _deadband[f].relative = 0;
+        _lastPublished[f] = 0;
+    }
 };
 
 void OXRS_SEN5x::begin(TwoWire &wire)
 {
     // assumes Wire.begin() has been called prior
-    _sensor.begin(Wire);
+    _wire = &wire;
+    _sensor.begin(wire);
 
+    trackI2C();
     Error_t error = _sensor.deviceReset();
     if (error)
     {
@@ -59,116 +134,666 @@ void OXRS_SEN5x::begin(TwoWire &wire)
 
 void OXRS_SEN5x::initialiseDevice()
 {
-    if (_model != SEN50)
+    // Sensor configuration is lost on reset, so loop() writes the full shadow
+    // while still idle and then starts measurement
+    _measuring = false;
+    markConfigDirty(CONFIG_ALL);
+
+    // VOC algorithm state is also lost on reset and can only be restored
+    // while idle, if the clock is not yet valid loop() retries shortly
+    _vocStateRestored = false;
+    _vocStateRestorePending = _vocStateSnapshot_ms > 0 && hasField(SEN5x_VOC);
+    if (_vocStateRestorePending && isClockValid())
+        restoreVocState();
+
+    _measurementStart_ms = millis();
+    _lastVocStateSnapshot_ms = millis();
+    _vocIndexPending = hasField(SEN5x_VOC);
+}
+
+void OXRS_SEN5x::loop()
+{
+    if (!_deviceReady)
+        return;
+
+    pollConfig();
+    processCommands();
+
+    // Write any configuration changed via onConfig, but never while an
+    // acquisition command is in flight or still executing. Writes and read
+    // backs then continue from acquire() a command at a time, like
+    // acquisition itself.
+    if (_acqState == ACQ_IDLE && !isCommandExecuting())
     {
-        // Adjust tempOffset to account for additional temperature offsets
-        // exceeding the SEN module's self heating.
-        setTemperatureOffset();
+        if (_resetPending)
+        {
+            resetDevice();
+        }
+        else if (_configDirty || !_measuring)
+        {
+            writeConfig();
+        }
+        else if (_verifyConfig_ms > 0 && (millis() - _lastVerifyConfig_ms) > _verifyConfig_ms)
+        {
+            beginVerifyConfig();
+        }
+        else if (_vocStateRestorePending)
+        {
+            if (isClockValid())
+            {
+                restoreVocState();
+            }
+            else if ((millis() - _measurementStart_ms) > VOC_STATE_RESTORE_WINDOW_MS)
+            {
+                LOG_WARN(F("No valid clock, VOC algorithm state not restored"));
+                _vocStateRestorePending = false;
+            }
+        }
+        else if (canSnapshotVocState() && (millis() - _lastVocStateSnapshot_ms) > _vocStateSnapshot_ms)
+        {
+            snapshotVocState();
+        }
     }
 
-    // Start Measurement
-    Error_t error = _sensor.startMeasurement();
+    acquire();
+
+    // Roll i2c transaction window
+    if ((millis() - _i2cWindowStart_ms) >= I2C_STATS_WINDOW_MS)
+    {
+        _i2cTransactionsPerMinute = _i2cTransactions;
+        _i2cTransactions = 0;
+        _i2cWindowStart_ms = millis();
+        LOGF_DEBUG("i2c transactions per minute: %" PRIu32 "", _i2cTransactionsPerMinute);
+    }
+}
+
+/*
+ * Only persist state once the VOC index is valid and any pending restore is
+ * done, otherwise a freshly reset (still learning) algorithm would overwrite
+ * good state before it could be restored.
+ */
+bool OXRS_SEN5x::canSnapshotVocState() const
+{
+    return _vocStateSnapshot_ms > 0 && hasField(SEN5x_VOC) &&
+        !_vocStateRestorePending && !_vocIndexPending && isClockValid();
+}
+
+// Issue a read of the VOC algorithm state, saved by acquire() once executed
+void OXRS_SEN5x::snapshotVocState()
+{
+    _lastVocStateSnapshot_ms = millis();
+
+    Error_t error = sendCommand(CMD_VOC_STATE);
     if (error)
     {
-        logError(error, F("Error trying to execute startMeasurement():"));
+        logError(error, F("Error trying to execute getVocAlgorithmState():"));
+        return;
     }
+    _acqState = ACQ_VOC_STATE;
 }
 
-OXRS_SEN5x::Error_t OXRS_SEN5x::getMeasurements(SEN5x_telemetry_t &t)
+void OXRS_SEN5x::saveVocState()
 {
-    return _sensor.readMeasuredValues(t.pm1p0, t.pm2p5, t.pm4p0, t.pm10p0,
-        t.humidityPercent, t.tempCelsuis, t.vocIndex, t.noxIndex);
+    // 4 words and their crc
+    uint8_t buffer[12];
+    SensirionI2CRxFrame rxFrame(buffer, sizeof(buffer));
+    uint8_t state[SEN5xVocState::STATE_SIZE];
+    Error_t error = receiveResponse(rxFrame, sizeof(buffer));
+    if (!error)
+        error = rxFrame.getBytes(state, SEN5xVocState::STATE_SIZE);
+    if (error)
+    {
+        logError(error, F("Error trying to execute getVocAlgorithmState():"));
+        return;
+    }
+
+    if (_vocState.save(state, time(nullptr)))
+        LOG_DEBUG(F("VOC algorithm state saved"));
 }
 
-void OXRS_SEN5x::loop()
+/*
+ * Restore persisted VOC algorithm state if fresh enough. The sensor only
+ * accepts state while idle, so it is written along with the idle only
+ * configuration, with measurement stopped and restarted around it if running.
+ */
+void OXRS_SEN5x::restoreVocState()
 {
-    if (!_deviceReady)
+    _vocStateRestorePending = false;
+
+    uint8_t state[SEN5xVocState::STATE_SIZE];
+    time_t timestamp;
+    if (!_vocState.load(state, timestamp))
+    {
+        LOG_INFO(F("No saved VOC algorithm state"));
         return;
+    }
 
-    if (_model != SEN50)
-    { // must be done post begin
-        float current_offset;
-        Error_t error = _sensor.getTemperatureOffsetSimple(current_offset);
+    time_t age = time(nullptr) - timestamp;
+    if (age < 0 || (uint32_t)age > _vocStateMaxAge_s)
+    {
+        LOGF_INFO("Saved VOC algorithm state too old to restore (%" PRId32 " seconds)", (int32_t)age);
+        return;
+    }
+
+    memcpy(_vocStateRestore, state, SEN5xVocState::STATE_SIZE);
+    _vocStateRestoreAge_s = (int32_t)age;
+    markConfigDirty(CONFIG_VOC_STATE);
+}
+
+// Report how long the VOC index took to become valid after measurement started
+void OXRS_SEN5x::trackFirstVocIndex(const SEN5x_telemetry_t& t)
+{
+    if (!_vocIndexPending || t.vocIndex == SEN5x_UNKNOWN)
+        return;
+
+    _vocIndexPending = false;
+    LOGF_INFO("First valid VOC index after %" PRIu32 " ms, algorithm state %s",
+        millis() - _measurementStart_ms, _vocStateRestored ? "restored" : "not restored");
+}
+
+void OXRS_SEN5x::trackI2C(uint16_t transactions)
+{
+    _i2cTransactions += transactions;
+}
+
+uint32_t OXRS_SEN5x::getI2CTransactionsPerMinute() const
+{
+    return _i2cTransactionsPerMinute;
+}
+
+// Configuration items applicable to the connected model
+uint8_t OXRS_SEN5x::supportedConfig() const
+{
+    switch (_model)
+    {
+    case SEN50:
+        return 0;
+    case SEN54:
+        return (CONFIG_ALL | CONFIG_VOC_STATE) & ~CONFIG_NOX_TUNING;
+    default:
+        return CONFIG_ALL | CONFIG_VOC_STATE;
+    }
+}
+
+void OXRS_SEN5x::markConfigDirty(uint8_t items)
+{
+    _configDirty |= (items & supportedConfig());
+}
+
+static bool tuningEqual(const SEN5x_algorithm_tuning_t& a, const SEN5x_algorithm_tuning_t& b)
+{
+    return a.indexOffset == b.indexOffset &&
+        a.learningTimeOffsetHours == b.learningTimeOffsetHours &&
+        a.learningTimeGainHours == b.learningTimeGainHours &&
+        a.gatingMaxDurationMinutes == b.gatingMaxDurationMinutes &&
+        a.stdInitial == b.stdInitial &&
+        a.gainFactor == b.gainFactor;
+}
+
+/*
+ * _config is only written by onConfig and only read here, guarded by a
+ * sequence count that is odd while an update is in progress. loop() takes a
+ * copy when the count is even and unchanged across the copy, so it never
+ * blocks on (or writes to the sensor from) a half applied update.
+ */
+void OXRS_SEN5x::beginConfigUpdate()
+{
+    _configSeq.store(_configSeq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void OXRS_SEN5x::endConfigUpdate()
+{
+    _configSeq.store(_configSeq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void OXRS_SEN5x::pollConfig()
+{
+    uint32_t seq = _configSeq.load(std::memory_order_acquire);
+    if ((seq & 1) || seq == _configSeqSeen)
+        return;
+
+    SEN5x_config_t config = _config;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_configSeq.load(std::memory_order_relaxed) != seq)
+        return;     // updated during copy, retry next loop
+
+    _configSeqSeen = seq;
+    _deviceConfig = config;
+
+    uint8_t changed = 0;
+    if (config.tempOffset_celsius != _configWritten.tempOffset_celsius)
+        changed |= CONFIG_TEMP_OFFSET;
+    if (config.warmStart != _configWritten.warmStart)
+        changed |= CONFIG_WARM_START;
+    if (config.rhtAccelerationMode != _configWritten.rhtAccelerationMode)
+        changed |= CONFIG_RHT_ACCELERATION;
+    if (!tuningEqual(config.vocTuning, _configWritten.vocTuning))
+        changed |= CONFIG_VOC_TUNING;
+    if (!tuningEqual(config.noxTuning, _configWritten.noxTuning))
+        changed |= CONFIG_NOX_TUNING;
+    markConfigDirty(changed);
+}
+
+/*
+ * Write dirty configuration items to the sensor, a command per call. Warm
+ * start, RH/T acceleration, algorithm tuning and algorithm state can only be
+ * written in idle mode, so measurement is stopped ahead of them and started
+ * again once everything is written. Called from loop() to begin and from
+ * acquire() as each command's execution time passes.
+ */
+void OXRS_SEN5x::writeConfig()
+{
+    Error_t error;
+    if (_measuring && (_configDirty & CONFIG_IDLE_ONLY))
+    {
+        error = sendCommand(CMD_STOP_MEASUREMENT, STOP_MEASUREMENT_MS);
+        if (error)
+        {
+            // failed writes are not retried until the next config change or verify
+            logError(error, F("Error trying to execute stopMeasurement():"));
+            _configDirty &= ~CONFIG_IDLE_ONLY;
+            finishAcquisition();
+            return;
+        }
+        _measuring = false;
+        _acqState = ACQ_CONFIG_STOP;
+        return;
+    }
+
+    if (_configDirty)
+    {
+        // lowest item first
+        uint8_t item = _configDirty & -_configDirty;
+        _configDirty &= ~item;
+        writeConfigItem(item);
+        _acqState = ACQ_CONFIG_WRITE;
+        return;
+    }
+
+    _lastVerifyConfig_ms = millis();
+
+    if (!_measuring)
+    {
+        error = sendCommand(CMD_START_MEASUREMENT, START_MEASUREMENT_MS);
+        if (error)
+            logError(error, F("Error trying to execute startMeasurement():"));
+        _measuring = true;
+        _acqState = ACQ_CONFIG_START;
+        return;
+    }
+
+    finishAcquisition();
+}
+
+// Get and set command of a CONFIG_* item
+uint16_t OXRS_SEN5x::configCommand(uint8_t item)
+{
+    switch (item)
+    {
+    case CONFIG_TEMP_OFFSET:        return CMD_TEMPERATURE_OFFSET;
+    case CONFIG_WARM_START:         return CMD_WARM_START;
+    case CONFIG_RHT_ACCELERATION:   return CMD_RHT_ACCELERATION;
+    case CONFIG_VOC_TUNING:         return CMD_VOC_TUNING;
+    case CONFIG_NOX_TUNING:         return CMD_NOX_TUNING;
+    default:                        return CMD_VOC_STATE;
+    }
+}
+
+// Issue the set command of a configuration item, refer SensirionI2CSen5x
+OXRS_SEN5x::Error_t OXRS_SEN5x::writeConfigItem(uint8_t item)
+{
+    // command, up to 6 words and their crc
+    uint8_t buffer[20];
+    SensirionI2CTxFrame txFrame = SensirionI2CTxFrame::createWithUInt16Command(configCommand(item), buffer, sizeof(buffer));
+    Error_t error = 0;
+
+    switch (item)
+    {
+    case CONFIG_TEMP_OFFSET:
+        // Adjust tempOffset to account for additional temperature offsets
+        // exceeding the SEN module's self heating, no slope or time constant.
+        error |= txFrame.addInt16((int16_t)lroundf(_deviceConfig.tempOffset_celsius * 200));
+        error |= txFrame.addInt16(0);
+        error |= txFrame.addUInt16(0);
+        break;
+
+    case CONFIG_WARM_START:
+        error |= txFrame.addUInt16(_deviceConfig.warmStart);
+        break;
+
+    case CONFIG_RHT_ACCELERATION:
+        error |= txFrame.addUInt16(_deviceConfig.rhtAccelerationMode);
+        break;
+
+    case CONFIG_VOC_TUNING:
+    case CONFIG_NOX_TUNING:
+    {
+        const SEN5x_algorithm_tuning_t& t = item == CONFIG_VOC_TUNING ? _deviceConfig.vocTuning : _deviceConfig.noxTuning;
+        error |= txFrame.addInt16(t.indexOffset);
+        error |= txFrame.addInt16(t.learningTimeOffsetHours);
+        error |= txFrame.addInt16(t.learningTimeGainHours);
+        error |= txFrame.addInt16(t.gatingMaxDurationMinutes);
+        error |= txFrame.addInt16(t.stdInitial);
+        error |= txFrame.addInt16(t.gainFactor);
+        break;
+    }
+
+    case CONFIG_VOC_STATE:
+        error |= txFrame.addBytes(_vocStateRestore, SEN5xVocState::STATE_SIZE);
+        break;
+
+    default:
+        return 0;
+    }
+
+    if (!error)
+        error = sendFrame(txFrame, CMD_EXECUTION_MS);
+
+    // the sensor acknowledging the frame is all there is to confirm a set
+    switch (item)
+    {
+    case CONFIG_TEMP_OFFSET:
         if (error) {
-            logError(error, F("Failed to getTemperatureOffsetSimple():"));
+            logError(error, F("Error trying to execute setTemperatureOffsetSimple():"));
         }
         else {
-            if (current_offset != _tempOffset_celsius) {
-                // tempoffset has changed, update sensor
-                setTemperatureOffset();
-            }
+            _configWritten.tempOffset_celsius = _deviceConfig.tempOffset_celsius;
+            LOGF_DEBUG("Set temperature offset: %.02f celsius", _deviceConfig.tempOffset_celsius);
+        }
+        break;
+
+    case CONFIG_WARM_START:
+        if (error) {
+            logError(error, F("Error trying to execute setWarmStartParameter():"));
+        }
+        else {
+            _configWritten.warmStart = _deviceConfig.warmStart;
+            LOGF_DEBUG("Set warm start parameter: %" PRIu16 "", _deviceConfig.warmStart);
+        }
+        break;
+
+    case CONFIG_RHT_ACCELERATION:
+        if (error) {
+            logError(error, F("Error trying to execute setRhtAccelerationMode():"));
+        }
+        else {
+            _configWritten.rhtAccelerationMode = _deviceConfig.rhtAccelerationMode;
+            LOGF_DEBUG("Set RH/T acceleration mode: %" PRIu16 "", _deviceConfig.rhtAccelerationMode);
+        }
+        break;
+
+    case CONFIG_VOC_TUNING:
+        if (error) {
+            logError(error, F("Error trying to execute setVocAlgorithmTuningParameters():"));
+        }
+        else {
+            _configWritten.vocTuning = _deviceConfig.vocTuning;
+            LOG_DEBUG(F("Set VOC algorithm tuning parameters"));
+        }
+        break;
+
+    case CONFIG_NOX_TUNING:
+        if (error) {
+            logError(error, F("Error trying to execute setNoxAlgorithmTuningParameters():"));
+        }
+        else {
+            _configWritten.noxTuning = _deviceConfig.noxTuning;
+            LOG_DEBUG(F("Set NOx algorithm tuning parameters"));
+        }
+        break;
+
+    case CONFIG_VOC_STATE:
+        if (error) {
+            logError(error, F("Error trying to execute setVocAlgorithmState():"));
+        }
+        else {
+            _vocStateRestored = true;
+            LOGF_INFO("Restored VOC algorithm state saved %" PRId32 " seconds ago", _vocStateRestoreAge_s);
         }
+        break;
     }
+    return error;
 }
 
-// Set temperature offset
-void OXRS_SEN5x::setTemperatureOffset()
+/*
+ * Low rate read back of the sensor configuration, any item that differs from
+ * the shadow (e.g. following a sensor brown out) is marked dirty and rewritten.
+ * Items are read back a command at a time by verifyConfig(), from acquire().
+ */
+void OXRS_SEN5x::beginVerifyConfig()
+{
+    _lastVerifyConfig_ms = millis();
+    _verifyPending = supportedConfig() & CONFIG_ALL;
+    _verifyMismatch = 0;
+    verifyConfig();
+}
+
+// Issue the get command of the next item to read back, idle once all are read
+void OXRS_SEN5x::verifyConfig()
 {
-    Error_t error = _sensor.setTemperatureOffsetSimple(_tempOffset_celsius);
+    if (!_verifyPending)
+    {
+        if (_verifyMismatch)
+        {
+            LOGF_WARN("Sensor configuration mismatch 0x%02x, rewriting", _verifyMismatch);
+            markConfigDirty(_verifyMismatch);
+        }
+        finishAcquisition();
+        return;
+    }
+
+    // lowest item first
+    _configItem = _verifyPending & -_verifyPending;
+    _verifyPending &= ~_configItem;
+
+    Error_t error = sendCommand(configCommand(_configItem));
     if (error)
     {
-        logError(error, F("Error trying to execute setTemperatureOffsetSimple():"));
+        // skip this item, the rest are still read back
+        logError(error, F("Error trying to read back configuration:"));
+        _configItem = 0;
     }
-    else
+    _acqState = ACQ_CONFIG_VERIFY;
+}
+
+// Compare the read back item in flight with the shadow
+void OXRS_SEN5x::checkConfigItem()
+{
+    if (!_configItem)
+        return;
+
+    uint8_t buffer[18];
+    size_t size = (_configItem == CONFIG_VOC_TUNING || _configItem == CONFIG_NOX_TUNING) ? 18 :
+                  (_configItem == CONFIG_TEMP_OFFSET) ? 9 : 3;
+    SensirionI2CRxFrame rxFrame(buffer, sizeof(buffer));
+    Error_t error = receiveResponse(rxFrame, size);
+    if (error)
     {
-        LOGF_DEBUG("Set temperature offset: %.02f celsius", _tempOffset_celsius);
+        logError(error, F("Error trying to read back configuration:"));
+        return;
     }
+
+    bool match = true;
+    switch (_configItem)
+    {
+    case CONFIG_TEMP_OFFSET:
+    {
+        // sensor stores offset scaled by 200
+        int16_t offset = 0;
+        error = rxFrame.getInt16(offset);
+        match = offset == lroundf(_configWritten.tempOffset_celsius * 200);
+        break;
+    }
+
+    case CONFIG_WARM_START:
+    {
+        uint16_t warmStart = 0;
+        error = rxFrame.getUInt16(warmStart);
+        match = warmStart == _configWritten.warmStart;
+        break;
+    }
+
+    case CONFIG_RHT_ACCELERATION:
+    {
+        uint16_t mode = 0;
+        error = rxFrame.getUInt16(mode);
+        match = mode == _configWritten.rhtAccelerationMode;
+        break;
+    }
+
+    case CONFIG_VOC_TUNING:
+    case CONFIG_NOX_TUNING:
+    {
+        SEN5x_algorithm_tuning_t t;
+        error |= rxFrame.getInt16(t.indexOffset);
+        error |= rxFrame.getInt16(t.learningTimeOffsetHours);
+        error |= rxFrame.getInt16(t.learningTimeGainHours);
+        error |= rxFrame.getInt16(t.gatingMaxDurationMinutes);
+        error |= rxFrame.getInt16(t.stdInitial);
+        error |= rxFrame.getInt16(t.gainFactor);
+        match = tuningEqual(t, _configItem == CONFIG_VOC_TUNING ? _configWritten.vocTuning : _configWritten.noxTuning);
+        break;
+    }
+    }
+
+    if (!error && !match)
+        _verifyMismatch |= _configItem;
 }
 
-double OXRS_SEN5x::round2dp(float value) const
+// Issue an i2c command without waiting for its execution time
+OXRS_SEN5x::Error_t OXRS_SEN5x::sendCommand(uint16_t command, uint32_t execution_ms)
 {
-    return (std::isnan(value)) ? 0 : (int)(value * 100 + 0.5) / 100.0;
+    uint8_t buffer[2];
+    SensirionI2CTxFrame txFrame = SensirionI2CTxFrame::createWithUInt16Command(command, buffer, 2);
+    return sendFrame(txFrame, execution_ms);
 }
 
-void OXRS_SEN5x::telemetryAsJson(const SEN5x_telemetry_t& t, JsonVariant json) const
+// Issue an i2c command with arguments, also without waiting
+OXRS_SEN5x::Error_t OXRS_SEN5x::sendFrame(SensirionI2CTxFrame& txFrame, uint32_t execution_ms)
 {
-    // Refer https://sensirion.com/media/documents/6791EFA0/62A1F68F/Sensirion_Datasheet_Environmental_Node_SEN5x.pdf
-    // as to which models have which capabilities
-    json["pm1p0"] = round2dp(t.pm1p0);
-    json["pm2p5"] = round2dp(t.pm2p5);
-    json["pm4p0"] = round2dp(t.pm4p0);
-    json["pm10p0"] = round2dp(t.pm10p0);
+    trackI2C();
+    Error_t error = SensirionI2CCommunication::sendFrame(SEN5X_I2C_ADDRESS, txFrame, *_wire);
+    _commandIssued_ms = millis();
+    _commandExecution_ms = execution_ms;
+    return error;
+}
 
-    if (_model != SEN50)
-    {
-        json["hum"] = round2dp(t.humidityPercent);
-        json["temp"] = round2dp(t.tempCelsuis);
-        json["vox"] = round2dp(t.vocIndex);
-    }
+// Read the response of the command in flight, size includes crc bytes
+OXRS_SEN5x::Error_t OXRS_SEN5x::receiveResponse(SensirionI2CRxFrame& rxFrame, size_t size)
+{
+    return SensirionI2CCommunication::receiveFrame(SEN5X_I2C_ADDRESS, size, rxFrame, *_wire);
+}
 
-    if (_model == SEN55)
-        json["nox"] = round2dp(t.noxIndex); 
+// Refer SensirionI2CSen5x::readMeasuredValuesAsIntegers
+OXRS_SEN5x::Error_t OXRS_SEN5x::parseMeasuredValues(SensirionI2CRxFrame& rxFrame, SEN5x_telemetry_t& t)
+{
+    Error_t error = 0;
+    error |= rxFrame.getUInt16(t.pm1p0);
+    error |= rxFrame.getUInt16(t.pm2p5);
+    error |= rxFrame.getUInt16(t.pm4p0);
+    error |= rxFrame.getUInt16(t.pm10p0);
+    error |= rxFrame.getInt16(t.humidityPercent);
+    error |= rxFrame.getInt16(t.tempCelsuis);
+    error |= rxFrame.getInt16(t.vocIndex);
+    error |= rxFrame.getInt16(t.noxIndex);
+    return error;
 }
 
-// Get telemetry from AQS
-void OXRS_SEN5x::getTelemetry(JsonVariant json)
+void OXRS_SEN5x::finishAcquisition()
+{
+    _acqState = ACQ_IDLE;
+}
+
+// Blocking commands must not interleave with a command in flight. The
+// command's execution deadline is kept, the next command waits for it.
+void OXRS_SEN5x::abortAcquisition()
+{
+    _acqState = ACQ_IDLE;
+}
+
+// The sensor does not take another command until the last has executed
+bool OXRS_SEN5x::isCommandExecuting() const
+{
+    return (millis() - _commandIssued_ms) < _commandExecution_ms;
+}
+
+/*
+ * Tick driven acquisition of device status, data ready and measured values,
+ * and of the configuration writes and read backs begun by loop(). Each call
+ * either issues a command or reads back the result of the command in flight
+ * once its execution time has passed; it never waits on the sensor.
+ */
+void OXRS_SEN5x::acquire()
 {
-    // Do not publish if telemetry has been disabled
-    if (_publishTelemetry_ms == 0) {
-        LOG_INFO(F("Telemetry disabled"));
+    // come back once the command in flight, or one abandoned by
+    // abortAcquisition(), has executed
+    if (isCommandExecuting())
+        return;
+
+    if (_acqState == ACQ_IDLE)
+    {
+        // Sample every second while telemetry is enabled
+        if (_publishTelemetry_ms == 0 || (millis() - _lastSample_ms) < SAMPLE_INTERVAL_MS)
+            return;
+
+        _lastSample_ms = millis();
+        Error_t error = sendCommand(CMD_READ_DEVICE_STATUS);
+        if (error) {
+            logError(error, F("Failed to referesh device status:"));
+            finishAcquisition();
+            return;
+        }
+        _acqState = ACQ_DEVICE_STATUS;
         return;
     }
 
-    // Check if time passed is enough to publish
-    if ((millis() - _lastPublishTelemetry_ms) > _publishTelemetry_ms) {
-        // check device status
-        Error_t error = refreshDeviceStatus();
+    switch (_acqState)
+    {
+    case ACQ_DEVICE_STATUS:
+    {
+        uint8_t buffer[6];
+        SensirionI2CRxFrame rxFrame(buffer, 6);
+        uint32_t reg;
+        Error_t error = receiveResponse(rxFrame, 6);
+        if (!error)
+            error = rxFrame.getUInt32(reg);
         if (error) {
             logError(error, F("Failed to referesh device status:"));
-            _lastPublishTelemetry_ms = millis();
+            finishAcquisition();
             return;
         }
 
+        _deviceStatus.setRegister(reg);
         if (_deviceStatus.hasIssue()) {
             _deviceStatus.logStatus();
         }
 
         // check device is dataready
-        bool dataReady;
-        error = _sensor.readDataReady(dataReady);
+        error = sendCommand(CMD_READ_DATA_READY);
         if (error) {
             logError(error, F("Failed to get dataready state"));
-            _lastPublishTelemetry_ms = millis();
+            finishAcquisition();
+            return;
+        }
+        _acqState = ACQ_DATA_READY;
+        break;
+    }
+
+    case ACQ_DATA_READY:
+    {
+        uint8_t buffer[3];
+        SensirionI2CRxFrame rxFrame(buffer, 3);
+        uint8_t padding;
+        bool dataReady = false;
+        Error_t error = receiveResponse(rxFrame, 3);
+        if (!error) {
+            error |= rxFrame.getUInt8(padding);
+            error |= rxFrame.getBool(dataReady);
+        }
+        if (error) {
+            logError(error, F("Failed to get dataready state"));
+            finishAcquisition();
             return;
         }
 
@@ -177,24 +802,257 @@ void OXRS_SEN5x::getTelemetry(JsonVariant json)
                 LOG_DEBUG(F("Device data not ready as fan cleaning active"));
             else
                 LOG_DEBUG(F("Device data not ready"));
-            _lastPublishTelemetry_ms = millis();
+            finishAcquisition();
             return;
         }
 
-        LOG_DEBUG(F("Taking measurements"));
-        SEN5x_telemetry_t t;
-        error = getMeasurements(t);
+        error = sendCommand(CMD_READ_MEASURED_VALUES);
         if (error) {
             logError(error, F("Failed to get measurements"));
-            _lastPublishTelemetry_ms = millis();
+            finishAcquisition();
             return;
         }
+        _acqState = ACQ_MEASURED_VALUES;
+        break;
+    }
+
+    case ACQ_MEASURED_VALUES:
+    {
+        uint8_t buffer[24];
+        SensirionI2CRxFrame rxFrame(buffer, 24);
+        Error_t error = receiveResponse(rxFrame, 24);
+        if (!error)
+            error = parseMeasuredValues(rxFrame, _sample.telemetry);
+        if (error) {
+            logError(error, F("Failed to get measurements"));
+            finishAcquisition();
+            return;
+        }
+
+        trackFirstVocIndex(_sample.telemetry);
+
+        // published from the other side of the queue by getTelemetry()
+        _sample.timestamp_ms = millis();
+        if (!_samples.push(_sample))
+            LOG_WARN(F("Sample queue full, sample dropped"));
+        finishAcquisition();
+        break;
+    }
+
+    case ACQ_CONFIG_STOP:
+    case ACQ_CONFIG_WRITE:
+        writeConfig();
+        break;
+
+    case ACQ_CONFIG_START:
+        finishAcquisition();
+        break;
+
+    case ACQ_CONFIG_VERIFY:
+        checkConfigItem();
+        verifyConfig();
+        break;
+
+    case ACQ_VOC_STATE:
+        saveVocState();
+        finishAcquisition();
+        break;
+
+    default:
+        finishAcquisition();
+        break;
+    }
+}
+
+// Scaled value of a field, false if the sensor reported it as unknown
+static bool fieldValue(const SEN5x_telemetry_t& t, SEN5x_field_t field, int32_t& value)
+{
+    switch (field)
+    {
+    case SEN5x_PM1P0:       value = t.pm1p0;  return t.pm1p0  != SEN5x_PM_UNKNOWN;
+    case SEN5x_PM2P5:       value = t.pm2p5;  return t.pm2p5  != SEN5x_PM_UNKNOWN;
+    case SEN5x_PM4P0:       value = t.pm4p0;  return t.pm4p0  != SEN5x_PM_UNKNOWN;
+    case SEN5x_PM10P0:      value = t.pm10p0; return t.pm10p0 != SEN5x_PM_UNKNOWN;
+    case SEN5x_HUMIDITY:    value = t.humidityPercent; return t.humidityPercent != SEN5x_UNKNOWN;
+    case SEN5x_TEMPERATURE: value = t.tempCelsuis;     return t.tempCelsuis     != SEN5x_UNKNOWN;
+    case SEN5x_VOC:         value = t.vocIndex;        return t.vocIndex        != SEN5x_UNKNOWN;
+    case SEN5x_NOX:         value = t.noxIndex;        return t.noxIndex        != SEN5x_UNKNOWN;
+    default:                return false;
+    }
+}
+
+// Refer https://sensirion.com/media/documents/6791EFA0/62A1F68F/Sensirion_Datasheet_Environmental_Node_SEN5x.pdf
+// as to which models have which capabilities
+bool OXRS_SEN5x::hasField(SEN5x_field_t field) const
+{
+    switch (field)
+    {
+    case SEN5x_HUMIDITY:
+    case SEN5x_TEMPERATURE:
+    case SEN5x_VOC:
+        return _model != SEN50;
+    case SEN5x_NOX:
+        return _model == SEN55;
+    default:
+        return true;
+    }
+}
+
+// Ingest a 1Hz sample into the window statistics, unknown values are skipped
+void OXRS_SEN5x::addSample(const SEN5x_telemetry_t& t)
+{
+    for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+    {
+        int32_t value;
+        if (fieldValue(t, (SEN5x_field_t)f, value))
+            _stats[f].add(value);
+    }
+    _windowSamples++;
+}
+
+void OXRS_SEN5x::resetStatistics()
+{
+    for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+        _stats[f].reset();
+    _windowSamples = 0;
+}
+
+// Latest sample per field plus any configured statistics over the window,
+// fields without a known value in the window are published as 0
+void OXRS_SEN5x::encodeTelemetry(SEN5xTelemetryEncoder& encoder) const
+{
+    for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+    {
+        if (!hasField((SEN5x_field_t)f))
+            continue;
+
+        const SEN5xStatistics& stats = _stats[f];
+        const char* key = fields[f].key;
+        uint16_t scale = fields[f].scale;
+
+        encoder.add(key, stats.count() ? stats.last() : 0, scale);
+        if (stats.count() == 0)
+            continue;
+
+        if (_statistics & STATISTIC_MIN)
+            encoder.add(key, stats.min(), scale, "_min");
+        if (_statistics & STATISTIC_MAX)
+            encoder.add(key, stats.max(), scale, "_max");
+        if (_statistics & STATISTIC_MEAN)
+            encoder.addDerived(key, stats.mean(), scale, "_mean");
+        if (_statistics & STATISTIC_STDDEV)
+            encoder.addDerived(key, stats.stddev(), scale, "_stddev");
+    }
+}
+
+// Get telemetry from AQS, sampled asynchronously by loop()
+size_t OXRS_SEN5x::getTelemetry(char* buffer, size_t size)
+{
+    // Do not publish if telemetry has been disabled, logged when configured
+    if (_publishTelemetry_ms == 0)
+        return 0;
+
+    // Drain samples acquired by loop() on every call, the queue only holds
+    // a few seconds of samples
+    SEN5x_sample_t sample;
+    while (_samples.pop(sample))
+    {
+        addSample(sample.telemetry);
+        _latest    = sample;
+        _hasLatest = true;
+    }
+
+    // Check if time passed is enough to publish
+    if ((millis() - _lastPublishTelemetry_ms) <= _publishTelemetry_ms)
+        return 0;
+
+    // Reset timer
+    _lastPublishTelemetry_ms = millis();
+
+    if (_windowSamples == 0)
+        return 0;
+
+    // Suppress unless a field moved beyond its deadband or the heartbeat is due,
+    // statistics keep accumulating until the next publish
+    if (_deadbandEnabled && _hasPublished && !exceedsDeadband() &&
+        (_maxSilence_ms == 0 || (millis() - _lastSent_ms) < _maxSilence_ms))
+    {
+        _suppressedCount++;
+        return 0;
+    }
+
+    LOGF_DEBUG("Publishing statistics of %" PRIu32 " samples", _windowSamples);
+
+    SEN5xTelemetryEncoder encoder(buffer, size);
+    encoder.begin();
+    encodeTelemetry(encoder);
+    setPublished();
+    resetStatistics();
+
+    size_t len = encoder.end();
+    if (len == 0)
+        LOG_ERROR(F("Telemetry buffer too small"));
+    return len;
+}
+
+// True if the latest value of any field moved beyond its deadband since last published
+bool OXRS_SEN5x::exceedsDeadband() const
+{
+    for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+    {
+        if (!hasField((SEN5x_field_t)f) || _stats[f].count() == 0)
+            continue;
+
+        int32_t delta = abs(_stats[f].last() - _lastPublished[f]);
+        const deadband_t& deadband = _deadband[f];
 
-        telemetryAsJson(t, json);
+        if (deadband.absolute > 0 && delta > deadband.absolute)
+            return true;
 
-        // Reset timer
-        _lastPublishTelemetry_ms = millis();
+        // relative to last published value, in tenths of a percent
+        if (deadband.relative > 0 &&
+            (int64_t)delta * 1000 > (int64_t)deadband.relative * abs(_lastPublished[f]))
+            return true;
     }
+    return false;
+}
+
+void OXRS_SEN5x::setPublished()
+{
+    for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+    {
+        if (_stats[f].count() > 0)
+            _lastPublished[f] = _stats[f].last();
+    }
+    _hasPublished = true;
+    _lastSent_ms = millis();
+    _publishedCount++;
+
+    if (_deadbandEnabled)
+        LOGF_DEBUG("Telemetry published %" PRIu32 " suppressed %" PRIu32 "", _publishedCount, _suppressedCount);
+}
+
+uint32_t OXRS_SEN5x::getPublishedCount() const
+{
+    return _publishedCount;
+}
+
+uint32_t OXRS_SEN5x::getSuppressedCount() const
+{
+    return _suppressedCount;
+}
+
+bool OXRS_SEN5x::getLatestSample(SEN5x_sample_t& sample) const
+{
+    if (_hasLatest)
+        sample = _latest;
+    return _hasLatest;
+}
+
+// the register is a single word written by loop(), so safe to read from the other core
+const SEN5xDeviceStatus& OXRS_SEN5x::getDeviceStatus() const
+{
+    return _deviceStatus;
 }
 
 OXRS_SEN5x::Error_t OXRS_SEN5x::getSerialNumber(String &serialNo)
@@ -202,6 +1060,7 @@ OXRS_SEN5x::Error_t OXRS_SEN5x::getSerialNumber(String &serialNo)
     unsigned char serialNumber[32];
     uint8_t serialNumberSize = 32;
 
+    trackI2C();
     Error_t error = _sensor.getSerialNumber(serialNumber, serialNumberSize);
     if (error)
     {
@@ -220,6 +1079,7 @@ OXRS_SEN5x::Error_t OXRS_SEN5x::getModuleVersions(String &sensorNameVersion)
     unsigned char productName[32];
     uint8_t productNameSize = 32;
 
+    trackI2C();
     Error_t error = _sensor.getProductName(productName, productNameSize);
     if (error)
     {
@@ -234,6 +1094,7 @@ OXRS_SEN5x::Error_t OXRS_SEN5x::getModuleVersions(String &sensorNameVersion)
     uint8_t hardwareMinor;
     uint8_t protocolMajor;
     uint8_t protocolMinor;
+    trackI2C();
     error = _sensor.getVersion(firmwareMajor, firmwareMinor, firmwareDebug,
         hardwareMajor, hardwareMinor, protocolMajor, protocolMinor);
 
@@ -254,6 +1115,7 @@ OXRS_SEN5x::Error_t OXRS_SEN5x::refreshDeviceStatus()
 {
     // read device status register values
     uint32_t reg;
+    trackI2C();
     Error_t error = _sensor.readDeviceStatus(reg);
     if (error) {
         return error;
@@ -286,15 +1148,153 @@ void OXRS_SEN5x::onConfig(JsonVariant json)
     if (!publishTelemetryFreq.isNull())
     {
         _publishTelemetry_ms = publishTelemetryFreq.as<uint32_t>() * 1000L;
-        LOGF_INFO("Set config publish telemetry ms to %" PRIu32 "", _publishTelemetry_ms);
+        if (_publishTelemetry_ms == 0)
+            LOG_INFO(F("Telemetry disabled"));
+        else
+            LOGF_INFO("Set config publish telemetry ms to %" PRIu32 "", _publishTelemetry_ms);
+    }
+
+    JsonVariant jvStatistics = findNestedKey(json, TELEMETRY_STATISTICS_CONFIG);
+    if (!jvStatistics.isNull())
+    {
+        _statistics = 0;
+        if (jvStatistics["min"].as<bool>())
+            _statistics |= STATISTIC_MIN;
+        if (jvStatistics["max"].as<bool>())
+            _statistics |= STATISTIC_MAX;
+        if (jvStatistics["mean"].as<bool>())
+            _statistics |= STATISTIC_MEAN;
+        if (jvStatistics["stddev"].as<bool>())
+            _statistics |= STATISTIC_STDDEV;
+        LOGF_INFO("Set config telemetry statistics to 0x%02x", _statistics);
+    }
+
+    JsonVariant jvDeadband = findNestedKey(json, TELEMETRY_DEADBAND_CONFIG);
+    if (!jvDeadband.isNull())
+    {
+        if (jvDeadband.containsKey("enable"))
+            _deadbandEnabled = jvDeadband["enable"].as<bool>();
+        if (jvDeadband.containsKey("maxSilenceSeconds"))
+            _maxSilence_ms = jvDeadband["maxSilenceSeconds"].as<uint32_t>() * 1000L;
+
+        for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+        {
+            JsonVariant jvField = jvDeadband[fields[f].key];
+            if (jvField.isNull())
+                continue;
+            if (jvField.containsKey("absolute"))
+                _deadband[f].absolute = lroundf(jvField["absolute"].as<float>() * fields[f].scale);
+            if (jvField.containsKey("relativePercent"))
+                _deadband[f].relative = lroundf(jvField["relativePercent"].as<float>() * 10);
+        }
+        LOGF_INFO("Set config telemetry deadband %s, max silence ms %" PRIu32 "",
+            _deadbandEnabled ? "enabled" : "disabled", _maxSilence_ms);
     }
 
+    JsonVariant verifyConfigFreq = findNestedKey(json, VERIFY_CONFIG_FREQ_CONFIG);
+    if (!verifyConfigFreq.isNull())
+    {
+        _verifyConfig_ms = verifyConfigFreq.as<uint32_t>() * 1000L;
+        LOGF_INFO("Set config verify config ms to %" PRIu32 "", _verifyConfig_ms);
+    }
+
+    JsonVariant vocStateSnapshot = findNestedKey(json, VOC_STATE_SNAPSHOT_CONFIG);
+    if (!vocStateSnapshot.isNull())
+    {
+        _vocStateSnapshot_ms = vocStateSnapshot.as<uint32_t>() * 60000L;
+        LOGF_INFO("Set config VOC state snapshot ms to %" PRIu32 "", _vocStateSnapshot_ms);
+    }
+
+    JsonVariant vocStateMaxAge = findNestedKey(json, VOC_STATE_MAX_AGE_CONFIG);
+    if (!vocStateMaxAge.isNull())
+    {
+        _vocStateMaxAge_s = vocStateMaxAge.as<uint32_t>() * 60L;
+        LOGF_INFO("Set config VOC state max age seconds to %" PRIu32 "", _vocStateMaxAge_s);
+    }
+
+    // Shadow configuration is only updated here, loop() picks it up and
+    // writes any changes to the sensor
+    beginConfigUpdate();
     if (_model != SEN50)
     {
         JsonVariant tempOffset = findNestedKey(json, TEMPERATURE_OFFSET_CONFIG);
         if (!tempOffset.isNull()) {
-            _tempOffset_celsius = tempOffset.as<float_t>();
-            LOGF_INFO("Set config temperature offset degrees to %.02f", _tempOffset_celsius);
+            _config.tempOffset_celsius = tempOffset.as<float_t>();
+            LOGF_INFO("Set config temperature offset degrees to %.02f", _config.tempOffset_celsius);
+        }
+
+        JsonVariant warmStart = findNestedKey(json, WARM_START_CONFIG);
+        if (!warmStart.isNull()) {
+            _config.warmStart = warmStart.as<uint16_t>();
+            LOGF_INFO("Set config warm start parameter to %" PRIu16 "", _config.warmStart);
+        }
+
+        JsonVariant rhtAcceleration = findNestedKey(json, RHT_ACCELERATION_CONFIG);
+        if (!rhtAcceleration.isNull()) {
+            _config.rhtAccelerationMode = rhtAcceleration.as<uint16_t>();
+            LOGF_INFO("Set config RH/T acceleration mode to %" PRIu16 "", _config.rhtAccelerationMode);
+        }
+
+        parseTuningConfig(json, VOC_TUNING_CONFIG, _config.vocTuning);
+    }
+
+    if (_model == SEN55)
+        parseTuningConfig(json, NOX_TUNING_CONFIG, _config.noxTuning);
+    endConfigUpdate();
+}
+
+void OXRS_SEN5x::parseTuningConfig(JsonVariant json, const String& key, SEN5x_algorithm_tuning_t& tuning)
+{
+    // tuning property names are shared between VOC and NOx so search within the object only
+    JsonVariant jvTuning = findNestedKey(json, key);
+    if (jvTuning.isNull())
+        return;
+
+    if (jvTuning.containsKey("indexOffset"))
+        tuning.indexOffset = jvTuning["indexOffset"].as<int16_t>();
+    if (jvTuning.containsKey("learningTimeOffsetHours"))
+        tuning.learningTimeOffsetHours = jvTuning["learningTimeOffsetHours"].as<int16_t>();
+    if (jvTuning.containsKey("learningTimeGainHours"))
+        tuning.learningTimeGainHours = jvTuning["learningTimeGainHours"].as<int16_t>();
+    if (jvTuning.containsKey("gatingMaxDurationMinutes"))
+        tuning.gatingMaxDurationMinutes = jvTuning["gatingMaxDurationMinutes"].as<int16_t>();
+    if (jvTuning.containsKey("stdInitial"))
+        tuning.stdInitial = jvTuning["stdInitial"].as<int16_t>();
+    if (jvTuning.containsKey("gainFactor"))
+        tuning.gainFactor = jvTuning["gainFactor"].as<int16_t>();
+
+    LOGF_INFO("Set config %s", key.c_str());
+}
+
+void OXRS_SEN5x::queueCommand(command_t command)
+{
+    if (!_commands.push(command))
+        LOG_WARN(F("Command queue full, command dropped"));
+}
+
+// Execute commands queued by onCommand, from loop() so the sensor is only
+// ever driven from one core
+void OXRS_SEN5x::processCommands()
+{
+    // left queued until the command in flight has executed, as they abort
+    // acquisition and then talk to the sensor straight away
+    if (isCommandExecuting())
+        return;
+
+    uint8_t command;
+    while (_commands.pop(command))
+    {
+        switch (command)
+        {
+        case COMMAND_RESET:
+            resetSensor();
+            break;
+        case COMMAND_FANCLEAN:
+            fanClean();
+            break;
+        case COMMAND_CLEAR_DEVICESTATUS:
+            clearDeviceStatus();
+            break;
         }
     }
 }
@@ -302,7 +1302,26 @@ void OXRS_SEN5x::onConfig(JsonVariant json)
 void OXRS_SEN5x::resetSensor()
 {
     LOG_INFO(F("Resetting sensor"));
+    abortAcquisition();
+
+    // keep the learnt VOC state so it is restored after the reset, loop()
+    // resets once the state has been read
+    if (canSnapshotVocState())
+    {
+        snapshotVocState();
+        _resetPending = true;
+        return;
+    }
+
+    resetDevice();
+}
+
+void OXRS_SEN5x::resetDevice()
+{
+    _resetPending = false;
+
     // reset sensor
+    trackI2C();
     Error_t error = _sensor.deviceReset();
     if (error)
         logError(error, F("Error reseting sensor"));
@@ -314,6 +1333,8 @@ void OXRS_SEN5x::resetSensor()
 void OXRS_SEN5x::fanClean()
 {
     LOG_INFO(F("Fanclean command"));
+    abortAcquisition();
+
     // check device status
     Error_t error = refreshDeviceStatus();
     if (error)
@@ -324,6 +1345,7 @@ void OXRS_SEN5x::fanClean()
 
     if (!_deviceStatus.isFanCleaningActive())
     {
+        trackI2C();
         Error_t error = _sensor.startFanCleaning();
         error ? logError(error, F("Error starting fan cleaning")) : LOG_INFO(F("Fan cleaning started"));
 // TODO: capture time of fan cleaning request so we can ensure its done once a week esp if the device is being turned on/off a lot like during development
@@ -337,6 +1359,8 @@ void OXRS_SEN5x::fanClean()
 void OXRS_SEN5x::clearDeviceStatus()
 {
     LOG_INFO(F("Clear device status"));
+    abortAcquisition();
+
     // only clear if device status bits set
 
     // check device status
@@ -350,6 +1374,7 @@ void OXRS_SEN5x::clearDeviceStatus()
     if (_deviceStatus.hasIssue())
     {
         uint32_t deviceStatus;
+        trackI2C();
         error = _sensor.readAndClearDeviceStatus(deviceStatus);
         error ? logError(error, F("Error clearing device status")) : LOG_INFO(F("Device status cleared"));
     }
@@ -362,17 +1387,17 @@ void OXRS_SEN5x::clearDeviceStatus()
 void OXRS_SEN5x::onCommand(JsonVariant json)
 {
     if (json.containsKey(RESET_COMMAND) && json[RESET_COMMAND].as<bool>()) {
-        resetSensor();
+        queueCommand(COMMAND_RESET);
         return;
     }
 
     if (json.containsKey(FANCLEAN_COMMAND) && json[FANCLEAN_COMMAND].as<bool>()) {
-        fanClean();
+        queueCommand(COMMAND_FANCLEAN);
         return;
     }
 
     if (json.containsKey(CLEAR_DEVICESTATUS_COMMAND) && json[CLEAR_DEVICESTATUS_COMMAND].as<bool>()) {
-        clearDeviceStatus();
+        queueCommand(COMMAND_CLEAR_DEVICESTATUS);
         return;
     }
 }
@@ -427,6 +1452,29 @@ void OXRS_SEN5x::setConfigSchema(JsonVariant config)
     publishTelemetry["maximum"] = 86400;
     publishTelemetry["default"] = (uint32_t)_publishTelemetry_ms / 1000.0;
 
+    JsonObject statistics = config.createNestedObject(TELEMETRY_STATISTICS_CONFIG);
+    statistics["title"]   = "Telemetry Statistics";
+    statistics["description"] =
+        "The sensor is sampled every second, optionally publish statistics of all samples \
+since the last publish alongside the latest sample (as <field>_min, <field>_max, <field>_mean, <field>_stddev).";
+    JsonObject statisticsProps = statistics.createNestedObject("properties");
+    JsonObject statMin  = statisticsProps.createNestedObject("min");
+    statMin["title"]    = "Minimum";
+    statMin["type"]     = "boolean";
+    statMin["default"]  = (bool)(_statistics & STATISTIC_MIN);
+    JsonObject statMax  = statisticsProps.createNestedObject("max");
+    statMax["title"]    = "Maximum";
+    statMax["type"]     = "boolean";
+    statMax["default"]  = (bool)(_statistics & STATISTIC_MAX);
+    JsonObject statMean = statisticsProps.createNestedObject("mean");
+    statMean["title"]   = "Mean";
+    statMean["type"]    = "boolean";
+    statMean["default"] = (bool)(_statistics & STATISTIC_MEAN);
+    JsonObject statStdDev = statisticsProps.createNestedObject("stddev");
+    statStdDev["title"]   = "Standard Deviation";
+    statStdDev["type"]    = "boolean";
+    statStdDev["default"] = (bool)(_statistics & STATISTIC_STDDEV);
+
     if (_model != SEN50)
     {
         JsonObject temperatureOffset = config.createNestedObject(TEMPERATURE_OFFSET_CONFIG);
@@ -435,9 +1483,63 @@ void OXRS_SEN5x::setConfigSchema(JsonVariant config)
         temperatureOffset["type"]    = "integer";
         temperatureOffset["minimum"] = -10;
         temperatureOffset["maximum"] = 10;
-        temperatureOffset["default"] = _tempOffset_celsius;
+        temperatureOffset["default"] = _config.tempOffset_celsius;
+
+        JsonObject warmStart = config.createNestedObject(WARM_START_CONFIG);
+        warmStart["title"]   = "Warm Start Parameter";
+        warmStart["description"] = "Temperature compensation warm start behaviour, 0 (cold start) to 65535 (warm start). Default 0.";
+        warmStart["type"]    = "integer";
+        warmStart["minimum"] = 0;
+        warmStart["maximum"] = 65535;
+        warmStart["default"] = _config.warmStart;
+
+        JsonObject rhtAcceleration = config.createNestedObject(RHT_ACCELERATION_CONFIG);
+        rhtAcceleration["title"]   = "RH/T Acceleration Mode";
+        rhtAcceleration["description"] = "0 = low, 1 = high, 2 = medium acceleration. Default 0.";
+        rhtAcceleration["type"]    = "integer";
+        rhtAcceleration["minimum"] = 0;
+        rhtAcceleration["maximum"] = 2;
+        rhtAcceleration["default"] = _config.rhtAccelerationMode;
+
+        tuningConfigSchema(config, VOC_TUNING_CONFIG, "VOC Algorithm Tuning", _config.vocTuning);
+
+        JsonObject vocStateSnapshot = config.createNestedObject(VOC_STATE_SNAPSHOT_CONFIG);
+        vocStateSnapshot["title"]   = "VOC State Save Frequency (minutes)";
+        vocStateSnapshot["description"] =
+            "How often to save the learnt VOC algorithm state to flash, so it can be restored after \
+a reboot or sensor reset (setting to 0 disables). Must be a number between 0 and 1440 (i.e. 1 day).";
+        vocStateSnapshot["type"]    = "integer";
+        vocStateSnapshot["minimum"] = 0;
+        vocStateSnapshot["maximum"] = 1440;
+        vocStateSnapshot["default"] = (uint32_t)_vocStateSnapshot_ms / 60000;
+
+        JsonObject vocStateMaxAge = config.createNestedObject(VOC_STATE_MAX_AGE_CONFIG);
+        vocStateMaxAge["title"]   = "VOC State Maximum Age (minutes)";
+        vocStateMaxAge["description"] =
+            "Saved VOC algorithm state older than this is not restored. Must be a number between 0 and 10080 (i.e. 1 week).";
+        vocStateMaxAge["type"]    = "integer";
+        vocStateMaxAge["minimum"] = 0;
+        vocStateMaxAge["maximum"] = 10080;
+        vocStateMaxAge["default"] = _vocStateMaxAge_s / 60;
     }
 
+    if (_model == SEN55)
+    {
+        tuningConfigSchema(config, NOX_TUNING_CONFIG, "NOx Algorithm Tuning", _config.noxTuning);
+    }
+
+    deadbandConfigSchema(config);
+
+    JsonObject verifyConfig = config.createNestedObject(VERIFY_CONFIG_FREQ_CONFIG);
+    verifyConfig["title"]   = "Verify Sensor Config Frequency (seconds)";
+    verifyConfig["description"] =
+        "How often to read back sensor configuration and rewrite it if it differs \
+(setting to 0 disables verification). Must be a number between 0 and 86400 (i.e. 1 day).";
+    verifyConfig["type"]    = "integer";
+    verifyConfig["minimum"] = 0;
+    verifyConfig["maximum"] = 86400;
+    verifyConfig["default"] = (uint32_t)_verifyConfig_ms / 1000;
+
     /*    JsonObject lastFanClean = config.createNestedObject("lastFanClean");
         lastFanClean["title"] = "Last Fan Clean";
         lastFanClean["description"] = "Datetime of last fan clean.";
@@ -446,9 +1548,107 @@ void OXRS_SEN5x::setConfigSchema(JsonVariant config)
         lastFanClean["readOnly"] = "true";*/
 }
 
+void OXRS_SEN5x::deadbandConfigSchema(JsonVariant config)
+{
+    JsonObject deadband = config.createNestedObject(TELEMETRY_DEADBAND_CONFIG);
+    deadband["title"]   = "Telemetry Deadband";
+    deadband["description"] =
+        "When enabled telemetry is only published when a field has moved by more than its absolute \
+or relative deadband since last published (0 disables either), or the max silence has elapsed.";
+    JsonObject deadbandProps = deadband.createNestedObject("properties");
+
+    JsonObject enable = deadbandProps.createNestedObject("enable");
+    enable["title"]   = "Enable";
+    enable["type"]    = "boolean";
+    enable["default"] = _deadbandEnabled;
+
+    JsonObject maxSilence = deadbandProps.createNestedObject("maxSilenceSeconds");
+    maxSilence["title"]   = "Max Silence (seconds)";
+    maxSilence["description"] = "Publish at least this often regardless of change (0 disables).";
+    maxSilence["type"]    = "integer";
+    maxSilence["minimum"] = 0;
+    maxSilence["maximum"] = 86400;
+    maxSilence["default"] = _maxSilence_ms / 1000;
+
+    for (uint8_t f = 0; f < SEN5x_FIELD_COUNT; f++)
+    {
+        if (!hasField((SEN5x_field_t)f))
+            continue;
+
+        JsonObject field = deadbandProps.createNestedObject(fields[f].key);
+        field["title"]   = fields[f].title;
+        JsonObject fieldProps = field.createNestedObject("properties");
+
+        JsonObject absolute = fieldProps.createNestedObject("absolute");
+        absolute["title"]   = "Absolute";
+        absolute["type"]    = "number";
+        absolute["minimum"] = 0;
+        absolute["default"] = (float)_deadband[f].absolute / fields[f].scale;
+
+        JsonObject relative = fieldProps.createNestedObject("relativePercent");
+        relative["title"]   = "Relative (%)";
+        relative["type"]    = "number";
+        relative["minimum"] = 0;
+        relative["maximum"] = 100;
+        relative["default"] = _deadband[f].relative / 10.0;
+    }
+}
+
+void OXRS_SEN5x::tuningConfigSchema(JsonVariant config, const String& key, const char* title,
+    const SEN5x_algorithm_tuning_t& tuning)
+{
+    JsonObject tuningConfig = config.createNestedObject(key);
+    tuningConfig["title"]   = title;
+    JsonObject tuningProps  = tuningConfig.createNestedObject("properties");
+
+    JsonObject indexOffset = tuningProps.createNestedObject("indexOffset");
+    indexOffset["title"]   = "Index Offset";
+    indexOffset["type"]    = "integer";
+    indexOffset["minimum"] = 1;
+    indexOffset["maximum"] = 250;
+    indexOffset["default"] = tuning.indexOffset;
+
+    JsonObject learningTimeOffset = tuningProps.createNestedObject("learningTimeOffsetHours");
+    learningTimeOffset["title"]   = "Learning Time Offset (hours)";
+    learningTimeOffset["type"]    = "integer";
+    learningTimeOffset["minimum"] = 1;
+    learningTimeOffset["maximum"] = 1000;
+    learningTimeOffset["default"] = tuning.learningTimeOffsetHours;
+
+    JsonObject learningTimeGain = tuningProps.createNestedObject("learningTimeGainHours");
+    learningTimeGain["title"]   = "Learning Time Gain (hours)";
+    learningTimeGain["type"]    = "integer";
+    learningTimeGain["minimum"] = 1;
+    learningTimeGain["maximum"] = 1000;
+    learningTimeGain["default"] = tuning.learningTimeGainHours;
+
+    JsonObject gatingMaxDuration = tuningProps.createNestedObject("gatingMaxDurationMinutes");
+    gatingMaxDuration["title"]   = "Gating Max Duration (minutes)";
+    gatingMaxDuration["type"]    = "integer";
+    gatingMaxDuration["minimum"] = 0;
+    gatingMaxDuration["maximum"] = 3000;
+    gatingMaxDuration["default"] = tuning.gatingMaxDurationMinutes;
+
+    JsonObject stdInitial = tuningProps.createNestedObject("stdInitial");
+    stdInitial["title"]   = "Initial Standard Deviation";
+    stdInitial["type"]    = "integer";
+    stdInitial["minimum"] = 10;
+    stdInitial["maximum"] = 5000;
+    stdInitial["default"] = tuning.stdInitial;
+
+    JsonObject gainFactor = tuningProps.createNestedObject("gainFactor");
+    gainFactor["title"]   = "Gain Factor";
+    gainFactor["type"]    = "integer";
+    gainFactor["minimum"] = 1;
+    gainFactor["maximum"] = 1000;
+    gainFactor["default"] = tuning.gainFactor;
+}
+
 void OXRS_SEN5x::logError(Error_t error, const __FlashStringHelper *s)
 {
     char errorMessage[256];
     errorToString(error, errorMessage, 256);
-    LOGF_ERROR("%s %s", s, errorMessage);
+    // rate limited per message and error, so one failing command cannot
+    // silence the others
+    LOGF_ERROR_KEY((uintptr_t)s ^ ((uintptr_t)error << 16), "%s %s", s, errorMessage);
 }
@@ -1,39 +1,125 @@
 #pragma once
+#include <atomic>
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <SensirionI2CSen5x.h>
+#include <SensirionCore.h>
 #include <Wire.h>
+#include <OXRS_SPSC.h>
 #include "SEN5xDeviceStatus.h"
+#include "SEN5xTelemetryEncoder.h"
+#include "SEN5xStatistics.h"
+#include "SEN5xVocState.h"
 
 /*
  * OXRS firmware supporting Sensirion 5x (SEN50, SEN54, SEN55) air quality sensors.
  * Refer https://www.sensirion.com/media/documents/6791EFA0/62A1F68F/Sensirion_Datasheet_Environmental_Node_SEN5x.pdf
+ *
+ * begin() and loop() own the sensor and may run on a different core to the
+ * OXRS callbacks and getTelemetry(). Samples, configuration and commands are
+ * passed between the two sides without locks.
  */
 
-// Struct capturing measurements of SEN5x sensor.
+// Struct capturing measurements of SEN5x sensor, in the sensor's scaled integer
+// format (refer readMeasuredValuesAsIntegers) to avoid soft-float on the RP2040.
 // Note PM4.0 and PM10.0 are statistically generated and not measured: refer
 // https://sensirion.com/media/documents/B7AAA101/61653FB8/Sensirion_Particulate_Matter_AppNotes_Specification_Statement.pdf
 typedef struct {
-    float pm1p0;                // particulate matter PM1.0 µm
-    float pm2p5;                // particulate matter PM2.5 µm
-    float pm4p0;                // particulate matter PM4.0 µm
-    float pm10p0;               // particulate matter PM10.0 µm
-    float humidityPercent;      // relative humidity  %
-    float tempCelsuis;          // temperature        °C
-    float vocIndex;             // volatile organic compound index 1-500
-    float noxIndex;             // nitrous oxide index 1-500
+    uint16_t pm1p0;             // particulate matter PM1.0 µm            x10
+    uint16_t pm2p5;             // particulate matter PM2.5 µm            x10
+    uint16_t pm4p0;             // particulate matter PM4.0 µm            x10
+    uint16_t pm10p0;            // particulate matter PM10.0 µm           x10
+    int16_t  humidityPercent;   // relative humidity  %                   x100
+    int16_t  tempCelsuis;       // temperature        °C                  x200
+    int16_t  vocIndex;          // volatile organic compound index 1-500  x10
+    int16_t  noxIndex;          // nitrous oxide index 1-500              x10
 } SEN5x_telemetry_t;
 
+// Sample as acquired by loop()
+typedef struct {
+    uint32_t          timestamp_ms;     // millis() when acquired
+    SEN5x_telemetry_t telemetry;
+} SEN5x_sample_t;
+
+// Scale factors and unknown value markers of SEN5x_telemetry_t
+#define SEN5x_PM_SCALE          10
+#define SEN5x_HUMIDITY_SCALE    100
+#define SEN5x_TEMPERATURE_SCALE 200
+#define SEN5x_INDEX_SCALE       10
+#define SEN5x_PM_UNKNOWN        0xFFFF
+#define SEN5x_UNKNOWN           0x7FFF
+
+// Telemetry fields, in publish order
+typedef enum {
+    SEN5x_PM1P0 = 0,
+    SEN5x_PM2P5,
+    SEN5x_PM4P0,
+    SEN5x_PM10P0,
+    SEN5x_HUMIDITY,
+    SEN5x_TEMPERATURE,
+    SEN5x_VOC,
+    SEN5x_NOX,
+    SEN5x_FIELD_COUNT
+} SEN5x_field_t;
+
+// Acquisition and configuration states, each state (other than idle) has an i2c
+// command in flight which is read back, or followed by the next command, once
+// its execution time has passed.
+typedef enum {
+    ACQ_IDLE = 0,               // waiting for next acquisition
+    ACQ_DEVICE_STATUS,          // read device status issued
+    ACQ_DATA_READY,             // read data ready flag issued
+    ACQ_MEASURED_VALUES,        // read measured values issued
+    ACQ_CONFIG_STOP,            // stop measurement issued ahead of idle only configuration
+    ACQ_CONFIG_WRITE,           // configuration item written
+    ACQ_CONFIG_START,           // start measurement issued once configuration written
+    ACQ_CONFIG_VERIFY,          // configuration item read back issued
+    ACQ_VOC_STATE               // read VOC algorithm state issued
+} SEN5x_acquisition_state_t;
+
+// VOC/NOx gas index algorithm tuning parameters, refer datasheet section 6.1.11
+typedef struct {
+    int16_t indexOffset;
+    int16_t learningTimeOffsetHours;
+    int16_t learningTimeGainHours;
+    int16_t gatingMaxDurationMinutes;
+    int16_t stdInitial;
+    int16_t gainFactor;
+} SEN5x_algorithm_tuning_t;
+
+// Shadow of the sensor configuration registers, as last written to the sensor.
+typedef struct {
+    float_t  tempOffset_celsius;            // temperature offset
+    uint16_t warmStart;                     // temperature compensation warm start 0-65535
+    uint16_t rhtAccelerationMode;           // RH/T acceleration mode 0, 1 or 2
+    SEN5x_algorithm_tuning_t vocTuning;     // VOC algorithm tuning
+    SEN5x_algorithm_tuning_t noxTuning;     // NOx algorithm tuning
+} SEN5x_config_t;
+
 class OXRS_SEN5x {
 public:
     OXRS_SEN5x(SEN5x_model_t model);
 
     typedef uint16_t Error_t;
 
+    // acquisition side, may run on core1
     void begin(TwoWire& wire);
     void loop();
 
-    void getTelemetry(JsonVariant json);
+    // publishing side, encode telemetry json into buffer, returns payload length or 0 if nothing to publish
+    size_t getTelemetry(char* buffer, size_t size);
+    inline static const size_t TELEMETRY_MAX_SIZE = 1024;
+
+    // publishing side, latest sample drained by getTelemetry(), false if none yet
+    bool getLatestSample(SEN5x_sample_t& sample) const;
+    const SEN5xDeviceStatus& getDeviceStatus() const;
+
+    // i2c commands issued to the sensor over the last complete minute
+    uint32_t getI2CTransactionsPerMinute() const;
+
+    // telemetry publishes and those suppressed by the deadband since boot
+    uint32_t getPublishedCount() const;
+    uint32_t getSuppressedCount() const;
 
     // OXRS ecosystem
     void onConfig(JsonVariant json);
@@ -45,42 +131,213 @@ private:
     // defaults
     inline static const uint32_t DEFAULT_PUBLISH_TELEMETRY_MS = 10000;
     inline static const int8_t   DEFAULT_TEMP_OFFSET_C        = 0;
+    inline static const uint16_t DEFAULT_WARM_START           = 0;
+    inline static const uint16_t DEFAULT_RHT_ACCELERATION     = 0;
+    inline static const uint32_t DEFAULT_VERIFY_CONFIG_MS     = 0;
+    inline static const uint8_t  DEFAULT_STATISTICS           = 0;
+    inline static const uint32_t DEFAULT_MAX_SILENCE_MS       = 600000;
+    inline static const uint32_t DEFAULT_VOC_STATE_SNAPSHOT_MS = 600000;
+    inline static const uint32_t DEFAULT_VOC_STATE_MAX_AGE_S  = 3600;
+    inline static const SEN5x_algorithm_tuning_t DEFAULT_VOC_TUNING = { 100, 12, 12, 180, 50, 230 };
+    inline static const SEN5x_algorithm_tuning_t DEFAULT_NOX_TUNING = { 1, 12, 12, 720, 50, 230 };
 
     // OXRS config items
     inline static const String PUBLISH_TELEMETRY_FREQ_CONFIG  = "publishTelemetrySeconds";
     inline static const String TEMPERATURE_OFFSET_CONFIG      = "temperatureOffsetCelsius";
+    inline static const String WARM_START_CONFIG              = "warmStartParameter";
+    inline static const String RHT_ACCELERATION_CONFIG        = "rhtAccelerationMode";
+    inline static const String VOC_TUNING_CONFIG              = "vocAlgorithmTuning";
+    inline static const String NOX_TUNING_CONFIG              = "noxAlgorithmTuning";
+    inline static const String VERIFY_CONFIG_FREQ_CONFIG      = "verifyConfigSeconds";
+    inline static const String TELEMETRY_STATISTICS_CONFIG    = "telemetryStatistics";
+    inline static const String TELEMETRY_DEADBAND_CONFIG      = "telemetryDeadband";
+    inline static const String VOC_STATE_SNAPSHOT_CONFIG      = "vocStateSnapshotMinutes";
+    inline static const String VOC_STATE_MAX_AGE_CONFIG       = "vocStateMaxAgeMinutes";
 
     // OXRS command items
     inline static const String RESET_COMMAND                  = "resetCommand";
     inline static const String FANCLEAN_COMMAND               = "fanCleanCommand";
     inline static const String CLEAR_DEVICESTATUS_COMMAND     = "clearDeviceStatusCommand";
 
+    // SEN5x i2c commands used for non-blocking acquisition and configuration,
+    // and their execution time
+    inline static const uint16_t CMD_START_MEASUREMENT        = 0x0021;
+    inline static const uint16_t CMD_STOP_MEASUREMENT         = 0x0104;
+    inline static const uint16_t CMD_READ_DATA_READY          = 0x0202;
+    inline static const uint16_t CMD_READ_MEASURED_VALUES     = 0x03C4;
+    inline static const uint16_t CMD_TEMPERATURE_OFFSET       = 0x60B2;     // offset x200, slope, time constant
+    inline static const uint16_t CMD_WARM_START               = 0x60C6;
+    inline static const uint16_t CMD_VOC_TUNING               = 0x60D0;
+    inline static const uint16_t CMD_NOX_TUNING               = 0x60E1;
+    inline static const uint16_t CMD_RHT_ACCELERATION         = 0x60F7;
+    inline static const uint16_t CMD_VOC_STATE                = 0x6181;
+    inline static const uint16_t CMD_READ_DEVICE_STATUS       = 0xD206;
+    inline static const uint32_t CMD_EXECUTION_MS             = 20;         // get and set commands
+    inline static const uint32_t START_MEASUREMENT_MS         = 50;
+    inline static const uint32_t STOP_MEASUREMENT_MS          = 200;
+
+    // shadow configuration dirty bits
+    inline static const uint8_t CONFIG_TEMP_OFFSET            = 0x01;
+    inline static const uint8_t CONFIG_WARM_START             = 0x02;
+    inline static const uint8_t CONFIG_RHT_ACCELERATION       = 0x04;
+    inline static const uint8_t CONFIG_VOC_TUNING             = 0x08;
+    inline static const uint8_t CONFIG_NOX_TUNING             = 0x10;
+    inline static const uint8_t CONFIG_ALL                    = 0x1F;
+    inline static const uint8_t CONFIG_VOC_STATE              = 0x20;   // restore of persisted state, not verified
+    inline static const uint8_t CONFIG_IDLE_ONLY              = CONFIG_WARM_START | CONFIG_RHT_ACCELERATION |
+                                                                CONFIG_VOC_TUNING | CONFIG_NOX_TUNING |
+                                                                CONFIG_VOC_STATE;
+
+    inline static const uint32_t I2C_STATS_WINDOW_MS          = 60000;
+
+    // commands queued from onCommand to loop()
+    typedef enum {
+        COMMAND_RESET = 0,
+        COMMAND_FANCLEAN,
+        COMMAND_CLEAR_DEVICESTATUS
+    } command_t;
+
+    // how long after measurement starts to wait for a valid clock before
+    // giving up on restoring VOC algorithm state
+    inline static const uint32_t VOC_STATE_RESTORE_WINDOW_MS  = 300000;
+
+    // sensor produces a new measurement every second
+    inline static const uint32_t SAMPLE_INTERVAL_MS           = 1000;
+
+    // statistics published per field in addition to the latest sample
+    inline static const uint8_t STATISTIC_MIN                 = 0x01;
+    inline static const uint8_t STATISTIC_MAX                 = 0x02;
+    inline static const uint8_t STATISTIC_MEAN                = 0x04;
+    inline static const uint8_t STATISTIC_STDDEV              = 0x08;
+
     void logError(Error_t error, const __FlashStringHelper* s);
-    double round2dp(float d) const;
     JsonVariant findNestedKey(JsonObject obj, const String& key) const;
     String getModelName() const;
 
     Error_t getSerialNumber(String& serialNo);
     Error_t getModuleVersions(String& sensorNameVersion);
-    Error_t getMeasurements(SEN5x_telemetry_t& t);
     Error_t refreshDeviceStatus();
 
-    void telemetryAsJson(const SEN5x_telemetry_t& t, JsonVariant json) const;
+    // non-blocking acquisition
+    void acquire();
+    void finishAcquisition();
+    void abortAcquisition();
+    bool isCommandExecuting() const;
+    Error_t sendCommand(uint16_t command, uint32_t execution_ms = CMD_EXECUTION_MS);
+    Error_t sendFrame(SensirionI2CTxFrame& txFrame, uint32_t execution_ms);
+    Error_t receiveResponse(SensirionI2CRxFrame& rxFrame, size_t size);
+    Error_t parseMeasuredValues(SensirionI2CRxFrame& rxFrame, SEN5x_telemetry_t& t);
+
+    // windowed statistics
+    bool hasField(SEN5x_field_t field) const;
+    void addSample(const SEN5x_telemetry_t& t);
+    void resetStatistics();
+    void encodeTelemetry(SEN5xTelemetryEncoder& encoder) const;
+
+    // change driven publishing
+    bool exceedsDeadband() const;
+    void setPublished();
+    void deadbandConfigSchema(JsonVariant config);
 
     // commands
+    void queueCommand(command_t command);
+    void processCommands();
     void resetSensor();
+    void resetDevice();
     void fanClean();
     void clearDeviceStatus();
 
-    void setTemperatureOffset();
     void initialiseDevice();
 
+    // shadow configuration
+    uint8_t supportedConfig() const;
+    void markConfigDirty(uint8_t items);
+    void beginConfigUpdate();
+    void endConfigUpdate();
+    void pollConfig();
+    void writeConfig();
+    Error_t writeConfigItem(uint8_t item);
+    static uint16_t configCommand(uint8_t item);
+    void beginVerifyConfig();
+    void verifyConfig();
+    void checkConfigItem();
+    void parseTuningConfig(JsonVariant json, const String& key, SEN5x_algorithm_tuning_t& tuning);
+    void tuningConfigSchema(JsonVariant config, const String& key, const char* title,
+        const SEN5x_algorithm_tuning_t& tuning);
+
+    // VOC algorithm state persistence
+    bool canSnapshotVocState() const;
+    void snapshotVocState();
+    void saveVocState();
+    void restoreVocState();
+    void trackFirstVocIndex(const SEN5x_telemetry_t& t);
+
+    void trackI2C(uint16_t transactions = 1);
+
     uint32_t _publishTelemetry_ms;          // how often publish
     uint32_t _lastPublishTelemetry_ms;      // last time published since start
-    float_t  _tempOffset_celsius;           // sensor temperature offset
+    uint32_t _lastSample_ms;                // last time acquisition started
+    uint32_t _commandIssued_ms;             // time the in flight i2c command was sent
+    uint32_t _commandExecution_ms;          // execution time of the in flight i2c command
+    uint32_t _verifyConfig_ms;              // how often to read back configuration, 0 disables
+    uint32_t _lastVerifyConfig_ms;          // last time configuration was read back
+
+    SEN5x_config_t _config;                 // desired configuration, written by onConfig
+    std::atomic<uint32_t> _configSeq;       // _config sequence, odd while being updated
+    uint32_t       _configSeqSeen;          // last _config sequence copied by loop()
+    SEN5x_config_t _deviceConfig;           // loop() copy of desired configuration
+    SEN5x_config_t _configWritten;          // configuration last written to the sensor
+    uint8_t        _configDirty;            // CONFIG_* items awaiting write
+    uint8_t        _configItem;             // CONFIG_* item being read back
+    uint8_t        _verifyPending;          // CONFIG_* items awaiting read back
+    uint8_t        _verifyMismatch;         // CONFIG_* items read back differing from the shadow
+
+    uint32_t _i2cTransactions;              // i2c commands issued in current window
+    uint32_t _i2cTransactionsPerMinute;     // i2c commands issued in last complete window
+    uint32_t _i2cWindowStart_ms;            // start of current window
 
     SensirionI2CSen5x _sensor;              // i2c library
+    TwoWire*          _wire;                // i2c bus
     SEN5x_model_t     _model;               // sensor model
     SEN5xDeviceStatus _deviceStatus;        // sensor device status
     bool              _deviceReady;         // device connected and successfully reset
+    bool              _measuring;           // measurement started, else idle
+    bool              _resetPending;        // reset waiting on a VOC state snapshot
+
+    SEN5x_acquisition_state_t _acqState;    // acquisition state machine
+    SEN5x_sample_t    _sample;              // sample being acquired
+    OXRS_SPSC<SEN5x_sample_t, 16> _samples; // acquired samples awaiting getTelemetry
+    OXRS_SPSC<uint8_t, 8>         _commands;// command_t awaiting loop()
+    SEN5x_sample_t    _latest;              // latest sample drained by getTelemetry()
+    bool              _hasLatest;
+
+    SEN5xStatistics   _stats[SEN5x_FIELD_COUNT];    // per field statistics for current window
+    uint32_t          _windowSamples;       // samples acquired in current window
+    uint8_t           _statistics;          // STATISTIC_* items to publish
+
+    // Deadband per field, in scaled units and tenths of a percent respectively
+    typedef struct {
+        int32_t  absolute;                  // 0 disables
+        uint16_t relative;                  // 0 disables
+    } deadband_t;
+
+    bool       _deadbandEnabled;            // publish only on change or heartbeat
+    deadband_t _deadband[SEN5x_FIELD_COUNT];
+    int32_t    _lastPublished[SEN5x_FIELD_COUNT];   // latest values last published
+    bool       _hasPublished;               // _lastPublished is valid
+    uint32_t   _maxSilence_ms;              // heartbeat, publish at least this often
+    uint32_t   _lastSent_ms;                // last time telemetry was actually published
+    uint32_t   _publishedCount;             // telemetry published
+    uint32_t   _suppressedCount;            // telemetry suppressed by deadband
+
+    SEN5xVocState _vocState;                // persisted VOC algorithm state
+    uint32_t   _vocStateSnapshot_ms;        // how often to persist VOC state, 0 disables
+    uint32_t   _vocStateMaxAge_s;           // oldest persisted state that is restored
+    uint32_t   _lastVocStateSnapshot_ms;    // last time VOC state was persisted
+    bool       _vocStateRestorePending;     // restore waiting on a valid clock
+    bool       _vocStateRestored;           // state restored since measurement started
+    uint8_t    _vocStateRestore[SEN5xVocState::STATE_SIZE];    // state awaiting write
+    int32_t    _vocStateRestoreAge_s;       // age of the state awaiting write
+    bool       _vocIndexPending;            // no valid VOC index since measurement started
+    uint32_t   _measurementStart_ms;        // time measurement started
 };
@@ -20,6 +20,15 @@ public:
     void logStatus() const;
     bool isFanCleaningActive() const;
 
+    // Call f(const char* name, bool set) for each status bit of the model
+    template <typename F>
+    void forEachBit(F f) const
+    {
+        std::bitset<32> b(_register);
+        for (auto iter = _pstatusConfig->begin(); iter != _pstatusConfig->end(); iter++)
+            f(iter->first.c_str(), (bool)b[iter->second.bit_no]);
+    }
+
 private:
     void setConfig(SEN5x_model_t model);
 
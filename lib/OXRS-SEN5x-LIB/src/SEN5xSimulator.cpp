@@ -0,0 +1,443 @@
+#include <SEN5xSimulator.h>
+
+// SEN5x commands and their execution time
+static const uint16_t CMD_START_MEASUREMENT          = 0x0021;
+static const uint16_t CMD_START_MEASUREMENT_GAS_ONLY = 0x0037;
+static const uint16_t CMD_STOP_MEASUREMENT           = 0x0104;
+static const uint16_t CMD_READ_DATA_READY            = 0x0202;
+static const uint16_t CMD_READ_MEASURED_VALUES       = 0x03C4;
+static const uint16_t CMD_TEMPERATURE_COMPENSATION   = 0x60B2;
+static const uint16_t CMD_WARM_START                 = 0x60C6;
+static const uint16_t CMD_VOC_TUNING                 = 0x60D0;
+static const uint16_t CMD_NOX_TUNING                 = 0x60E1;
+static const uint16_t CMD_RHT_ACCELERATION           = 0x60F7;
+static const uint16_t CMD_VOC_STATE                  = 0x6181;
+static const uint16_t CMD_START_FAN_CLEANING         = 0x5607;
+static const uint16_t CMD_AUTO_CLEANING_INTERVAL     = 0x8004;
+static const uint16_t CMD_READ_PRODUCT_NAME          = 0xD014;
+static const uint16_t CMD_READ_SERIAL_NUMBER         = 0xD033;
+static const uint16_t CMD_READ_VERSION               = 0xD100;
+static const uint16_t CMD_READ_DEVICE_STATUS         = 0xD206;
+static const uint16_t CMD_READ_CLEAR_DEVICE_STATUS   = 0xD210;
+static const uint16_t CMD_DEVICE_RESET               = 0xD304;
+
+static const uint32_t EXECUTION_MS                   = 20;
+static const uint32_t START_MEASUREMENT_MS           = 50;
+static const uint32_t STOP_MEASUREMENT_MS            = 200;
+static const uint32_t DEVICE_RESET_MS                = 100;
+
+SEN5xSimulator::SEN5xSimulator(SEN5x_model_t model) :
+    TwoWire(i2c1, PIN_WIRE1_SDA, PIN_WIRE1_SCL),
+    _model(model),
+    _profile(defaultProfile),
+    _busyUntil_ms(0),
+    _txAddress(0),
+    _txLength(0),
+    _responseLength(0),
+    _rxLength(0),
+    _rxPosition(0),
+    _failTransactions(0),
+    _corruptReads(0),
+    _transactions(0)
+{
+    resetDevice();
+};
+
+void SEN5xSimulator::setProfile(profile_t profile)
+{
+    _profile = profile ? profile : defaultProfile;
+}
+
+void SEN5xSimulator::failTransactions(uint16_t count)
+{
+    _failTransactions = count;
+}
+
+void SEN5xSimulator::corruptReads(uint16_t count)
+{
+    _corruptReads = count;
+}
+
+void SEN5xSimulator::setDeviceStatus(uint32_t bits)
+{
+    _deviceStatus |= bits;
+}
+
+uint32_t SEN5xSimulator::getTransactions() const
+{
+    return _transactions;
+}
+
+// Power on state, volatile parameters revert to their defaults
+void SEN5xSimulator::resetDevice()
+{
+    static const parameter_t defaults[] = {
+        { CMD_TEMPERATURE_COMPENSATION, 3, false, { 0, 0, 0 } },
+        { CMD_WARM_START,               1, true,  { 0 } },
+        { CMD_VOC_TUNING,               6, true,  { 100, 12, 12, 180, 50, 230 } },
+        { CMD_NOX_TUNING,               6, true,  { 1, 12, 12, 720, 50, 230 } },
+        { CMD_RHT_ACCELERATION,         1, true,  { 0 } },
+        { CMD_VOC_STATE,                4, true,  { 0, 0, 0, 0 } },
+        { CMD_AUTO_CLEANING_INTERVAL,   2, false, { 0x0009, 0x3A80 } },    // 604800s, 1 week
+    };
+    memcpy(_parameters, defaults, sizeof(_parameters));
+
+    _measuring = false;
+    _gasOnly = false;
+    _measureStart_ms = 0;
+    _nextMeasurement_ms = 0;
+    _dataReady = false;
+    _measurement = { SEN5x_PM_UNKNOWN, SEN5x_PM_UNKNOWN, SEN5x_PM_UNKNOWN, SEN5x_PM_UNKNOWN,
+                     SEN5x_UNKNOWN, SEN5x_UNKNOWN, SEN5x_UNKNOWN, SEN5x_UNKNOWN };
+    _fanCleaningStart_ms = 0;
+    _deviceStatus = 0;
+    _responseLength = 0;
+}
+
+SEN5xSimulator::parameter_t* SEN5xSimulator::findParameter(uint16_t command)
+{
+    for (parameter_t& p : _parameters)
+    {
+        if (p.command == command)
+            return &p;
+    }
+    return nullptr;
+}
+
+// Sensirion CRC-8, polynomial 0x31 initialised to 0xFF, over each 16 bit word
+uint8_t SEN5xSimulator::crc(uint8_t msb, uint8_t lsb)
+{
+    uint8_t crc = 0xFF;
+    const uint8_t data[2] = { msb, lsb };
+    for (uint8_t b : data)
+    {
+        crc ^= b;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+    }
+    return crc;
+}
+
+void SEN5xSimulator::respond(const uint16_t* words, uint8_t count)
+{
+    _responseLength = 0;
+    for (uint8_t i = 0; i < count && _responseLength + 3 <= BUFFER_SIZE; i++)
+    {
+        uint8_t msb = words[i] >> 8;
+        uint8_t lsb = words[i] & 0xFF;
+        _response[_responseLength++] = msb;
+        _response[_responseLength++] = lsb;
+        _response[_responseLength++] = crc(msb, lsb);
+    }
+}
+
+// Null padded string packed two characters per word
+void SEN5xSimulator::respondString(const char* s, uint8_t words)
+{
+    uint16_t packed[MAX_WORDS] = { 0 };
+    size_t len = strlen(s);
+    for (size_t i = 0; i < len && i < (size_t)words * 2 - 1; i++)
+        packed[i / 2] |= (uint8_t)s[i] << ((i % 2) ? 0 : 8);
+    respond(packed, words);
+}
+
+// Typical indoor air drifting over an hour
+void SEN5xSimulator::defaultProfile(uint32_t elapsed_ms, SEN5x_telemetry_t& t)
+{
+    float drift = sinf(2 * PI * (elapsed_ms % 3600000UL) / 3600000.0f);
+
+    uint16_t pm2p5    = 50 + lroundf(30 * drift);      // 5.0 ± 3.0 µg/m³
+    t.pm1p0           = pm2p5 * 8 / 10;
+    t.pm2p5           = pm2p5;
+    t.pm4p0           = pm2p5 * 11 / 10;
+    t.pm10p0          = pm2p5 * 12 / 10;
+    t.humidityPercent = 4500 + lroundf(500 * drift);   // 45 ± 5 %RH
+    t.tempCelsuis     = 4400 + lroundf(400 * drift);   // 22 ± 2 °C
+    t.vocIndex        = 1000 + lroundf(300 * drift);   // 100 ± 30
+    t.noxIndex        = 10 + lroundf(10 * drift);      // 1 ± 1
+}
+
+void SEN5xSimulator::updateStatus()
+{
+    if ((_deviceStatus & STATUS_FAN_CLEANING) && (millis() - _fanCleaningStart_ms) >= FAN_CLEANING_MS)
+        _deviceStatus &= ~STATUS_FAN_CLEANING;
+}
+
+// Take a new measurement each interval while measuring
+void SEN5xSimulator::measure()
+{
+    if (!_measuring || (int32_t)(millis() - _nextMeasurement_ms) < 0)
+        return;
+
+    uint32_t elapsed = millis() - _measureStart_ms;
+    _nextMeasurement_ms = millis() + MEASUREMENT_INTERVAL_MS;
+
+    SEN5x_telemetry_t t;
+    _profile(elapsed, t);
+
+    // temperature offset is scaled by 200, as is temperature
+    t.tempCelsuis += (int16_t)findParameter(CMD_TEMPERATURE_COMPENSATION)->value[0];
+
+    // PM is not measured in gas only mode or while the fan is being cleaned
+    if (_gasOnly || (_deviceStatus & STATUS_FAN_CLEANING))
+        t.pm1p0 = t.pm2p5 = t.pm4p0 = t.pm10p0 = SEN5x_PM_UNKNOWN;
+
+    if (elapsed < GAS_BLACKOUT_MS)
+        t.vocIndex = t.noxIndex = SEN5x_UNKNOWN;
+
+    if (_model == SEN50)
+        t.humidityPercent = t.tempCelsuis = t.vocIndex = SEN5x_UNKNOWN;
+    if (_model != SEN55)
+        t.noxIndex = SEN5x_UNKNOWN;
+
+    _measurement = t;
+    _dataReady = true;
+}
+
+// Execute a command, returns the i2c result the master sees
+uint8_t SEN5xSimulator::execute(uint16_t command, const uint16_t* words, uint8_t count)
+{
+    _responseLength = 0;
+    uint32_t execution_ms = EXECUTION_MS;
+
+    switch (command)
+    {
+    case CMD_DEVICE_RESET:
+        resetDevice();
+        execution_ms = DEVICE_RESET_MS;
+        break;
+
+    case CMD_START_MEASUREMENT:
+    case CMD_START_MEASUREMENT_GAS_ONLY:
+        if (_measuring)
+            return I2C_NACK_DATA;
+        _measuring = true;
+        _gasOnly = (command == CMD_START_MEASUREMENT_GAS_ONLY);
+        _measureStart_ms = millis();
+        _nextMeasurement_ms = millis() + MEASUREMENT_INTERVAL_MS;
+        _dataReady = false;
+        execution_ms = START_MEASUREMENT_MS;
+        break;
+
+    case CMD_STOP_MEASUREMENT:
+        _measuring = false;
+        _dataReady = false;
+        execution_ms = STOP_MEASUREMENT_MS;
+        break;
+
+    case CMD_READ_DATA_READY:
+    {
+        uint16_t ready = _dataReady ? 1 : 0;
+        respond(&ready, 1);
+        break;
+    }
+
+    case CMD_READ_MEASURED_VALUES:
+    {
+        if (!_measuring)
+            return I2C_NACK_DATA;
+        const SEN5x_telemetry_t& t = _measurement;
+        uint16_t values[8] = {
+            t.pm1p0, t.pm2p5, t.pm4p0, t.pm10p0,
+            (uint16_t)t.humidityPercent, (uint16_t)t.tempCelsuis,
+            (uint16_t)t.vocIndex, (uint16_t)t.noxIndex
+        };
+        respond(values, 8);
+        _dataReady = false;
+        break;
+    }
+
+    case CMD_START_FAN_CLEANING:
+        if (!_measuring)
+            return I2C_NACK_DATA;
+        _deviceStatus |= STATUS_FAN_CLEANING;
+        _fanCleaningStart_ms = millis();
+        break;
+
+    case CMD_READ_PRODUCT_NAME:
+        respondString(_model == SEN50 ? "SEN50" : _model == SEN54 ? "SEN54" : "SEN55", 16);
+        break;
+
+    case CMD_READ_SERIAL_NUMBER:
+        respondString("SIM0000000000001", 16);
+        break;
+
+    case CMD_READ_VERSION:
+    {
+        // firmware 2.0, hardware 4.0, protocol 1.0
+        uint16_t version[4] = { 0x0200, 0x0004, 0x0001, 0x0000 };
+        respond(version, 4);
+        break;
+    }
+
+    case CMD_READ_DEVICE_STATUS:
+    case CMD_READ_CLEAR_DEVICE_STATUS:
+    {
+        uint16_t status[2] = { (uint16_t)(_deviceStatus >> 16), (uint16_t)(_deviceStatus & 0xFFFF) };
+        respond(status, 2);
+        // the fan cleaning flag reflects current state so is not cleared
+        if (command == CMD_READ_CLEAR_DEVICE_STATUS)
+            _deviceStatus &= STATUS_FAN_CLEANING;
+        break;
+    }
+
+    default:
+    {
+        parameter_t* p = findParameter(command);
+        if (!p)
+            return I2C_NACK_DATA;
+
+        if (count == 0)
+        {
+            respond(p->value, p->words);
+        }
+        else
+        {
+            if (count != p->words || (p->idleOnly && _measuring))
+                return I2C_NACK_DATA;
+            memcpy(p->value, words, count * sizeof(uint16_t));
+        }
+        break;
+    }
+    }
+
+    _busyUntil_ms = millis() + execution_ms;
+    return I2C_OK;
+}
+
+void SEN5xSimulator::begin()
+{
+    // no hardware to initialise
+}
+
+void SEN5xSimulator::begin(uint8_t address)
+{
+    // slave mode is not simulated
+}
+
+void SEN5xSimulator::end()
+{
+}
+
+void SEN5xSimulator::setClock(uint32_t freqHz)
+{
+}
+
+void SEN5xSimulator::beginTransmission(uint8_t address)
+{
+    _txAddress = address;
+    _txLength = 0;
+}
+
+uint8_t SEN5xSimulator::endTransmission(bool stopBit)
+{
+    _transactions++;
+    if (_txAddress != I2C_ADDRESS)
+        return I2C_NACK_ADDRESS;
+
+    if (_failTransactions > 0)
+    {
+        _failTransactions--;
+        return I2C_NACK_ADDRESS;
+    }
+
+    // the sensor does not acknowledge while executing a command
+    if ((int32_t)(millis() - _busyUntil_ms) < 0)
+        return I2C_NACK_ADDRESS;
+
+    if (_txLength < 2 || (_txLength - 2) % 3 != 0 || (_txLength - 2) / 3 > MAX_WORDS)
+        return I2C_NACK_DATA;
+
+    updateStatus();
+    measure();
+
+    uint16_t command = (_tx[0] << 8) | _tx[1];
+    uint16_t words[MAX_WORDS];
+    uint8_t count = (_txLength - 2) / 3;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint8_t* w = &_tx[2 + i * 3];
+        if (crc(w[0], w[1]) != w[2])
+            return I2C_NACK_DATA;
+        words[i] = (w[0] << 8) | w[1];
+    }
+
+    return execute(command, words, count);
+}
+
+uint8_t SEN5xSimulator::endTransmission()
+{
+    return endTransmission(true);
+}
+
+size_t SEN5xSimulator::requestFrom(uint8_t address, size_t quantity, bool stopBit)
+{
+    _transactions++;
+    _rxLength = 0;
+    _rxPosition = 0;
+
+    if (address != I2C_ADDRESS)
+        return 0;
+
+    if (_failTransactions > 0)
+    {
+        _failTransactions--;
+        return 0;
+    }
+
+    if ((int32_t)(millis() - _busyUntil_ms) < 0 || _responseLength == 0)
+        return 0;
+
+    size_t length = min(quantity, _responseLength);
+    memcpy(_rx, _response, length);
+    _responseLength = 0;
+
+    if (_corruptReads > 0 && length >= 3)
+    {
+        _corruptReads--;
+        _rx[2] ^= 0xFF;
+    }
+
+    _rxLength = length;
+    return length;
+}
+
+size_t SEN5xSimulator::requestFrom(uint8_t address, size_t quantity)
+{
+    return requestFrom(address, quantity, true);
+}
+
+size_t SEN5xSimulator::write(uint8_t data)
+{
+    if (_txLength >= BUFFER_SIZE)
+        return 0;
+    _tx[_txLength++] = data;
+    return 1;
+}
+
+size_t SEN5xSimulator::write(const uint8_t* data, size_t quantity)
+{
+    size_t written = 0;
+    while (written < quantity && write(data[written]))
+        written++;
+    return written;
+}
+
+int SEN5xSimulator::available()
+{
+    return _rxLength - _rxPosition;
+}
+
+int SEN5xSimulator::read()
+{
+    return _rxPosition < _rxLength ? _rx[_rxPosition++] : -1;
+}
+
+int SEN5xSimulator::peek()
+{
+    return _rxPosition < _rxLength ? _rx[_rxPosition] : -1;
+}
+
+void SEN5xSimulator::flush()
+{
+}
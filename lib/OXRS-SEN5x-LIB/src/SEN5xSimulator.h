@@ -0,0 +1,117 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include "OXRS_SEN5x.h"
+
+/*
+ * Software model of a SEN5x on the i2c bus, for running OXRS_SEN5x without
+ * a sensor attached. It stands in for the TwoWire the library is given and
+ * answers the SEN5x command set with CRC-8 framed words, refusing reads
+ * until each command's execution time has passed (as the sensor does).
+ *
+ * Measurements follow a profile callback, by default a slow drift around
+ * typical indoor values, and faults (NACKs, corrupt CRCs, device status
+ * bits) can be injected to exercise error handling.
+ *
+ * Refer https://sensirion.com/media/documents/6791EFA0/62A1F68F/Sensirion_Datasheet_Environmental_Node_SEN5x.pdf
+ */
+class SEN5xSimulator : public TwoWire
+{
+public:
+    // Fill t with the measurement elapsed_ms after measurement started
+    typedef void (*profile_t)(uint32_t elapsed_ms, SEN5x_telemetry_t& t);
+
+    SEN5xSimulator(SEN5x_model_t model);
+
+    void setProfile(profile_t profile);
+
+    // fault injection
+    void failTransactions(uint16_t count);      // NACK the next count transactions
+    void corruptReads(uint16_t count);          // corrupt a CRC in the next count reads
+    void setDeviceStatus(uint32_t bits);        // raise device status register bits
+
+    // transactions addressed to the sensor since construction
+    uint32_t getTransactions() const;
+
+    // TwoWire
+    void begin() override;
+    void begin(uint8_t address) override;
+    void end() override;
+    void setClock(uint32_t freqHz) override;
+    void beginTransmission(uint8_t address) override;
+    uint8_t endTransmission(bool stopBit) override;
+    uint8_t endTransmission() override;
+    size_t requestFrom(uint8_t address, size_t quantity, bool stopBit) override;
+    size_t requestFrom(uint8_t address, size_t quantity) override;
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t* data, size_t quantity) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+
+    static void defaultProfile(uint32_t elapsed_ms, SEN5x_telemetry_t& t);
+
+private:
+    inline static const uint8_t  I2C_ADDRESS         = 0x69;
+    inline static const size_t   BUFFER_SIZE         = 64;
+    inline static const uint8_t  MAX_WORDS           = 16;
+
+    inline static const uint32_t MEASUREMENT_INTERVAL_MS = 1000;
+    inline static const uint32_t GAS_BLACKOUT_MS     = 10000;   // VOC/NOx unknown after start
+    inline static const uint32_t FAN_CLEANING_MS     = 10000;
+
+    // i2c transmission results
+    inline static const uint8_t  I2C_OK              = 0;
+    inline static const uint8_t  I2C_NACK_ADDRESS    = 2;
+    inline static const uint8_t  I2C_NACK_DATA       = 3;
+
+    // device status register bits
+    inline static const uint32_t STATUS_FAN_CLEANING = 1UL << 19;
+
+    // Parameters that are simply stored and read back
+    typedef struct {
+        uint16_t command;
+        uint8_t  words;
+        bool     idleOnly;                      // only writable in idle mode
+        uint16_t value[6];
+    } parameter_t;
+
+    parameter_t* findParameter(uint16_t command);
+    void resetDevice();
+    uint8_t execute(uint16_t command, const uint16_t* words, uint8_t count);
+    void respond(const uint16_t* words, uint8_t count);
+    void respondString(const char* s, uint8_t words);
+    void measure();
+    void updateStatus();
+
+    static uint8_t crc(uint8_t msb, uint8_t lsb);
+
+    SEN5x_model_t _model;
+    profile_t     _profile;
+
+    bool     _measuring;                        // measurement mode, else idle
+    bool     _gasOnly;                          // measuring without PM
+    uint32_t _measureStart_ms;                  // time measurement started
+    uint32_t _nextMeasurement_ms;               // time next measurement is due
+    bool     _dataReady;                        // measurement not yet read
+    SEN5x_telemetry_t _measurement;             // latest measurement
+    uint32_t _fanCleaningStart_ms;              // time fan cleaning started
+    uint32_t _deviceStatus;                     // device status register
+    uint32_t _busyUntil_ms;                     // end of command execution time
+
+    parameter_t _parameters[7];
+
+    uint8_t  _txAddress;
+    uint8_t  _tx[BUFFER_SIZE];
+    size_t   _txLength;
+    uint8_t  _response[BUFFER_SIZE];            // prepared by last read command
+    size_t   _responseLength;
+    uint8_t  _rx[BUFFER_SIZE];                  // bytes requested by the master
+    size_t   _rxLength;
+    size_t   _rxPosition;
+
+    uint16_t _failTransactions;
+    uint16_t _corruptReads;
+    uint32_t _transactions;
+};
@@ -0,0 +1,71 @@
+#include <math.h>
+#include <SEN5xStatistics.h>
+
+SEN5xStatistics::SEN5xStatistics()
+{
+    reset();
+};
+
+void SEN5xStatistics::reset()
+{
+    _count = 0;
+    _min   = 0;
+    _max   = 0;
+    _last  = 0;
+    _shift = 0;
+    _sum   = 0;
+    _sumSq = 0;
+}
+
+void SEN5xStatistics::add(int32_t value)
+{
+    if (_count == 0 || value < _min)
+        _min = value;
+    if (_count == 0 || value > _max)
+        _max = value;
+    _last = value;
+
+    // shifting by a sample keeps the sums small and the variance free of
+    // cancellation when the spread is small relative to the values
+    if (_count == 0)
+        _shift = value;
+    int64_t shifted = (int64_t)value - _shift;
+    _count++;
+    _sum += shifted;
+    _sumSq += (uint64_t)(shifted * shifted);
+}
+
+uint32_t SEN5xStatistics::count() const
+{
+    return _count;
+}
+
+int32_t SEN5xStatistics::min() const
+{
+    return _min;
+}
+
+int32_t SEN5xStatistics::max() const
+{
+    return _max;
+}
+
+int32_t SEN5xStatistics::last() const
+{
+    return _last;
+}
+
+float SEN5xStatistics::mean() const
+{
+    return (_count == 0) ? 0 : _shift + (double)_sum / _count;
+}
+
+float SEN5xStatistics::stddev() const
+{
+    if (_count < 2)
+        return 0;
+
+    double sum = (double)_sum;
+    double variance = ((double)_sumSq - sum * sum / _count) / (_count - 1);
+    return (variance > 0) ? sqrt(variance) : 0;
+}
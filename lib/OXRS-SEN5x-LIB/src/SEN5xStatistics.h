@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Streaming statistics for a single telemetry field over a publish window.
+ * Values are in the sensor's scaled integer format, each update is O(1) and
+ * memory is constant regardless of window length. Samples are accumulated
+ * as exact integer sums shifted by the first sample, so stay exact over long
+ * windows (up to a day of 1Hz samples) without soft-float on every add, only
+ * mean() and stddev() work in floating point.
+ */
+class SEN5xStatistics
+{
+public:
+    SEN5xStatistics();
+
+    void reset();
+    void add(int32_t value);
+
+    uint32_t count() const;
+    int32_t  min() const;
+    int32_t  max() const;
+    int32_t  last() const;
+    float    mean() const;
+    float    stddev() const;    // sample standard deviation, 0 if less than 2 samples
+
+private:
+    uint32_t _count;    // samples in window
+    int32_t  _min;      // minimum sample
+    int32_t  _max;      // maximum sample
+    int32_t  _last;     // most recent sample
+    int32_t  _shift;    // first sample, subtracted from each sample summed
+    int64_t  _sum;      // sum of shifted samples
+    uint64_t _sumSq;    // sum of squared shifted samples
+};
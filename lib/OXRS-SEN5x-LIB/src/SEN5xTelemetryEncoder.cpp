@@ -0,0 +1,179 @@
+#include <math.h>
+#include <string.h>
+#include <SEN5xTelemetryEncoder.h>
+
+SEN5xTelemetryEncoder::SEN5xTelemetryEncoder(char* buffer, size_t size) :
+    _buffer(buffer),
+    _size(size),
+    _len(0),
+    _overflow(false),
+    _first(true)
+{
+};
+
+void SEN5xTelemetryEncoder::begin()
+{
+    _len = 0;
+    _overflow = false;
+    _first = true;
+    append('{');
+}
+
+void SEN5xTelemetryEncoder::add(const char* key, int32_t raw, uint16_t scale, const char* suffix)
+{
+    appendKey(key, suffix);
+    appendHundredths(round2dp(raw, scale));
+}
+
+void SEN5xTelemetryEncoder::addDerived(const char* key, float raw, uint16_t scale, const char* suffix)
+{
+    appendKey(key, suffix);
+    appendHundredths(lroundf(raw * 100 / scale));
+}
+
+size_t SEN5xTelemetryEncoder::end()
+{
+    append('}');
+
+    if (_overflow || _len >= _size)
+    {
+        if (_size > 0)
+            _buffer[0] = '\0';
+        return 0;
+    }
+
+    _buffer[_len] = '\0';
+    return _len;
+}
+
+static uint8_t bitLength(uint64_t v)
+{
+    uint8_t n = 0;
+    while (v)
+    {
+        n++;
+        v >>= 1;
+    }
+    return n;
+}
+
+// Round v >> shift to nearest, ties to even
+static uint64_t shiftRoundEven(uint64_t v, uint8_t shift)
+{
+    if (shift == 0)
+        return v;
+    uint64_t q = v >> shift;
+    uint64_t rem = v & ((1ULL << shift) - 1);
+    uint64_t half = 1ULL << (shift - 1);
+    if (rem > half || (rem == half && (q & 1)))
+        q++;
+    return q;
+}
+
+/*
+ * Integer only equivalent of round2dp((float)raw / scale), reproducing the
+ * float rounding of the division and of the multiply by 100 so the output is
+ * identical to the float path for every raw value the sensor can report.
+ */
+int32_t SEN5xTelemetryEncoder::round2dp(int32_t raw, uint16_t scale)
+{
+    if (raw == 0)
+        return 0;
+
+    uint64_t magnitude = raw < 0 ? -(int64_t)raw : raw;
+
+    // float(raw) / float(scale): 24 bit mantissa m, value = m * 2^-k
+    int8_t k = 24 + bitLength(scale) - bitLength(magnitude);
+    uint64_t q = (magnitude << k) / scale;
+    while (q >= (1ULL << 24))
+        q = (magnitude << --k) / scale;
+    while (q < (1ULL << 23))
+        q = (magnitude << ++k) / scale;
+    uint64_t rem = (magnitude << k) - q * scale;
+    if (2 * rem > scale || (2 * rem == scale && (q & 1)))
+        q++;
+    if (q == (1ULL << 24))
+    {
+        q >>= 1;
+        k--;
+    }
+
+    // value * 100: rounded back to a 24 bit mantissa, value = m * 2^(s - k)
+    uint64_t p = q * 100;
+    uint8_t s = bitLength(p) - 24;
+    p = shiftRoundEven(p, s);
+    if (p == (1ULL << 24))
+    {
+        p >>= 1;
+        s++;
+    }
+
+    // (int)(value + 0.5), truncating towards zero
+    int64_t n = raw < 0 ? -(int64_t)p : (int64_t)p;
+    int16_t t = s - k;
+    if (t >= 0)
+    {
+        int64_t x = n * (1LL << t);
+        return x >= 0 ? x : x + 1;
+    }
+    if (-t > 40)
+        return 0;
+    int64_t d = 1LL << -t;
+    return (n + d / 2) / d;
+}
+
+void SEN5xTelemetryEncoder::append(char c)
+{
+    // always leave room for the terminator
+    if (_len + 1 < _size)
+        _buffer[_len++] = c;
+    else
+        _overflow = true;
+}
+
+void SEN5xTelemetryEncoder::appendKey(const char* key, const char* suffix)
+{
+    if (!_first)
+        append(',');
+    _first = false;
+
+    append('"');
+    append(key);
+    append(suffix);
+    append('"');
+    append(':');
+}
+
+void SEN5xTelemetryEncoder::append(const char* s)
+{
+    while (*s)
+        append(*s++);
+}
+
+// Emit hundredths as a decimal, e.g. 2350 -> "23.5", 2300 -> "23", -5 -> "-0.05"
+void SEN5xTelemetryEncoder::appendHundredths(int32_t value)
+{
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : value;
+    if (value < 0)
+        append('-');
+
+    uint32_t whole = magnitude / 100;
+    uint32_t fraction = magnitude % 100;
+
+    char digits[10];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + (whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+    while (n > 0)
+        append(digits[--n]);
+
+    if (fraction > 0)
+    {
+        append('.');
+        append('0' + fraction / 10);
+        if (fraction % 10)
+            append('0' + fraction % 10);
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Encodes telemetry as a flat json object directly into a caller provided
+ * buffer, avoiding the heap allocations of building a JsonDocument and
+ * serialising it. Values are emitted with two decimal places and trailing
+ * zeros trimmed, matching ArduinoJson's serialisation of a rounded double.
+ *
+ * Sensor values are kept in the SEN5x's scaled integer format and formatted
+ * using integer arithmetic only, the RP2040 has no FPU.
+ */
+class SEN5xTelemetryEncoder
+{
+public:
+    SEN5xTelemetryEncoder(char* buffer, size_t size);
+
+    void begin();
+    // value raw / scale, key optionally suffixed e.g. "pm2p5" "_max"
+    void add(const char* key, int32_t raw, uint16_t scale, const char* suffix = "");
+    // derived value (e.g. mean) in scaled units
+    void addDerived(const char* key, float raw, uint16_t scale, const char* suffix = "");
+    size_t end();                               // payload length, 0 if buffer too small
+
+    static int32_t round2dp(int32_t raw, uint16_t scale);     // value in hundredths
+
+private:
+    void append(char c);
+    void append(const char* s);
+    void appendKey(const char* key, const char* suffix);
+    void appendHundredths(int32_t value);
+
+    char*  _buffer;     // output buffer
+    size_t _size;       // output buffer size
+    size_t _len;        // bytes written, excluding terminator
+    bool   _overflow;   // output truncated
+    bool   _first;      // no field written yet
+};
@@ -0,0 +1,78 @@
+#include <stddef.h>
+#include <LittleFS.h>
+#include <OXRS_LOG.h>
+#include <SEN5xVocState.h>
+
+static const char *_LOG_PREFIX = "[SEN5xVocState] ";
+
+SEN5xVocState::SEN5xVocState() :
+    _hasSaved(false)
+{
+};
+
+uint8_t SEN5xVocState::checksum(const record_t& record)
+{
+    const uint8_t* p = (const uint8_t*)&record;
+    uint8_t sum = 0;
+    for (size_t i = 0; i < offsetof(record_t, checksum); i++)
+        sum = (sum << 1 | sum >> 7) ^ p[i];
+    return sum;
+}
+
+bool SEN5xVocState::save(const uint8_t state[STATE_SIZE], time_t timestamp)
+{
+    // the state barely moves once learnt, skip identical writes
+    if (_hasSaved && memcmp(_saved, state, STATE_SIZE) == 0)
+        return true;
+
+    record_t record;
+    memset(&record, 0, sizeof(record));
+    record.magic     = STATE_MAGIC;
+    record.timestamp = (uint32_t)timestamp;
+    memcpy(record.state, state, STATE_SIZE);
+    record.checksum  = checksum(record);
+
+    File file = LittleFS.open(STATE_TMP_FILE, "w");
+    if (!file)
+    {
+        LOG_ERROR(F("Failed to open VOC state file for writing"));
+        return false;
+    }
+    size_t written = file.write((const uint8_t*)&record, sizeof(record));
+    file.close();
+
+    if (written != sizeof(record) || !LittleFS.rename(STATE_TMP_FILE, STATE_FILE))
+    {
+        LOG_ERROR(F("Failed to write VOC state file"));
+        LittleFS.remove(STATE_TMP_FILE);
+        return false;
+    }
+
+    memcpy(_saved, state, STATE_SIZE);
+    _hasSaved = true;
+    return true;
+}
+
+bool SEN5xVocState::load(uint8_t state[STATE_SIZE], time_t& timestamp)
+{
+    File file = LittleFS.open(STATE_FILE, "r");
+    if (!file)
+        return false;
+
+    record_t record;
+    size_t read = file.read((uint8_t*)&record, sizeof(record));
+    file.close();
+
+    if (read != sizeof(record) || record.magic != STATE_MAGIC || record.checksum != checksum(record))
+    {
+        LOG_WARN(F("Ignoring corrupt VOC state file"));
+        return false;
+    }
+
+    memcpy(state, record.state, STATE_SIZE);
+    timestamp = (time_t)record.timestamp;
+
+    memcpy(_saved, state, STATE_SIZE);
+    _hasSaved = true;
+    return true;
+}
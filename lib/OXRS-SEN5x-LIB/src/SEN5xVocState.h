@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+ * Persists the SEN5x VOC algorithm state to LittleFS so the VOC index can
+ * skip its learning phase after a reboot or sensor reset. The state is
+ * stored with the epoch time it was taken so stale state can be ignored.
+ * Writes go to a temporary file and are renamed into place, and identical
+ * state is never rewritten, to limit flash wear.
+ */
+class SEN5xVocState
+{
+public:
+    SEN5xVocState();
+
+    inline static const uint8_t STATE_SIZE = 8;
+
+    // Write state taken at timestamp (epoch seconds), true if stored or unchanged
+    bool save(const uint8_t state[STATE_SIZE], time_t timestamp);
+
+    // Read the last stored state, false if missing or corrupt
+    bool load(uint8_t state[STATE_SIZE], time_t& timestamp);
+
+private:
+    inline static const char*    STATE_FILE     = "/sen5xVocState.bin";
+    inline static const char*    STATE_TMP_FILE = "/sen5xVocState.tmp";
+    inline static const uint32_t STATE_MAGIC    = 0x53355631;   // "S5V1"
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t timestamp;                 // epoch seconds
+        uint8_t  state[STATE_SIZE];
+        uint8_t  checksum;
+    } record_t;
+
+    static uint8_t checksum(const record_t& record);
+
+    uint8_t _saved[STATE_SIZE];             // last state written or read
+    bool    _hasSaved;                      // _saved is valid
+};
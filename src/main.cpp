@@ -4,6 +4,9 @@
 #include <OXRS_LOG.h>
 #include <OXRS_HASS.h>
 #include <OXRS_SEN5x.h>
+#ifdef SEN5x_SIMULATOR
+#include <SEN5xSimulator.h>
+#endif
 
 /*
 Code assumes I2C0 and default Wire(0)
@@ -13,6 +16,12 @@ PicoW::GND  (PIN3)     -> SEN5x::GND (PIN2)
 PicoW::I2C0 SDA (PIN6) -> SEN5x::SDA (PIN3)
 PicoW::I2C0 SCL (PIN7) -> SEN5x::SCL (PIN4)
 PicoW::GND  (PIN3)     -> SEN5x::SEL (PIN5)
+
+Build with SEN5x_CORE1 defined to acquire from the SEN5x on core1, leaving
+core0 to networking and publishing.
+
+Build with SEN5x_SIMULATOR defined to run against a simulated SEN55 when
+no sensor is connected.
 */
 
 // OXRS layer
@@ -21,6 +30,12 @@ OXRS_IO_PICO oxrsPico(usePicoOnboardTempSensor);
 
 // Sensirion air quality sensor
 OXRS_SEN5x oxrsSen5x(SEN5x_model_t::SEN55);
+#ifdef SEN5x_SIMULATOR
+SEN5xSimulator sen5xSimulator(SEN5x_model_t::SEN55);
+TwoWire& sen5xWire = sen5xSimulator;
+#else
+TwoWire& sen5xWire = Wire;
+#endif
 
 // Home assistant discovery config
 OXRS_HASS hass(oxrsPico.getMQTT());
@@ -76,6 +91,49 @@ void setCommandSchema()
     oxrsPico.setCommandSchema(commands);
 }
 
+// Prometheus metrics of the latest sample drained for telemetry, no i2c access
+void sen5xMetrics(MetricsWriter& metrics)
+{
+    SEN5x_sample_t sample;
+    if (oxrsSen5x.getLatestSample(sample))
+    {
+        const SEN5x_telemetry_t& t = sample.telemetry;
+
+        // fields the model does not measure are reported unknown, and left out
+        metrics.describe("sen5x_pm_ug_m3", "gauge", "Particulate matter mass concentration");
+        if (t.pm1p0 != SEN5x_PM_UNKNOWN)
+            metrics.sample("sen5x_pm_ug_m3", (int32_t)t.pm1p0, SEN5x_PM_SCALE, "size", "1.0");
+        if (t.pm2p5 != SEN5x_PM_UNKNOWN)
+            metrics.sample("sen5x_pm_ug_m3", (int32_t)t.pm2p5, SEN5x_PM_SCALE, "size", "2.5");
+        if (t.pm4p0 != SEN5x_PM_UNKNOWN)
+            metrics.sample("sen5x_pm_ug_m3", (int32_t)t.pm4p0, SEN5x_PM_SCALE, "size", "4.0");
+        if (t.pm10p0 != SEN5x_PM_UNKNOWN)
+            metrics.sample("sen5x_pm_ug_m3", (int32_t)t.pm10p0, SEN5x_PM_SCALE, "size", "10.0");
+
+        if (t.humidityPercent != SEN5x_UNKNOWN)
+            metrics.gauge("sen5x_humidity_percent", "Relative humidity", t.humidityPercent, SEN5x_HUMIDITY_SCALE);
+        if (t.tempCelsuis != SEN5x_UNKNOWN)
+            metrics.gauge("sen5x_temperature_celsius", "Temperature", t.tempCelsuis, SEN5x_TEMPERATURE_SCALE);
+        if (t.vocIndex != SEN5x_UNKNOWN)
+            metrics.gauge("sen5x_voc_index", "VOC index", t.vocIndex, SEN5x_INDEX_SCALE);
+        if (t.noxIndex != SEN5x_UNKNOWN)
+            metrics.gauge("sen5x_nox_index", "NOx index", t.noxIndex, SEN5x_INDEX_SCALE);
+
+        metrics.gauge("sen5x_sample_age_seconds", "Time since the latest sample was acquired",
+            (int32_t)(millis() - sample.timestamp_ms), 1000);
+    }
+
+    metrics.describe("sen5x_device_status", "gauge", "Device status register bits");
+    oxrsSen5x.getDeviceStatus().forEachBit([&metrics](const char* name, bool set) {
+        metrics.sample("sen5x_device_status", (uint32_t)set, "bit", name);
+    });
+
+    metrics.gauge("sen5x_i2c_transactions_per_minute", "I2C commands issued over the last minute",
+        oxrsSen5x.getI2CTransactionsPerMinute());
+    metrics.counter("sen5x_telemetry_published_total", "Telemetry published", oxrsSen5x.getPublishedCount());
+    metrics.counter("sen5x_telemetry_suppressed_total", "Telemetry suppressed by the deadband", oxrsSen5x.getSuppressedCount());
+}
+
 // FIXME: Move this to OXRS_SEN5x_LIB
 void publishHassDiscovery()
 {
@@ -175,6 +233,10 @@ void publishHassDiscovery()
     LOG_DEBUG(F("haas published"));
 }
 
+#ifdef SEN5x_CORE1
+static volatile bool core0Ready = false;
+#endif
+
 void setup()
 {
     Serial.begin();
@@ -186,23 +248,54 @@ void setup()
     delay(1000);            // Give the serial terminal a chance to connect, if present
     Serial.println("Serial initialised");
 
-    Wire.begin();
+#ifndef SEN5x_CORE1
+    sen5xWire.begin();
+#endif
 
     // jsonConfig and jsonCommand are callbacks invoked when the admin API/UI updates
     oxrsPico.begin(jsonConfig, jsonCommand);
+    oxrsPico.onMetrics(sen5xMetrics);
 
     // set up config/command schema for self discovery and adoption
     setConfigSchema();
     setCommandSchema();
 
+#ifndef SEN5x_CORE1
     // setup Sensirion AQS
-    oxrsSen5x.begin(Wire);
+    oxrsSen5x.begin(sen5xWire);
+#else
+    // both cores log, so loggers must only be written from core0's pump
+    oxrsLog.setAsync(true);
+    core0Ready = true;
+#endif
 }
 
+#ifdef SEN5x_CORE1
+void setup1()
+{
+    // wait for core0 to finish setup so the logger and config are in place
+    while (!core0Ready)
+        delay(10);
+
+    sen5xWire.begin();
+
+    // setup Sensirion AQS
+    oxrsSen5x.begin(sen5xWire);
+}
+
+void loop1()
+{
+    oxrsSen5x.loop();
+}
+#endif
+
 static int cnt = 0;
 static int currheap = 0;
 static int prevheap = -1;
 
+// Telemetry payload, reused every loop to avoid heap allocations
+static char telemetry[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+
 void loop()
 {
 //    int sec = millis() / 1000;
@@ -211,19 +304,18 @@ void loop()
 
     oxrsPico.loop();
 
+#ifndef SEN5x_CORE1
     oxrsSen5x.loop();
+#endif
 
-    DynamicJsonDocument telemetry(4096);
-    oxrsSen5x.getTelemetry(telemetry.as<JsonVariant>());
-    if (telemetry.size() > 0)
+    size_t len = oxrsSen5x.getTelemetry(telemetry, sizeof(telemetry));
+    if (len > 0)
     {
-        oxrsPico.publishTelemetry(telemetry.as<JsonVariant>());
+        oxrsPico.publishTelemetry(telemetry, len);
 
         if (ISLOG_DEBUG)
         {
-            String jsonAsString;
-            serializeJson(telemetry, jsonAsString);
-            LOGF_DEBUG("%s", jsonAsString.c_str());
+            LOGF_DEBUG("%s", telemetry);
         }
 
         if (usePicoOnboardTempSensor) {
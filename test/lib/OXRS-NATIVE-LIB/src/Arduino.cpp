@@ -0,0 +1,271 @@
+#include <atomic>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <OXRS_NATIVE.h>
+
+SerialUSB Serial;
+RP2040 rp2040;
+
+static std::atomic<uint64_t> _offset_us(0);
+static std::atomic<bool>     _restarted(false);
+static thread_local uint8_t  _core = 0;
+static uint32_t              _random = 1;
+
+static uint64_t hostMicros()
+{
+    static const uint64_t start = [] {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }();
+
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 - start;
+}
+
+uint64_t time_us_64()
+{
+    return hostMicros() + _offset_us.load(std::memory_order_relaxed);
+}
+
+unsigned long millis()
+{
+    return (uint32_t)(time_us_64() / 1000);
+}
+
+unsigned long micros()
+{
+    return (uint32_t)time_us_64();
+}
+
+void delay(unsigned long ms)
+{
+    OXRSNative::advance(ms);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    OXRSNative::advanceMicros(us);
+}
+
+void yield()
+{
+    sched_yield();
+}
+
+uint32_t get_core_num()
+{
+    return _core;
+}
+
+// xorshift32, repeatable unless seeded
+long random(long max)
+{
+    if (max <= 0)
+        return 0;
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random % max;
+}
+
+long random(long min, long max)
+{
+    return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (seed)
+        _random = seed;
+}
+
+size_t SerialUSB::write(uint8_t c)
+{
+    return fwrite(&c, 1, 1, stderr);
+}
+
+size_t SerialUSB::write(const uint8_t* buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stderr);
+}
+
+void SerialUSB::flush()
+{
+    fflush(stderr);
+}
+
+void RP2040::restart()
+{
+    _restarted = true;
+}
+
+// the Pico W's heap, less what the firmware's statics leave
+static const int TOTAL_HEAP = 200 * 1024;
+
+int RP2040::getTotalHeap()
+{
+    return TOTAL_HEAP;
+}
+
+int RP2040::getUsedHeap()
+{
+    return OXRSNative::heapUsed();
+}
+
+int RP2040::getFreeHeap()
+{
+    return getTotalHeap() - getUsedHeap();
+}
+
+uint32_t RP2040::getCycleCount()
+{
+    return (uint32_t)getCycleCount64();
+}
+
+uint64_t RP2040::getCycleCount64()
+{
+    return time_us_64() * (f_cpu() / 1000000);
+}
+
+namespace OXRSNative {
+
+void advance(uint32_t ms)
+{
+    advanceMicros((uint64_t)ms * 1000);
+}
+
+void advanceMicros(uint64_t us)
+{
+    _offset_us.fetch_add(us, std::memory_order_relaxed);
+}
+
+void setCore(uint8_t core)
+{
+    _core = core;
+}
+
+bool restarted()
+{
+    return _restarted;
+}
+
+void clearRestarted()
+{
+    _restarted = false;
+}
+
+} // namespace OXRSNative
+
+/*
+ * Heap measurement, by wrapping glibc's allocator. Every allocation,
+ * including operator new's, is counted with its usable size.
+ */
+static std::atomic<size_t>   _heapUsed(0);
+static std::atomic<size_t>   _heapPeak(0);
+static std::atomic<uint32_t> _allocations(0);
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void* ptr);
+}
+
+static void* allocated(void* ptr)
+{
+    if (!ptr)
+        return ptr;
+
+    size_t used = _heapUsed.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed) + malloc_usable_size(ptr);
+    size_t peak = _heapPeak.load(std::memory_order_relaxed);
+    while (used > peak && !_heapPeak.compare_exchange_weak(peak, used, std::memory_order_relaxed));
+    _allocations.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+}
+
+static void released(void* ptr)
+{
+    if (ptr)
+        _heapUsed.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+}
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    return allocated(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size)
+{
+    return allocated(__libc_calloc(count, size));
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    released(ptr);
+    void* moved = __libc_realloc(ptr, size);
+
+    // on failure the original is kept
+    return allocated(moved ? moved : (size ? ptr : nullptr));
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    return allocated(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return allocated(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    void* p = allocated(__libc_memalign(alignment, size));
+    if (!p)
+        return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+void free(void* ptr)
+{
+    released(ptr);
+    __libc_free(ptr);
+}
+
+} // extern "C"
+#endif
+
+namespace OXRSNative {
+
+size_t heapUsed()
+{
+    return _heapUsed.load(std::memory_order_relaxed);
+}
+
+size_t heapPeak()
+{
+    return _heapPeak.load(std::memory_order_relaxed);
+}
+
+void resetHeapPeak()
+{
+    _heapPeak.store(heapUsed(), std::memory_order_relaxed);
+}
+
+uint32_t allocations()
+{
+    return _allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace OXRSNative
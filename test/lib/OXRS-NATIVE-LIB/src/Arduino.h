@@ -0,0 +1,146 @@
+/**
+ * OXRS-NATIVE
+ *
+ * Host stand-in for the parts of the arduino-pico core the OXRS libraries
+ * use, so they can be built and tested with `pio test -e native`. The API
+ * follows ArduinoCore-API and arduino-pico, the behaviour is what a test
+ * needs: delay() advances a virtual clock rather than sleeping, the heap
+ * is measured (see OXRS_NATIVE.h), and sockets and files are real.
+ *
+ * ARDUINO_ARCH_RP2040 is deliberately not defined, code that is specific
+ * to the chip (multicore, registers) stays out of native builds.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+
+typedef uint8_t  byte;
+typedef bool     boolean;
+typedef uint16_t word;
+
+// Flash strings are ordinary strings on the host
+class __FlashStringHelper;
+#define F(string_literal)       (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+#define PROGMEM
+#define PGM_P                   const char*
+#define PSTR(s)                 (s)
+#define pgm_read_byte(addr)     (*(const uint8_t*)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr)    (*(const uint32_t*)(addr))
+#define pgm_read_float(addr)    (*(const float*)(addr))
+#define pgm_read_ptr(addr)      (*(void* const*)(addr))
+#define strlen_P                strlen
+#define strcpy_P                strcpy
+#define strncpy_P               strncpy
+#define strcmp_P                strcmp
+#define strncmp_P               strncmp
+#define strcasecmp_P            strcasecmp
+#define memcpy_P                memcpy
+#define sprintf_P               sprintf
+#define snprintf_P              snprintf
+#define vsnprintf_P             vsnprintf
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+#define lowByte(w)  ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// As ArduinoCore-API, so arguments of different types compare as they would on the device
+template<class T, class L>
+auto min(const T& a, const L& b) -> decltype((b < a) ? b : a)
+{
+    return (b < a) ? b : a;
+}
+
+template<class T, class L>
+auto max(const T& a, const L& b) -> decltype((b < a) ? b : a)
+{
+    return (a < b) ? b : a;
+}
+
+// Pico W board
+#define PIN_WIRE0_SDA   4
+#define PIN_WIRE0_SCL   5
+#define PIN_WIRE1_SDA   26
+#define PIN_WIRE1_SCL   27
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+// Time, virtual on top of the host's monotonic clock
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Pico SDK
+uint64_t time_us_64();
+uint32_t get_core_num();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+#include <WString.h>
+#include <Print.h>
+#include <Stream.h>
+#include <IPAddress.h>
+#include <Client.h>
+#include <Server.h>
+
+// Serial output goes to stderr, keeping stdout for the test runner
+class SerialUSB : public Stream
+{
+public:
+    void begin(unsigned long baud = 115200) {};
+    void end() {};
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int availableForWrite() override { return 256; }
+    void flush() override;
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    operator bool() { return true; }
+
+    using Print::write;
+};
+extern SerialUSB Serial;
+
+// arduino-pico's rp2040 object, heap figures are measured on the host
+class RP2040
+{
+public:
+    void restart();
+    void reboot() { restart(); }
+
+    int getFreeHeap();
+    int getUsedHeap();
+    int getTotalHeap();
+
+    int cpuid() { return get_core_num(); }
+    uint32_t getCycleCount();
+    uint64_t getCycleCount64();
+    uint32_t f_cpu() { return 133000000; }
+
+    void idleOtherCore() {};
+    void resumeOtherCore() {};
+};
+extern RP2040 rp2040;
@@ -0,0 +1,23 @@
+#include <Arduino.h>
+
+bool IPAddress::fromString(const char* address)
+{
+    unsigned b[4];
+    char end;
+    if (sscanf(address, "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &end) != 4)
+        return false;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (b[i] > 255)
+            return false;
+        _address[i] = b[i];
+    }
+    return true;
+}
+
+String IPAddress::toString() const
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+    return String(text);
+}
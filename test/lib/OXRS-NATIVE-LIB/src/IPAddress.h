@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <WString.h>
+
+// IPv4 only, bytes in network order as on the device
+class IPAddress
+{
+public:
+    IPAddress() : _address{0, 0, 0, 0} {};
+    IPAddress(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) : _address{b0, b1, b2, b3} {};
+    IPAddress(uint32_t address) { memcpy(_address, &address, 4); }
+    IPAddress(const uint8_t* address) { memcpy(_address, address, 4); }
+
+    bool fromString(const char* address);
+    bool fromString(const String& address) { return fromString(address.c_str()); }
+
+    operator uint32_t() const { uint32_t address; memcpy(&address, _address, 4); return address; }
+    bool operator==(const IPAddress& rhs) const { return memcmp(_address, rhs._address, 4) == 0; }
+    bool operator!=(const IPAddress& rhs) const { return !(*this == rhs); }
+    uint8_t operator[](int index) const { return _address[index]; }
+    uint8_t& operator[](int index) { return _address[index]; }
+
+    bool isSet() const { return (uint32_t)*this != 0; }
+    String toString() const;
+
+private:
+    uint8_t _address[4];
+};
@@ -0,0 +1,191 @@
+#include <LittleFS.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+FS LittleFS;
+
+namespace fs {
+
+File::File(FILE* file, const char* path) :
+    _file(file, fclose),
+    _path(path)
+{
+};
+
+size_t File::write(const uint8_t* buf, size_t size)
+{
+    return _file ? fwrite(buf, 1, size, _file.get()) : 0;
+}
+
+int File::available()
+{
+    return _file ? size() - position() : 0;
+}
+
+int File::read()
+{
+    return _file ? fgetc(_file.get()) : -1;
+}
+
+size_t File::read(uint8_t* buf, size_t size)
+{
+    return _file ? fread(buf, 1, size, _file.get()) : 0;
+}
+
+int File::peek()
+{
+    if (!_file)
+        return -1;
+    int c = fgetc(_file.get());
+    if (c != EOF)
+        ungetc(c, _file.get());
+    return c;
+}
+
+void File::flush()
+{
+    if (_file)
+        fflush(_file.get());
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+    static const int whence[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+    return _file && fseek(_file.get(), pos, whence[mode]) == 0;
+}
+
+size_t File::position() const
+{
+    return _file ? ftell(_file.get()) : 0;
+}
+
+size_t File::size() const
+{
+    struct stat st;
+    if (!_file || fflush(_file.get()) != 0 || fstat(fileno(_file.get()), &st) != 0)
+        return 0;
+    return st.st_size;
+}
+
+const char* File::name() const
+{
+    const char* slash = strrchr(_path.c_str(), '/');
+    return slash ? slash + 1 : _path.c_str();
+}
+
+static int removeEntry(const char* path, const struct stat* st, int flag, struct FTW* ftw)
+{
+    return ftw->level ? ::remove(path) : 0;
+}
+
+static void removeRoot()
+{
+    const char* root = LittleFS.root();
+    if (!getenv("OXRS_NATIVE_FS"))
+    {
+        nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+        ::rmdir(root);
+    }
+}
+
+const char* FS::root()
+{
+    if (_root.empty())
+    {
+        const char* dir = getenv("OXRS_NATIVE_FS");
+        if (dir)
+        {
+            ::mkdir(dir, 0755);
+            _root = dir;
+        }
+        else
+        {
+            char path[] = "/tmp/oxrs-littlefs-XXXXXX";
+            if (!mkdtemp(path))
+                return nullptr;
+            _root = path;
+            atexit(removeRoot);
+        }
+    }
+    return _root.c_str();
+}
+
+std::string FS::hostPath(const char* path)
+{
+    std::string host(root());
+    if (path[0] != '/')
+        host += '/';
+    return host + path;
+}
+
+bool FS::format()
+{
+    return nftw(root(), removeEntry, 16, FTW_DEPTH | FTW_PHYS) == 0;
+}
+
+// Whole blocks per file, as LittleFS allocates them
+bool FS::info64(FSInfo64& info)
+{
+    memset(&info, 0, sizeof(info));
+    info.totalBytes    = TOTAL_BYTES;
+    info.blockSize     = BLOCK_SIZE;
+    info.pageSize      = 256;
+    info.maxOpenFiles  = 16;
+    info.maxPathLength = 32;
+
+    static uint64_t used;
+    used = 2 * BLOCK_SIZE;
+    nftw(root(), [](const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+        if (flag == FTW_F)
+            used += (st->st_size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+        return 0;
+    }, 16, FTW_PHYS);
+    info.usedBytes = used;
+    return true;
+}
+
+// Modes as fopen, parent directories are created as LittleFS does
+File FS::open(const char* path, const char* mode)
+{
+    std::string host = hostPath(path);
+    if (mode[0] != 'r')
+    {
+        for (size_t slash = host.find('/', strlen(root()) + 1); slash != std::string::npos; slash = host.find('/', slash + 1))
+            ::mkdir(host.substr(0, slash).c_str(), 0755);
+    }
+
+    struct stat st;
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+        return File();
+
+    FILE* file = fopen(host.c_str(), mode);
+    return file ? File(file, path) : File();
+}
+
+bool FS::exists(const char* path)
+{
+    return access(hostPath(path).c_str(), F_OK) == 0;
+}
+
+bool FS::remove(const char* path)
+{
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo)
+{
+    return ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path)
+{
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path)
+{
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+} // namespace fs
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <Arduino.h>
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+struct FSInfo64 {
+    uint64_t totalBytes;
+    uint64_t usedBytes;
+    size_t   blockSize;
+    size_t   pageSize;
+    size_t   maxOpenFiles;
+    size_t   maxPathLength;
+};
+
+// As arduino-pico's File, over a host file. Copies share it.
+class File : public Stream
+{
+public:
+    File() {};
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    size_t read(uint8_t* buf, size_t size);
+    int peek() override;
+    void flush() override;
+
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void close() { _file.reset(); }
+    operator bool() const { return (bool)_file; }
+    const char* name() const;
+    const char* fullName() const { return _path.c_str(); }
+    bool isFile() const { return (bool)_file; }
+    bool isDirectory() const { return false; }
+
+private:
+    friend class FS;
+    File(FILE* file, const char* path);
+
+    std::shared_ptr<FILE> _file;
+    String _path;
+};
+
+/*
+ * LittleFS over a host directory, a fresh temporary one per run unless
+ * OXRS_NATIVE_FS names one. Paths are relative to it.
+ */
+class FS
+{
+public:
+    inline static const uint64_t TOTAL_BYTES = 512 * 1024;      // board_build.filesystem_size
+    inline static const size_t   BLOCK_SIZE  = 4096;
+
+    bool begin() { return root() != nullptr; }
+    void end() {};
+    bool format();
+    bool info64(FSInfo64& info);
+
+    File open(const char* path, const char* mode);
+    File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* pathFrom, const char* pathTo);
+    bool rename(const String& pathFrom, const String& pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+
+    // the host directory
+    const char* root();
+
+private:
+    std::string hostPath(const char* path);
+
+    std::string _root;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::FSInfo64;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+extern FS LittleFS;
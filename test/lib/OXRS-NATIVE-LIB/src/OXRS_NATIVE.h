@@ -0,0 +1,34 @@
+/**
+ * OXRS-NATIVE
+ *
+ * Controls for native tests and benchmarks, alongside the Arduino and Pico
+ * stand-ins. The clock is the host's plus a virtual offset, advanced by
+ * delay() and advance(), so timeouts can be crossed without waiting. The
+ * heap is measured by wrapping the C library's allocator (glibc only,
+ * elsewhere the figures stay at 0).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+namespace OXRSNative {
+
+// Move millis()/micros() forward
+void advance(uint32_t ms);
+void advanceMicros(uint64_t us);
+
+// Core reported to the calling thread by get_core_num() and rp2040.cpuid()
+void setCore(uint8_t core);
+
+// Heap in use now, the most in use since resetHeapPeak(), and allocations made
+size_t heapUsed();
+size_t heapPeak();
+void resetHeapPeak();
+uint32_t allocations();
+
+// Set by rp2040.restart()
+bool restarted();
+void clearRestarted();
+
+} // namespace OXRSNative
@@ -0,0 +1,73 @@
+#include <Arduino.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        if (!write(*buffer++))
+            break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::print(long long n, int base)
+{
+    if (n < 0 && base == DEC)
+        return print('-') + print(0 - (unsigned long long)n, base);
+    return print((unsigned long long)n, base);
+}
+
+size_t Print::print(unsigned long long n, int base)
+{
+    if (base < 2)
+        base = DEC;
+
+    char buffer[65];
+    char* str = &buffer[sizeof(buffer) - 1];
+    *str = '\0';
+    do
+    {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
+
+size_t Print::print(double n, int digits)
+{
+    if (isnan(n))
+        return print("nan");
+    if (isinf(n))
+        return print("inf");
+
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+    return write(buffer);
+}
+
+size_t Print::printf(const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (len < 0)
+        return 0;
+    if ((size_t)len < sizeof(buffer))
+        return write(buffer, len);
+
+    // longer than the stack buffer
+    char* text = (char*)malloc(len + 1);
+    if (!text)
+        return 0;
+    va_start(args, format);
+    vsnprintf(text, len + 1, format, args);
+    va_end(args);
+    size_t n = write(text, len);
+    free(text);
+    return n;
+}
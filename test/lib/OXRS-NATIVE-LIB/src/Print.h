@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <WString.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// As ArduinoCore-API
+class Print
+{
+public:
+    Print() : _writeError(0) {};
+    virtual ~Print() {};
+
+    int getWriteError() { return _writeError; }
+    void clearWriteError() { _writeError = 0; }
+
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {};
+
+    size_t print(const __FlashStringHelper* str) { return write(reinterpret_cast<const char*>(str)); }
+    size_t print(const String& str) { return write(str.c_str(), str.length()); }
+    size_t print(const char str[]) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(long n, int base = DEC) { return print((long long)n, base); }
+    size_t print(unsigned long n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(long long n, int base = DEC);
+    size_t print(unsigned long long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    template <typename T>
+    size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+protected:
+    void setWriteError(int error = 1) { _writeError = error; }
+
+private:
+    int _writeError;
+};
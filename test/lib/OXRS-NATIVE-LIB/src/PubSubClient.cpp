@@ -0,0 +1,109 @@
+#include <PubSubClient.h>
+
+PubSubClient::PubSubClient(Client* client) :
+    connectAttempts(0),
+    _client(client),
+    _callback(nullptr),
+    _bufferSize(MQTT_MAX_PACKET_SIZE),
+    _connected(false),
+    _connectSucceeds(true),
+    _state(MQTT_DISCONNECTED),
+    _failPublishes(0),
+    _streamingLen(0),
+    _isStreaming(false)
+{
+};
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass)
+{
+    return connect(id, user, pass, nullptr, 0, false, nullptr);
+}
+
+bool PubSubClient::connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage)
+{
+    return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage);
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage, bool cleanSession)
+{
+    connectAttempts++;
+    setConnected(_connectSucceeds);
+    if (!_connectSucceeds)
+        _state = MQTT_CONNECT_FAILED;
+    return _connected;
+}
+
+void PubSubClient::disconnect()
+{
+    setConnected(false);
+}
+
+void PubSubClient::setConnected(bool connected)
+{
+    _connected = connected;
+    _state = connected ? MQTT_CONNECTED : MQTT_CONNECTION_LOST;
+    if (!connected)
+        _isStreaming = false;
+}
+
+bool PubSubClient::failing()
+{
+    if (!_failPublishes)
+        return false;
+    _failPublishes--;
+    return true;
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained)
+{
+    if (!connected() || failing())
+        return false;
+
+    // the whole packet is assembled in the buffer
+    if (MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + plength > _bufferSize)
+        return false;
+
+    published.push_back({ topic, std::string((const char*)payload, plength), retained });
+    return true;
+}
+
+bool PubSubClient::beginPublish(const char* topic, unsigned int plength, bool retained)
+{
+    if (!connected() || failing())
+        return false;
+
+    _streaming    = { topic, std::string(), retained };
+    _streamingLen = plength;
+    _isStreaming  = true;
+    return true;
+}
+
+size_t PubSubClient::write(const uint8_t* buffer, size_t size)
+{
+    if (!_isStreaming)
+        return 0;
+    _streaming.payload.append((const char*)buffer, size);
+    return size;
+}
+
+// A payload shorter or longer than declared would corrupt the stream
+int PubSubClient::endPublish()
+{
+    if (!_isStreaming)
+        return 0;
+    _isStreaming = false;
+    if (_streaming.payload.length() != _streamingLen)
+        return 0;
+
+    published.push_back(_streaming);
+    return 1;
+}
+
+void PubSubClient::deliver(const char* topic, const char* payload)
+{
+    if (!_callback)
+        return;
+
+    std::string t(topic), p(payload);
+    _callback(&t[0], (uint8_t*)&p[0], p.length());
+}
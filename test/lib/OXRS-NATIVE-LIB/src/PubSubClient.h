@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <Arduino.h>
+
+#ifndef MQTT_MAX_PACKET_SIZE
+#define MQTT_MAX_PACKET_SIZE 256
+#endif
+
+#define MQTT_MAX_HEADER_SIZE 5
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+#define MQTT_CONNECT_BAD_PROTOCOL    1
+#define MQTT_CONNECT_BAD_CLIENT_ID   2
+#define MQTT_CONNECT_UNAVAILABLE     3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED    5
+
+#define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
+
+/*
+ * In-process stand-in for PubSubClient with its API. Nothing is sent,
+ * publishes are recorded for the test to inspect, and the connection and
+ * publish failures are set by the test. A publish that would not fit the
+ * buffer fails, as it does on the device; beginPublish() streams and has
+ * no such limit.
+ */
+class PubSubClient : public Print
+{
+public:
+    typedef struct {
+        std::string topic;
+        std::string payload;
+        bool        retained;
+    } Published_t;
+
+    PubSubClient() : PubSubClient(nullptr) {};
+    PubSubClient(Client& client) : PubSubClient(&client) {};
+
+    PubSubClient& setServer(IPAddress ip, uint16_t port) { return *this; }
+    PubSubClient& setServer(const char* domain, uint16_t port) { return *this; }
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) { _callback = callback; return *this; }
+    PubSubClient& setClient(Client& client) { _client = &client; return *this; }
+    PubSubClient& setKeepAlive(uint16_t keepAlive) { return *this; }
+    PubSubClient& setSocketTimeout(uint16_t timeout) { return *this; }
+    bool setBufferSize(uint16_t size) { _bufferSize = size; return true; }
+    uint16_t getBufferSize() { return _bufferSize; }
+
+    bool connect(const char* id) { return connect(id, nullptr, nullptr); }
+    bool connect(const char* id, const char* user, const char* pass);
+    bool connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage);
+    bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage, bool cleanSession = true);
+    void disconnect();
+
+    bool publish(const char* topic, const char* payload) { return publish(topic, payload, false); }
+    bool publish(const char* topic, const char* payload, bool retained) { return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, retained); }
+    bool publish(const char* topic, const uint8_t* payload, unsigned int plength) { return publish(topic, payload, plength, false); }
+    bool publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained);
+    bool publish_P(const char* topic, const char* payload, bool retained) { return publish(topic, payload, retained); }
+
+    bool beginPublish(const char* topic, unsigned int plength, bool retained);
+    int endPublish();
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    bool subscribe(const char* topic, uint8_t qos = 0) { return connected(); }
+    bool unsubscribe(const char* topic) { return connected(); }
+    bool loop() { return connected(); }
+    bool connected() { return _connected; }
+    int state() { return _state; }
+
+    // native tests
+    void setConnected(bool connected);
+    void setConnectResult(bool succeeds) { _connectSucceeds = succeeds; }
+    void failPublishes(uint16_t count) { _failPublishes = count; }
+    void deliver(const char* topic, const char* payload);
+
+    std::vector<Published_t> published;
+    uint32_t connectAttempts;
+
+private:
+    PubSubClient(Client* client);
+    bool failing();
+
+    Client*  _client;
+    void (*_callback)(char*, uint8_t*, unsigned int);
+    uint16_t _bufferSize;
+    bool     _connected;
+    bool     _connectSucceeds;
+    int      _state;
+    uint16_t _failPublishes;
+
+    Published_t _streaming;                 // between beginPublish() and endPublish()
+    size_t      _streamingLen;              // as declared to beginPublish()
+    bool        _isStreaming;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <Print.h>
+
+// As ArduinoCore-API
+class Server : public Print
+{
+public:
+    virtual void begin() = 0;
+};
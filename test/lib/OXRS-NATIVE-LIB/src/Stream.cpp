@@ -0,0 +1,184 @@
+#include <Arduino.h>
+
+int Stream::timedRead()
+{
+    _startMillis = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - _startMillis < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    _startMillis = millis();
+    do
+    {
+        int c = peek();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - _startMillis < _timeout);
+    return -1;
+}
+
+int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal)
+{
+    while (true)
+    {
+        int c = timedPeek();
+        if (c < 0 || c == '-' || (c >= '0' && c <= '9') || (detectDecimal && c == '.'))
+            return c;
+
+        switch (lookahead)
+        {
+        case SKIP_NONE:
+            return -1;
+        case SKIP_WHITESPACE:
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+                return -1;
+            break;
+        case SKIP_ALL:
+            break;
+        }
+        read();
+    }
+}
+
+bool Stream::findUntil(const char* target, size_t targetLen, const char* terminator, size_t termLen)
+{
+    if (targetLen == 0)
+        return true;
+
+    // restarts the match on a mismatch, enough for the short targets used here
+    size_t index = 0;
+    size_t termIndex = 0;
+    int c;
+    while ((c = timedRead()) >= 0)
+    {
+        if (c == target[index])
+        {
+            if (++index >= targetLen)
+                return true;
+        }
+        else
+        {
+            index = c == target[0] ? 1 : 0;
+        }
+
+        if (termLen)
+        {
+            termIndex = c == terminator[termIndex] ? termIndex + 1 : 0;
+            if (termIndex >= termLen)
+                return false;
+        }
+    }
+    return false;
+}
+
+long Stream::parseInt(LookaheadMode lookahead, char ignore)
+{
+    bool isNegative = false;
+    long value = 0;
+
+    int c = peekNextDigit(lookahead, false);
+    if (c < 0)
+        return 0;
+
+    do
+    {
+        if (c == ignore)
+            ;
+        else if (c == '-')
+            isNegative = true;
+        else if (c >= '0' && c <= '9')
+            value = value * 10 + c - '0';
+        read();
+        c = timedPeek();
+    } while ((c >= '0' && c <= '9') || c == ignore);
+
+    return isNegative ? -value : value;
+}
+
+float Stream::parseFloat(LookaheadMode lookahead, char ignore)
+{
+    bool isNegative = false;
+    bool isFraction = false;
+    double value = 0;
+    double fraction = 1;
+
+    int c = peekNextDigit(lookahead, true);
+    if (c < 0)
+        return 0;
+
+    do
+    {
+        if (c == ignore)
+            ;
+        else if (c == '-')
+            isNegative = true;
+        else if (c == '.')
+            isFraction = true;
+        else if (c >= '0' && c <= '9')
+        {
+            value = value * 10 + c - '0';
+            if (isFraction)
+                fraction *= 0.1;
+        }
+        read();
+        c = timedPeek();
+    } while ((c >= '0' && c <= '9') || (c == '.' && !isFraction) || c == ignore);
+
+    value = isFraction ? value * fraction : value;
+    return isNegative ? -value : value;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+            break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length)
+{
+    size_t index = 0;
+    while (index < length)
+    {
+        int c = timedRead();
+        if (c < 0 || c == terminator)
+            break;
+        *buffer++ = (char)c;
+        index++;
+    }
+    return index;
+}
+
+String Stream::readString()
+{
+    String ret;
+    int c;
+    while ((c = timedRead()) >= 0)
+        ret += (char)c;
+    return ret;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String ret;
+    int c;
+    while ((c = timedRead()) >= 0 && c != terminator)
+        ret += (char)c;
+    return ret;
+}
@@ -0,0 +1,184 @@
+#include <Arduino.h>
+#include <ctype.h>
+
+static std::string toBase(unsigned long long value, unsigned char base)
+{
+    if (base < 2 || base > 36)
+        base = 10;
+
+    char digits[65];
+    int n = 0;
+    do
+    {
+        unsigned d = value % base;
+        digits[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+        value /= base;
+    } while (value);
+    std::string s;
+    while (n)
+        s += digits[--n];
+    return s;
+}
+
+static std::string toSigned(long long value, unsigned char base)
+{
+    if (value < 0 && base == 10)
+        return "-" + toBase(0 - (unsigned long long)value, base);
+    return toBase((unsigned long long)value, base);
+}
+
+static std::string toDecimals(double value, unsigned char decimalPlaces)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, value);
+    return buffer;
+}
+
+String::String(unsigned char value, unsigned char base) : _s(toBase(value, base)) {};
+String::String(int value, unsigned char base) : _s(toSigned(value, base)) {};
+String::String(unsigned int value, unsigned char base) : _s(toBase(value, base)) {};
+String::String(long value, unsigned char base) : _s(toSigned(value, base)) {};
+String::String(unsigned long value, unsigned char base) : _s(toBase(value, base)) {};
+String::String(long long value, unsigned char base) : _s(toSigned(value, base)) {};
+String::String(unsigned long long value, unsigned char base) : _s(toBase(value, base)) {};
+String::String(float value, unsigned char decimalPlaces) : _s(toDecimals(value, decimalPlaces)) {};
+String::String(double value, unsigned char decimalPlaces) : _s(toDecimals(value, decimalPlaces)) {};
+
+bool String::equalsIgnoreCase(const String& s) const
+{
+    return _s.length() == s._s.length() && strcasecmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::endsWith(const String& suffix) const
+{
+    return _s.length() >= suffix._s.length() &&
+        _s.compare(_s.length() - suffix._s.length(), suffix._s.length(), suffix._s) == 0;
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const
+{
+    if (!bufsize || !buf)
+        return;
+    if (index >= _s.length())
+    {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = min(bufsize - 1, (unsigned int)_s.length() - index);
+    memcpy(buf, _s.c_str() + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+    size_t pos = _s.find(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const
+{
+    size_t pos = _s.find(str._s, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+    size_t pos = _s.rfind(ch);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String& str) const
+{
+    size_t pos = _s.rfind(str._s);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+    {
+        unsigned int swap = beginIndex;
+        beginIndex = endIndex;
+        endIndex = swap;
+    }
+    if (beginIndex >= _s.length())
+        return String();
+    endIndex = min(endIndex, (unsigned int)_s.length());
+    return String(_s.c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace)
+{
+    for (char& c : _s)
+        if (c == find)
+            c = replace;
+}
+
+void String::replace(const String& find, const String& replace)
+{
+    if (find._s.empty())
+        return;
+    for (size_t pos = _s.find(find._s); pos != std::string::npos; pos = _s.find(find._s, pos + replace._s.length()))
+        _s.replace(pos, find._s.length(), replace._s);
+}
+
+void String::toLowerCase()
+{
+    for (char& c : _s)
+        c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+    for (char& c : _s)
+        c = toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+    size_t begin = 0;
+    while (begin < _s.length() && isspace((unsigned char)_s[begin]))
+        begin++;
+    size_t end = _s.length();
+    while (end > begin && isspace((unsigned char)_s[end - 1]))
+        end--;
+    _s = _s.substr(begin, end - begin);
+}
+
+long String::toInt() const
+{
+    return atol(c_str());
+}
+
+double String::toDouble() const
+{
+    return atof(c_str());
+}
+
+String operator+(const String& lhs, const String& rhs)
+{
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String& lhs, const char* rhs)
+{
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const char* lhs, const String& rhs)
+{
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String& lhs, char rhs)
+{
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class __FlashStringHelper;
+
+/*
+ * Arduino String over std::string, with the API the libraries and
+ * ArduinoJson use. Like Arduino's it accepts a null pointer as empty.
+ */
+class String
+{
+public:
+    String(const char* cstr = "") : _s(cstr ? cstr : "") {};
+    String(const char* cstr, unsigned int length) : _s(cstr ? cstr : "", cstr ? length : 0) {};
+    String(const __FlashStringHelper* str) : String(reinterpret_cast<const char*>(str)) {};
+    String(const String& str) = default;
+    String(String&& str) = default;
+    explicit String(char c) : _s(1, c) {};
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    String& operator=(const String& rhs) = default;
+    String& operator=(String&& rhs) = default;
+    String& operator=(const char* cstr) { _s = cstr ? cstr : ""; return *this; }
+    String& operator=(const __FlashStringHelper* str) { return *this = reinterpret_cast<const char*>(str); }
+
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    unsigned int length() const { return _s.length(); }
+    bool isEmpty() const { return _s.empty(); }
+    const char* c_str() const { return _s.c_str(); }
+    char* begin() { return &_s[0]; }
+    char* end() { return &_s[0] + _s.length(); }
+    const char* begin() const { return c_str(); }
+    const char* end() const { return c_str() + length(); }
+
+    bool concat(const String& str) { _s += str._s; return true; }
+    bool concat(const char* cstr) { if (!cstr) return false; _s += cstr; return true; }
+    bool concat(const char* cstr, unsigned int length) { if (!cstr) return false; _s.append(cstr, length); return true; }
+    bool concat(const uint8_t* cstr, unsigned int length) { return concat((const char*)cstr, length); }
+    bool concat(const __FlashStringHelper* str) { return concat(reinterpret_cast<const char*>(str)); }
+    bool concat(char c) { _s += c; return true; }
+    bool concat(unsigned char num) { return concat(String(num)); }
+    bool concat(int num) { return concat(String(num)); }
+    bool concat(unsigned int num) { return concat(String(num)); }
+    bool concat(long num) { return concat(String(num)); }
+    bool concat(unsigned long num) { return concat(String(num)); }
+    bool concat(long long num) { return concat(String(num)); }
+    bool concat(unsigned long long num) { return concat(String(num)); }
+    bool concat(float num) { return concat(String(num)); }
+    bool concat(double num) { return concat(String(num)); }
+
+    template <typename T>
+    String& operator+=(const T& rhs) { concat(rhs); return *this; }
+
+    int compareTo(const String& s) const { return _s.compare(s._s); }
+    bool equals(const String& s) const { return _s == s._s; }
+    bool equals(const char* cstr) const { return _s == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String& s) const;
+    bool operator==(const String& rhs) const { return equals(rhs); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& rhs) const { return !equals(rhs); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& rhs) const { return _s < rhs._s; }
+    bool operator>(const String& rhs) const { return _s > rhs._s; }
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.length(), prefix._s) == 0; }
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < _s.length()) _s[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return _s[index]; }
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const { getBytes((unsigned char*)buf, bufsize, index); }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String& str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(const String& str) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index) { if (index < _s.length()) _s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _s.length()) _s.erase(index, count); }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const { return (float)toDouble(); }
+    double toDouble() const;
+
+private:
+    std::string _s;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
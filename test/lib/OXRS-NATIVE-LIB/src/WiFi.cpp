@@ -0,0 +1,304 @@
+#include <WiFi.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+WiFiClass WiFi;
+
+// closed when the last copy goes
+static std::shared_ptr<int> shareSocket(int fd)
+{
+    return std::shared_ptr<int>(new int(fd), [](int* fd) {
+        if (*fd >= 0)
+            ::close(*fd);
+        delete fd;
+    });
+}
+
+static void setNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static sockaddr_in toSockaddr(IPAddress ip, uint16_t port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    return addr;
+}
+
+WiFiClient::WiFiClient(int fd) :
+    _fd(shareSocket(fd))
+{
+    setNonBlocking(fd);
+    setNoDelay(true);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+    stop();
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return 0;
+    _fd = shareSocket(fd);
+    setNonBlocking(fd);
+
+    // waits up to the stream timeout, as the device does
+    sockaddr_in addr = toSockaddr(ip, port);
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        pollfd p = { fd, POLLOUT, 0 };
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (errno != EINPROGRESS || poll(&p, 1, _timeout) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0)
+        {
+            stop();
+            return 0;
+        }
+    }
+    setNoDelay(true);
+    return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port)
+{
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip))
+        return 0;
+    return connect(ip, port);
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size)
+{
+    size_t sent = 0;
+    unsigned long start = millis();
+    while (fd() >= 0 && sent < size)
+    {
+        ssize_t n = send(fd(), buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            break;
+
+        pollfd p = { fd(), POLLOUT, 0 };
+        if (millis() - start >= _timeout || poll(&p, 1, 10) < 0)
+            break;
+    }
+    return sent;
+}
+
+int WiFiClient::availableForWrite()
+{
+    return fd() >= 0 ? 1460 : 0;
+}
+
+int WiFiClient::available()
+{
+    int n = 0;
+    if (fd() < 0 || ioctl(fd(), FIONREAD, &n) != 0)
+        return 0;
+    return n;
+}
+
+int WiFiClient::read()
+{
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size)
+{
+    if (fd() < 0)
+        return -1;
+    ssize_t n = recv(fd(), buf, size, MSG_DONTWAIT);
+    return n > 0 ? (int)n : -1;
+}
+
+int WiFiClient::peek()
+{
+    uint8_t b;
+    if (fd() < 0 || recv(fd(), &b, 1, MSG_PEEK | MSG_DONTWAIT) != 1)
+        return -1;
+    return b;
+}
+
+void WiFiClient::stop()
+{
+    if (_fd && *_fd >= 0)
+    {
+        ::close(*_fd);
+        *_fd = -1;
+    }
+    _fd.reset();
+}
+
+// Connected while there is data to read or the peer has not closed
+uint8_t WiFiClient::connected()
+{
+    if (fd() < 0)
+        return 0;
+    if (available() > 0)
+        return 1;
+
+    uint8_t b;
+    ssize_t n = recv(fd(), &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+IPAddress WiFiClient::remoteIP()
+{
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (fd() < 0 || getpeername(fd(), (sockaddr*)&addr, &len) != 0)
+        return IPAddress();
+    return IPAddress((uint32_t)addr.sin_addr.s_addr);
+}
+
+uint16_t WiFiClient::remotePort()
+{
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (fd() < 0 || getpeername(fd(), (sockaddr*)&addr, &len) != 0)
+        return 0;
+    return ntohs(addr.sin_port);
+}
+
+void WiFiClient::setNoDelay(bool nodelay)
+{
+    int flag = nodelay;
+    if (fd() >= 0)
+        setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+void WiFiServer::begin(uint16_t port)
+{
+    close();
+
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0)
+        return;
+
+    int reuse = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr = toSockaddr(IPAddress(127, 0, 0, 1), port);
+    socklen_t len = sizeof(addr);
+    if (bind(_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(_fd, 8) != 0 ||
+        getsockname(_fd, (sockaddr*)&addr, &len) != 0)
+    {
+        close();
+        return;
+    }
+    setNonBlocking(_fd);
+    _port = ntohs(addr.sin_port);
+}
+
+void WiFiServer::close()
+{
+    if (_fd >= 0)
+        ::close(_fd);
+    _fd = -1;
+}
+
+WiFiClient WiFiServer::accept()
+{
+    if (_fd < 0)
+        return WiFiClient();
+
+    int fd = ::accept(_fd, nullptr, nullptr);
+    return fd < 0 ? WiFiClient() : WiFiClient(fd);
+}
+
+bool WiFiServer::hasClient()
+{
+    pollfd p = { _fd, POLLIN, 0 };
+    return _fd >= 0 && poll(&p, 1, 0) == 1;
+}
+
+WiFiClass::WiFiClass() :
+    _hostname("oxrs-native"),
+    _status(WL_CONNECTED),
+    _rssi(-55),
+    _joinPending(false),
+    _joinStatus(WL_CONNECTED),
+    _joinDelay_ms(0),
+    _joinStart_ms(0),
+    _joins(0),
+    _lookups(0)
+{
+};
+
+int WiFiClass::begin(const char* ssid, const char* passphrase)
+{
+    beginNoBlock(ssid, passphrase);
+    delay(_joinDelay_ms);
+    return status();
+}
+
+int WiFiClass::beginNoBlock(const char* ssid, const char* passphrase)
+{
+    _ssid         = ssid;
+    _status       = WL_IDLE_STATUS;
+    _joinPending  = true;
+    _joinStart_ms = millis();
+    _joins++;
+    return _status;
+}
+
+int WiFiClass::disconnect(bool wifi_off)
+{
+    _status      = WL_DISCONNECTED;
+    _joinPending = false;
+    return 1;
+}
+
+uint8_t WiFiClass::status()
+{
+    if (_joinPending && millis() - _joinStart_ms >= _joinDelay_ms)
+    {
+        _status      = _joinStatus;
+        _joinPending = false;
+    }
+    return _status;
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac)
+{
+    static const uint8_t address[6] = { 0x28, 0xcd, 0xc1, 0x00, 0x00, 0x01 };
+    memcpy(mac, address, sizeof(address));
+    return mac;
+}
+
+int WiFiClass::hostByName(const char* hostname, IPAddress& result)
+{
+    _lookups++;
+    if (!result.fromString(hostname))
+    {
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        addrinfo* info;
+        if (getaddrinfo(hostname, nullptr, &hints, &info) != 0)
+            return 0;
+        result = IPAddress((uint32_t)((sockaddr_in*)info->ai_addr)->sin_addr.s_addr);
+        freeaddrinfo(info);
+    }
+    return 1;
+}
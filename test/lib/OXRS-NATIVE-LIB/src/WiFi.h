@@ -0,0 +1,147 @@
+#pragma once
+
+#include <memory>
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+typedef enum {
+    WL_NO_SHIELD        = 255,
+    WL_IDLE_STATUS      = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF    = 0,
+    WIFI_STA    = 1,
+    WIFI_AP     = 2,
+    WIFI_AP_STA = 3
+} WiFiMode_t;
+
+/*
+ * TCP client over a host socket. Copies share the socket, as they share
+ * the connection on the device, and stop() closes it for all of them.
+ * The socket does not block on reads, writes wait up to the timeout.
+ */
+class WiFiClient : public Client
+{
+public:
+    WiFiClient() {};
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(const String& host, uint16_t port) { return connect(host.c_str(), port); }
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    int availableForWrite() override;
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {};
+
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    IPAddress remoteIP();
+    uint16_t remotePort();
+    void setNoDelay(bool nodelay);
+
+    using Print::write;
+
+private:
+    friend class WiFiServer;
+    explicit WiFiClient(int fd);
+
+    int fd() const { return _fd ? *_fd : -1; }
+
+    std::shared_ptr<int> _fd;
+};
+
+// Listens on the loopback interface, port 0 picks a free port
+class WiFiServer : public Server
+{
+public:
+    WiFiServer(uint16_t port = 23) : _port(port), _fd(-1) {};
+    ~WiFiServer() { close(); }
+
+    WiFiServer(const WiFiServer&) = delete;
+    WiFiServer& operator=(const WiFiServer&) = delete;
+
+    void begin() override { begin(_port); }
+    void begin(uint16_t port);
+    void close();
+    void stop() { close(); }
+
+    WiFiClient accept();
+    WiFiClient available(uint8_t* status = nullptr) { return accept(); }
+    bool hasClient();
+    uint8_t status() { return _fd >= 0; }
+    uint16_t port() const { return _port; }
+    void setNoDelay(bool nodelay) {};
+
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t* buf, size_t size) override { return 0; }
+    using Print::write;
+
+private:
+    uint16_t _port;
+    int      _fd;
+};
+
+/*
+ * The link is simulated, joins complete as the test sets them up. Name
+ * lookups are real.
+ */
+class WiFiClass
+{
+public:
+    WiFiClass();
+
+    int begin(const char* ssid, const char* passphrase = nullptr);
+    int beginNoBlock(const char* ssid, const char* passphrase = nullptr);
+    int disconnect(bool wifi_off = false);
+    void mode(WiFiMode_t mode) {};
+
+    uint8_t status();
+    bool connected() { return status() == WL_CONNECTED; }
+
+    const char* SSID() { return _ssid.c_str(); }
+    int32_t RSSI() { return connected() ? _rssi : 0; }
+    int32_t channel() { return 6; }
+    uint8_t* macAddress(uint8_t* mac);
+    IPAddress localIP() { return connected() ? IPAddress(127, 0, 0, 1) : IPAddress(); }
+
+    int hostByName(const char* hostname, IPAddress& result);
+    int hostByName(const char* hostname, IPAddress& result, int timeout) { return hostByName(hostname, result); }
+
+    const char* getHostname() { return _hostname.c_str(); }
+    void setHostname(const char* hostname) { _hostname = hostname; }
+
+    // native tests: set the link, and the result of the next join after delay_ms
+    void setStatus(uint8_t status) { _status = status; _joinPending = false; }
+    void setJoinResult(uint8_t status, uint32_t delay_ms = 0) { _joinStatus = status; _joinDelay_ms = delay_ms; }
+    void setRSSI(int32_t rssi) { _rssi = rssi; }
+    uint32_t getJoinCount() const { return _joins; }
+    uint32_t getHostByNameCount() const { return _lookups; }
+
+private:
+    String   _ssid;
+    String   _hostname;
+    uint8_t  _status;
+    int32_t  _rssi;
+    bool     _joinPending;
+    uint8_t  _joinStatus;
+    uint32_t _joinDelay_ms;
+    uint32_t _joinStart_ms;
+    uint32_t _joins;
+    uint32_t _lookups;
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,130 @@
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+bool WiFiUDP::open()
+{
+    if (_fd && *_fd >= 0)
+        return true;
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return false;
+    _fd = std::shared_ptr<int>(new int(fd), [](int* fd) {
+        if (*fd >= 0)
+            ::close(*fd);
+        delete fd;
+    });
+    return true;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    stop();
+    if (!open())
+        return 0;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(*_fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop()
+{
+    if (_fd && *_fd >= 0)
+    {
+        ::close(*_fd);
+        *_fd = -1;
+    }
+    _fd.reset();
+    _rxLen = _rxPos = 0;
+}
+
+uint16_t WiFiUDP::localPort()
+{
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (!_fd || getsockname(*_fd, (sockaddr*)&addr, &len) != 0)
+        return 0;
+    return ntohs(addr.sin_port);
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+    if (!open())
+        return 0;
+    _txIP   = ip;
+    _txPort = port;
+    _txLen  = 0;
+    return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port)
+{
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip))
+        return 0;
+    return beginPacket(ip, port);
+}
+
+int WiFiUDP::endPacket()
+{
+    if (!_fd || *_fd < 0 || !_txPort)
+        return 0;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(_txPort);
+    addr.sin_addr.s_addr = (uint32_t)_txIP;
+    ssize_t sent = sendto(*_fd, _tx, _txLen, 0, (sockaddr*)&addr, sizeof(addr));
+    _txPort = 0;
+    return sent == (ssize_t)_txLen;
+}
+
+// A packet longer than the buffer is not sent
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size)
+{
+    if (!_txPort || _txLen + size > MAX_PACKET_LEN)
+        return 0;
+    memcpy(_tx + _txLen, buffer, size);
+    _txLen += size;
+    return size;
+}
+
+int WiFiUDP::parsePacket()
+{
+    _rxLen = _rxPos = 0;
+    if (!_fd || *_fd < 0)
+        return 0;
+
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    ssize_t n = recvfrom(*_fd, _rx, sizeof(_rx), MSG_DONTWAIT, (sockaddr*)&addr, &len);
+    if (n <= 0)
+        return 0;
+
+    _rxLen      = n;
+    _remoteIP   = IPAddress((uint32_t)addr.sin_addr.s_addr);
+    _remotePort = ntohs(addr.sin_port);
+    return n;
+}
+
+int WiFiUDP::read(unsigned char* buffer, size_t len)
+{
+    size_t n = min(len, _rxLen - _rxPos);
+    memcpy(buffer, _rx + _rxPos, n);
+    _rxPos += n;
+    return n;
+}
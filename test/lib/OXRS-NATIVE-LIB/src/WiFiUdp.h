@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <Arduino.h>
+#include <Udp.h>
+
+// UDP over a host socket, bound on begin() or on the first packet sent
+class WiFiUDP : public UDP
+{
+public:
+    inline static const size_t MAX_PACKET_LEN = 1472;
+
+    WiFiUDP() : _txLen(0), _rxLen(0), _rxPos(0), _remotePort(0), _txPort(0) {};
+
+    uint8_t begin(uint16_t port) override;
+    void stop() override;
+    uint16_t localPort();
+
+    int beginPacket(IPAddress ip, uint16_t port) override;
+    int beginPacket(const char* host, uint16_t port) override;
+    int endPacket() override;
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    int parsePacket() override;
+    int available() override { return _rxLen - _rxPos; }
+    int read() override { return _rxPos < _rxLen ? _rx[_rxPos++] : -1; }
+    int read(unsigned char* buffer, size_t len) override;
+    int read(char* buffer, size_t len) override { return read((unsigned char*)buffer, len); }
+    int peek() override { return _rxPos < _rxLen ? _rx[_rxPos] : -1; }
+    void flush() override {};
+
+    IPAddress remoteIP() override { return _remoteIP; }
+    uint16_t remotePort() override { return _remotePort; }
+
+    using Print::write;
+
+private:
+    bool open();
+
+    std::shared_ptr<int> _fd;
+    uint8_t   _tx[MAX_PACKET_LEN];
+    size_t    _txLen;
+    uint8_t   _rx[MAX_PACKET_LEN];
+    size_t    _rxLen;
+    size_t    _rxPos;
+    IPAddress _remoteIP;
+    uint16_t  _remotePort;
+    IPAddress _txIP;
+    uint16_t  _txPort;
+};
@@ -0,0 +1,14 @@
+#include <Wire.h>
+
+i2c_inst_t i2c0_inst = { 0 };
+i2c_inst_t i2c1_inst = { 1 };
+
+TwoWire Wire(i2c0, PIN_WIRE0_SDA, PIN_WIRE0_SCL);
+TwoWire Wire1(i2c1, PIN_WIRE1_SDA, PIN_WIRE1_SCL);
+
+size_t TwoWire::write(const uint8_t* data, size_t quantity)
+{
+    size_t n = min(quantity, WIRE_BUFFER_SIZE - _txLen);
+    _txLen += n;
+    return n;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+
+typedef uint8_t pin_size_t;
+
+// Pico SDK i2c instances, only identify the bus here
+typedef struct i2c_inst {
+    uint8_t index;
+} i2c_inst_t;
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+#ifndef WIRE_BUFFER_SIZE
+#define WIRE_BUFFER_SIZE 256
+#endif
+
+// As ArduinoCore-API
+class HardwareI2C : public Stream
+{
+public:
+    virtual void begin() = 0;
+    virtual void begin(uint8_t address) = 0;
+    virtual void end() = 0;
+    virtual void setClock(uint32_t freq) = 0;
+
+    virtual void beginTransmission(uint8_t address) = 0;
+    virtual uint8_t endTransmission(bool stopBit) = 0;
+    virtual uint8_t endTransmission(void) = 0;
+
+    virtual size_t requestFrom(uint8_t address, size_t len, bool stopBit) = 0;
+    virtual size_t requestFrom(uint8_t address, size_t len) = 0;
+
+    virtual void onReceive(void (*)(int)) = 0;
+    virtual void onRequest(void (*)(void)) = 0;
+};
+
+/*
+ * arduino-pico's TwoWire, on a bus with nothing attached: every address is
+ * NACKed. SEN5xSimulator overrides it to put a sensor on the bus.
+ */
+class TwoWire : public HardwareI2C
+{
+public:
+    TwoWire(i2c_inst_t* i2c, pin_size_t sda, pin_size_t scl) : _i2c(i2c), _txLen(0) {};
+
+    bool setSDA(pin_size_t sda) { return true; }
+    bool setSCL(pin_size_t scl) { return true; }
+
+    void begin() override {};
+    void begin(uint8_t address) override {};
+    void end() override {};
+    void setClock(uint32_t freqHz) override {};
+
+    void beginTransmission(uint8_t address) override { _txLen = 0; }
+    uint8_t endTransmission(bool stopBit) override { return 2; }
+    uint8_t endTransmission(void) override { return endTransmission(true); }
+
+    size_t requestFrom(uint8_t address, size_t quantity, bool stopBit) override { return 0; }
+    size_t requestFrom(uint8_t address, size_t quantity) override { return requestFrom(address, quantity, true); }
+
+    size_t write(uint8_t data) override { return write(&data, 1); }
+    size_t write(const uint8_t* data, size_t quantity) override;
+    int available(void) override { return 0; }
+    int read(void) override { return -1; }
+    int peek(void) override { return -1; }
+    void flush(void) override {};
+
+    void onReceive(void (*)(int)) override {};
+    void onRequest(void (*)(void)) override {};
+
+    using Print::write;
+
+private:
+    i2c_inst_t* _i2c;
+    size_t      _txLen;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
@@ -0,0 +1,222 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+#include <OXRS_SEN5x.h>
+#include <SEN5xSimulator.h>
+
+/*
+ * Drives OXRS_SEN5x against the simulator and times every loop() call. The
+ * clock only jumps when something calls delay(), so a loop() that waits on
+ * the sensor shows up as tens of milliseconds however fast the host is.
+ */
+
+// worst case for one loop() call, well under a single sensor command wait
+static const uint32_t LOOP_BUDGET_US = 2000;
+
+void setUp() {}
+void tearDown() {}
+
+// Run loop() for ms of simulated time in 1ms ticks, returning the longest call
+static uint32_t runLoop(OXRS_SEN5x& sensor, uint32_t ms, char* telemetry, size_t size, uint32_t& published)
+{
+    uint32_t worst = 0;
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        OXRSNative::advance(1);
+
+        uint32_t start = micros();
+        sensor.loop();
+        uint32_t elapsed = micros() - start;
+        if (elapsed > worst)
+            worst = elapsed;
+
+        if (sensor.getTelemetry(telemetry, size))
+            published++;
+    }
+    return worst;
+}
+
+void test_loop_within_budget()
+{
+    SEN5xSimulator sim(SEN55);
+    OXRS_SEN5x sensor(SEN55);
+    sensor.begin(sim);
+
+    char telemetry[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    uint32_t published = 0;
+    uint32_t worst = runLoop(sensor, 30000, telemetry, sizeof(telemetry), published);
+
+    TEST_ASSERT_LESS_THAN_UINT32(LOOP_BUDGET_US, worst);
+
+    // and acquisition still keeps up with the sensor
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2, published);
+    SEN5x_sample_t sample;
+    TEST_ASSERT_TRUE(sensor.getLatestSample(sample));
+    TEST_ASSERT_NOT_EQUAL(SEN5x_PM_UNKNOWN, sample.telemetry.pm2p5);
+}
+
+void test_loop_within_budget_with_faults()
+{
+    SEN5xSimulator sim(SEN55);
+    OXRS_SEN5x sensor(SEN55);
+    sensor.begin(sim);
+
+    // NACKs and corrupt reads abandon an acquisition, they must not stall it
+    sim.failTransactions(5);
+    sim.corruptReads(5);
+
+    char telemetry[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    uint32_t published = 0;
+    uint32_t worst = runLoop(sensor, 20000, telemetry, sizeof(telemetry), published);
+
+    TEST_ASSERT_LESS_THAN_UINT32(LOOP_BUDGET_US, worst);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, published);
+}
+
+void test_config_within_budget()
+{
+    SEN5xSimulator sim(SEN55);
+    OXRS_SEN5x sensor(SEN55);
+    sensor.begin(sim);
+
+    char telemetry[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    uint32_t published = 0;
+    runLoop(sensor, 2000, telemetry, sizeof(telemetry), published);
+
+    // idle only items stop and restart measurement, and read back runs every 5s
+    DynamicJsonDocument json(512);
+    json["temperatureOffsetCelsius"] = 1.5;
+    json["warmStartParameter"] = 100;
+    json["rhtAccelerationMode"] = 1;
+    json["vocAlgorithmTuning"]["indexOffset"] = 150;
+    json["noxAlgorithmTuning"]["gainFactor"] = 200;
+    json["verifyConfigSeconds"] = 5;
+    sensor.onConfig(json.as<JsonVariant>());
+
+    uint32_t before = sim.getTransactions();
+    uint32_t worst = runLoop(sensor, 30000, telemetry, sizeof(telemetry), published);
+
+    TEST_ASSERT_LESS_THAN_UINT32(LOOP_BUDGET_US, worst);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2, published);
+
+    // 3 acquisition commands a second, plus stop, 5 writes, start and 5 read
+    // backs every 5s
+    TEST_ASSERT_GREATER_THAN_UINT32(30 * 3 + 7 + 5 * 5, sim.getTransactions() - before);
+}
+
+void test_voc_state_snapshot_within_budget()
+{
+    LittleFS.begin();
+    LittleFS.remove("/sen5xVocState.bin");
+
+    SEN5xSimulator sim(SEN55);
+    OXRS_SEN5x sensor(SEN55);
+    sensor.begin(sim);
+
+    DynamicJsonDocument json(128);
+    json["vocStateSnapshotMinutes"] = 1;
+    sensor.onConfig(json.as<JsonVariant>());
+
+    // the VOC index is valid after 10s, then state is read every minute
+    char telemetry[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    uint32_t published = 0;
+    uint32_t worst = runLoop(sensor, 75000, telemetry, sizeof(telemetry), published);
+
+    TEST_ASSERT_LESS_THAN_UINT32(LOOP_BUDGET_US, worst);
+    TEST_ASSERT_TRUE(LittleFS.exists("/sen5xVocState.bin"));
+}
+
+// Counts the lines logged containing a message
+class MatchingLogger : public OXRS_LOG::AbstractLogger {
+public:
+    virtual void log(const OXRS_LOG::LogEntry_t& entry) {
+        if (entry.line && strstr(entry.line, match))
+            lines++;
+    }
+
+    virtual void onConfig(JsonVariant json) {};
+    virtual void setConfig(JsonVariant json) {};
+
+    const char* match = "";
+    uint32_t lines = 0;
+};
+
+void test_telemetry_disabled_logged_once()
+{
+    static MatchingLogger logger;
+    logger.match = "Telemetry disabled";
+    logger.setEnable(true);
+    logger.setMinLevel(OXRS_LOG::DEBUG);
+    oxrsLog.addLogger(&logger);
+
+    SEN5xSimulator sim(SEN55);
+    OXRS_SEN5x sensor(SEN55);
+    sensor.begin(sim);
+
+    DynamicJsonDocument json(128);
+    json["publishTelemetrySeconds"] = 0;
+    sensor.onConfig(json.as<JsonVariant>());
+    TEST_ASSERT_EQUAL_UINT32(1, logger.lines);
+
+    // the fixed state is not logged again on every pass
+    char telemetry[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    uint32_t published = 0;
+    runLoop(sensor, 5000, telemetry, sizeof(telemetry), published);
+    TEST_ASSERT_EQUAL_UINT32(0, published);
+    TEST_ASSERT_EQUAL_UINT32(1, logger.lines);
+
+    logger.setEnable(false);
+}
+
+void test_command_waits_for_aborted_command()
+{
+    static MatchingLogger logger;
+    logger.match = "Clear device status";
+    logger.setEnable(true);
+    logger.setMinLevel(OXRS_LOG::DEBUG);
+    oxrsLog.addLogger(&logger);
+
+    static MatchingLogger errors;
+    errors.setEnable(true);
+    errors.setMinLevel(OXRS_LOG::ERROR);
+    oxrsLog.addLogger(&errors);
+
+    SEN5xSimulator sim(SEN55);
+    OXRS_SEN5x sensor(SEN55);
+    sensor.begin(sim);
+
+    char telemetry[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    uint32_t published = 0;
+    runLoop(sensor, 2000, telemetry, sizeof(telemetry), published);
+
+    // an idle only item has measurement stopped, which takes 200ms, and a
+    // command queued behind it aborts that, but must not talk over it
+    DynamicJsonDocument json(128);
+    json["warmStartParameter"] = 100;
+    sensor.onConfig(json.as<JsonVariant>());
+    sensor.loop();
+
+    json.clear();
+    json["clearDeviceStatusCommand"] = true;
+    sensor.onCommand(json.as<JsonVariant>());
+    errors.lines = 0;
+    runLoop(sensor, 1000, telemetry, sizeof(telemetry), published);
+    TEST_ASSERT_EQUAL_UINT32(1, logger.lines);
+    TEST_ASSERT_EQUAL_UINT32(0, errors.lines);
+
+    logger.setEnable(false);
+    errors.setEnable(false);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_loop_within_budget);
+    RUN_TEST(test_loop_within_budget_with_faults);
+    RUN_TEST(test_config_within_budget);
+    RUN_TEST(test_voc_state_snapshot_within_budget);
+    RUN_TEST(test_telemetry_disabled_logged_once);
+    RUN_TEST(test_command_waits_for_aborted_command);
+    return UNITY_END();
+}
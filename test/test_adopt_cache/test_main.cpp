@@ -0,0 +1,296 @@
+#include <unity.h>
+#include <string>
+#include <algorithm>
+#include <ArduinoJson.h>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+#include <OXRS_SEN5x.h>
+#include <AdoptCache.h>
+
+/*
+ * Adopting with the firmware, config schema and command schema built for
+ * every adopt, as OXRS_IO_PICO did, against AdoptCache linking them in.
+ * The schemas are the SEN55 firmware's, merged under the same metadata and
+ * logging config as OXRS_IO_PICO, then the live system and network objects
+ * are added and the document serialised as OXRS_API responds. And every
+ * change the config schema reflects leaving the cache stale.
+ */
+
+static const uint32_t ITERATIONS = 2000;
+static const uint8_t  ROUNDS     = 5;
+static const size_t   ADOPT_DOC_SIZE = 16384;   // as JSON_ADOPT_MAX_SIZE
+
+static DynamicJsonDocument fwConfigSchema(8192);
+static DynamicJsonDocument fwCommandSchema(4096);
+static AdoptCache cache;
+static char payload[ADOPT_DOC_SIZE];
+
+void setUp() {}
+void tearDown() {}
+
+// Parts as OXRS_IO_PICO builds them
+static void firmwareJson(JsonVariant json)
+{
+    JsonObject firmware = json.createNestedObject("firmware");
+    firmware["name"]      = FW_NAME;
+    firmware["shortName"] = FW_SHORT_NAME;
+    firmware["maker"]     = FW_MAKER;
+    firmware["version"]   = FW_VERSION;
+}
+
+static void configSchemaJson(JsonVariant json)
+{
+    JsonObject configSchema = json.createNestedObject("configSchema");
+    configSchema["$schema"] = "http://json-schema.org/draft-07/schema#";
+    configSchema["title"]   = FW_SHORT_NAME;
+    configSchema["type"]    = "object";
+
+    JsonObject props = configSchema.createNestedObject("properties");
+    props.set(fwConfigSchema.as<JsonObjectConst>());
+    oxrsLog.setConfig(props);
+}
+
+static void commandSchemaJson(JsonVariant json)
+{
+    JsonObject commandSchema = json.createNestedObject("commandSchema");
+    commandSchema["$schema"] = "http://json-schema.org/draft-07/schema#";
+    commandSchema["title"]   = FW_SHORT_NAME;
+    commandSchema["type"]    = "object";
+
+    JsonObject props = commandSchema.createNestedObject("properties");
+    props.set(fwCommandSchema.as<JsonObjectConst>());
+
+    JsonObject restart = props.createNestedObject("restart");
+    restart["title"]   = "Restart Pico";
+    restart["type"]    = "boolean";
+}
+
+// Stands in for the system and network objects, which are never cached
+static void liveJson(JsonVariant json, uint32_t i)
+{
+    JsonObject system = json.createNestedObject("system");
+    system["heapUsedBytes"]        = 61234 + i;
+    system["heapFreeBytes"]        = 180000 - i;
+    system["heapMaxAllocBytes"]    = 241000;
+    system["flashChipSizeBytes"]   = 2097152;
+    system["fileSystemUsedBytes"]  = 16384;
+    system["fileSystemTotalBytes"] = 1048576;
+    system["logDroppedCount"]      = 0;
+    system["telemetryBacklogCount"] = i & 7;
+
+    JsonObject network = json.createNestedObject("network");
+    network["mode"]    = "wifi";
+    network["ip"]      = "192.168.1.23";
+    network["rssi"]    = -61;
+    network["channel"] = 6;
+    network["mac"]     = "28:CD:C1:00:12:34";
+}
+
+static size_t adoptFull(uint32_t i)
+{
+    DynamicJsonDocument json(ADOPT_DOC_SIZE);
+    firmwareJson(json.as<JsonVariant>());
+    configSchemaJson(json.as<JsonVariant>());
+    commandSchemaJson(json.as<JsonVariant>());
+    liveJson(json.as<JsonVariant>(), i);
+    return serializeJson(json, payload, sizeof(payload));
+}
+
+static size_t adoptCached(uint32_t i)
+{
+    DynamicJsonDocument json(ADOPT_DOC_SIZE);
+    TEST_ASSERT_TRUE(cache.splice(json.as<JsonVariant>()));
+    liveJson(json.as<JsonVariant>(), i);
+    return serializeJson(json, payload, sizeof(payload));
+}
+
+typedef size_t (*adopt_t)(uint32_t i);
+
+typedef struct {
+    uint32_t us;            // per adopt
+    size_t   heapPeak;      // bytes above the heap in use beforehand
+    size_t   len;
+} result_t;
+
+static result_t run(adopt_t adopt, const char* name)
+{
+    result_t result;
+
+    // best of a few rounds, as the host is not idle
+    result.us = UINT32_MAX;
+    for (uint8_t round = 0; round < ROUNDS; round++)
+    {
+        uint64_t start = time_us_64();
+        for (uint32_t i = 0; i < ITERATIONS; i++)
+            result.len = adopt(i);
+        result.us = std::min(result.us, (uint32_t)((time_us_64() - start) / ITERATIONS));
+    }
+
+    size_t heapBefore = OXRSNative::heapUsed();
+    OXRSNative::resetHeapPeak();
+    adopt(0);
+    result.heapPeak = OXRSNative::heapPeak() - heapBefore;
+
+    char message[128];
+    snprintf(message, sizeof(message), "%-6s %5" PRIu32 " us/adopt %6u bytes peak heap %6u bytes payload",
+        name, result.us, (unsigned)result.heapPeak, (unsigned)result.len);
+    TEST_MESSAGE(message);
+    return result;
+}
+
+// Document memory each adopt uses, of the ADOPT_DOC_SIZE pool
+static size_t poolUsed(bool cached)
+{
+    DynamicJsonDocument json(ADOPT_DOC_SIZE);
+    if (cached)
+    {
+        cache.splice(json.as<JsonVariant>());
+    }
+    else
+    {
+        firmwareJson(json.as<JsonVariant>());
+        configSchemaJson(json.as<JsonVariant>());
+        commandSchemaJson(json.as<JsonVariant>());
+    }
+    liveJson(json.as<JsonVariant>(), 0);
+    TEST_ASSERT_FALSE(json.overflowed());
+    return json.memoryUsage();
+}
+
+void test_cached_matches_full()
+{
+    TEST_ASSERT_TRUE(cache.refresh(ADOPT_DOC_SIZE));
+    TEST_ASSERT_TRUE(cache.isValid());
+
+    std::string full(payload, adoptFull(0));
+    DynamicJsonDocument expected(ADOPT_DOC_SIZE);
+    TEST_ASSERT_FALSE(deserializeJson(expected, full.c_str(), full.size()));
+
+    std::string cached(payload, adoptCached(0));
+    DynamicJsonDocument actual(ADOPT_DOC_SIZE);
+    TEST_ASSERT_FALSE(deserializeJson(actual, cached.c_str(), cached.size()));
+
+    // same content, only the order of the top level keys differs
+    TEST_ASSERT_EQUAL_size_t(full.size(), cached.size());
+    for (const char* key : { "firmware", "configSchema", "commandSchema", "system", "network" })
+    {
+        std::string expectedPart, actualPart;
+        serializeJson(expected[key], expectedPart);
+        serializeJson(actual[key], actualPart);
+        TEST_ASSERT_GREATER_THAN_UINT32_MESSAGE(2, expectedPart.size(), key);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expectedPart.c_str(), actualPart.c_str(), key);
+    }
+}
+
+void test_adopt_benchmark()
+{
+    TEST_ASSERT_TRUE(cache.refresh(ADOPT_DOC_SIZE));
+
+    result_t full   = run(adoptFull, "full");
+    result_t cached = run(adoptCached, "cached");
+
+    size_t fullPool   = poolUsed(false);
+    size_t cachedPool = poolUsed(true);
+    char message[128];
+    snprintf(message, sizeof(message), "document pool used %u bytes full, %u bytes cached, cache %u bytes",
+        (unsigned)fullPool, (unsigned)cachedPool, (unsigned)cache.getSize());
+    TEST_MESSAGE(message);
+
+    // the document is allocated whole either way, the saving is in its pool
+    // and the time spent rebuilding schemas
+    TEST_ASSERT_LESS_THAN_UINT32(full.us, cached.us);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(full.heapPeak, cached.heapPeak);
+    TEST_ASSERT_LESS_THAN_UINT32(fullPool / 4, cachedPool);
+}
+
+// Every change the config schema reflects has to leave the cache stale
+static void assertRebuilt(const char* change)
+{
+    TEST_ASSERT_FALSE_MESSAGE(cache.isValid(), change);
+    DynamicJsonDocument json(ADOPT_DOC_SIZE);
+    TEST_ASSERT_FALSE_MESSAGE(cache.splice(json.as<JsonVariant>()), change);
+
+    uint32_t builds = cache.getBuildCount();
+    TEST_ASSERT_TRUE_MESSAGE(cache.refresh(ADOPT_DOC_SIZE), change);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(builds + 1, cache.getBuildCount(), change);
+    TEST_ASSERT_TRUE_MESSAGE(cache.isValid(), change);
+}
+
+class SchemaLogger : public OXRS_LOG::AbstractLogger {
+public:
+    virtual void log(const OXRS_LOG::LogEntry_t& entry) {}
+    virtual void onConfig(JsonVariant json) {}
+    virtual void setConfig(JsonVariant json) {}
+};
+
+void test_invalidated_by_every_change()
+{
+    TEST_ASSERT_TRUE(cache.refresh(ADOPT_DOC_SIZE));
+    uint32_t builds = cache.getBuildCount();
+
+    // nothing changed, nothing rebuilt
+    TEST_ASSERT_TRUE(cache.refresh(ADOPT_DOC_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(builds, cache.getBuildCount());
+
+    // setConfigSchema, setCommandSchema and _mqttConfig invalidate
+    cache.invalidate();
+    assertRebuilt("invalidate");
+
+    // log levels are config schema defaults
+    oxrsLog.setLevel(OXRS_LOG::WARN);
+    assertRebuilt("setLevel");
+    oxrsLog.setModuleLevel("OXRS_SEN5x", OXRS_LOG::DEBUG);
+    assertRebuilt("setModuleLevel");
+    oxrsLog.clearModuleLevels();
+    assertRebuilt("clearModuleLevels");
+
+    // and config however it arrives, which loggers reflect
+    DynamicJsonDocument config(256);
+    config["logasync"] = false;
+    oxrsLog.onConfig(config.as<JsonVariant>());
+    assertRebuilt("onConfig");
+
+    // as is each logger added
+    static SchemaLogger logger;
+    oxrsLog.addLogger(&logger);
+    assertRebuilt("addLogger");
+}
+
+void test_oversize_not_retried()
+{
+    AdoptCache small;
+    small.addPart("configSchema", configSchemaJson);
+
+    // truncated schemas are never cached, or rebuilt until the next change
+    TEST_ASSERT_FALSE(small.refresh(1024));
+    TEST_ASSERT_FALSE(small.isValid());
+    TEST_ASSERT_EQUAL_size_t(0, small.getSize());
+    TEST_ASSERT_FALSE(small.refresh(ADOPT_DOC_SIZE));
+
+    small.invalidate();
+    TEST_ASSERT_TRUE(small.refresh(ADOPT_DOC_SIZE));
+    TEST_ASSERT_TRUE(small.isValid());
+}
+
+int main()
+{
+    // the Serial logger only gets what the tests do not log
+    DynamicJsonDocument json(128);
+    json[OXRS_LOG::SerialLogger::LEVEL_CONFIG] = "FATAL";
+    oxrsLog.onConfig(json.as<JsonVariant>());
+
+    OXRS_SEN5x sensor(SEN55);
+    sensor.setConfigSchema(fwConfigSchema.to<JsonVariant>());
+    sensor.setCommandSchema(fwCommandSchema.to<JsonVariant>());
+
+    cache.addPart("firmware", firmwareJson);
+    cache.addPart("configSchema", configSchemaJson);
+    cache.addPart("commandSchema", commandSchemaJson);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_cached_matches_full);
+    RUN_TEST(test_adopt_benchmark);
+    RUN_TEST(test_invalidated_by_every_change);
+    RUN_TEST(test_oversize_not_retried);
+    return UNITY_END();
+}
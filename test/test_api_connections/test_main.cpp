@@ -0,0 +1,484 @@
+#include <unity.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+#include <ApiConnections.h>
+
+/*
+ * ApiConnections in front of a stand-in for the REST API, on the loopback
+ * interface: complete requests handed over one at a time, responses kept
+ * alive and chunked, pipelined requests served in order, slow clients and
+ * large bodies not stalling the others, and tail latency of /adopt and
+ * /config with concurrent clients.
+ */
+
+static const size_t ADOPT_LEN = 6000;       // about an adopt payload
+
+static WiFiServer     server(0);
+static ApiConnections connections;
+
+static uint32_t handled;
+static size_t   lastBodyLen;
+static uint32_t overreads;                  // requests that could read past their own
+
+void setUp() {}
+void tearDown() {}
+
+// Stand-in for OXRS_API::loop, which writes without a Content-Length, or
+// Connection header but "close", then stops the client
+static void handleRequest(Client* client)
+{
+    std::string head;
+    while (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n") != 0)
+    {
+        int c = client->read();
+        if (c < 0)
+            break;
+        head.push_back((char)c);
+    }
+
+    size_t length = 0;
+    size_t header = head.find("Content-Length: ");
+    if (header != std::string::npos)
+        length = strtoul(head.c_str() + header + 16, nullptr, 10);
+    std::string body(length, '\0');
+    int n = length ? client->read((uint8_t*)&body[0], length) : 0;
+    lastBodyLen = n > 0 ? n : 0;
+    if (client->available())
+        overreads++;
+    handled++;
+
+    if (head.compare(0, 11, "GET /adopt ") == 0 || head.compare(0, 12, "HEAD /adopt ") == 0)
+    {
+        client->print("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\n\r\n");
+        if (head[0] == 'G')
+        {
+            char chunk[64];
+            for (size_t i = 0; i < ADOPT_LEN; i += sizeof(chunk))
+            {
+                size_t len = std::min(sizeof(chunk), ADOPT_LEN - i);
+                for (size_t j = 0; j < len; j++)
+                    chunk[j] = 'a' + (i + j) % 26;
+                client->write((const uint8_t*)chunk, len);
+            }
+        }
+    }
+    else if (head.compare(0, 13, "POST /config ") == 0)
+    {
+        char response[128];
+        char json[32];
+        snprintf(json, sizeof(json), "{\"received\":%u}", (unsigned)lastBodyLen);
+        snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\nConnection: close\r\n\r\n%s",
+            (unsigned)strlen(json), json);
+        client->print(response);
+    }
+    else
+    {
+        client->print("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+    }
+    client->stop();
+}
+
+static void pump()
+{
+    connections.loop(server, handleRequest);
+}
+
+static std::string adoptBody()
+{
+    std::string body(ADOPT_LEN, '\0');
+    for (size_t i = 0; i < ADOPT_LEN; i++)
+        body[i] = 'a' + i % 26;
+    return body;
+}
+
+typedef struct {
+    int         status;
+    std::string head;
+    std::string body;
+} Response_t;
+
+/*
+ * Client end of a connection, keeping bytes read past one response for
+ * the next, as pipelined responses arrive together
+ */
+class TestClient
+{
+public:
+    ~TestClient()
+    {
+        client.stop();
+    }
+
+    bool connect()
+    {
+        client.setTimeout(1000);
+        return client.connect(IPAddress(127, 0, 0, 1), server.port());
+    }
+
+    void send(const std::string& data)
+    {
+        client.write((const uint8_t*)data.data(), data.size());
+    }
+
+    // Read one response, pumping the server if asked, false if none in 2s
+    bool read(Response_t& response, bool pumping = true, bool head = false)
+    {
+        uint32_t start = millis();
+        while (millis() - start < 2000)
+        {
+            if (pumping)
+                pump();
+
+            uint8_t buffer[1024];
+            int n = client.available() ? client.read(buffer, sizeof(buffer)) : 0;
+            if (n > 0)
+                pending.append((const char*)buffer, n);
+            if (parse(response, head))
+                return true;
+            if (n <= 0)
+                std::this_thread::yield();
+        }
+        return false;
+    }
+
+    bool closed()
+    {
+        return !client.connected();
+    }
+
+    WiFiClient  client;
+    std::string pending;
+
+private:
+    bool parse(Response_t& response, bool head)
+    {
+        size_t headEnd = pending.find("\r\n\r\n");
+        if (headEnd == std::string::npos)
+            return false;
+        headEnd += 4;
+        response.head = pending.substr(0, headEnd);
+        response.status = atoi(pending.c_str() + 9);
+        response.body.clear();
+
+        size_t used;
+        size_t length = response.head.find("Content-Length: ");
+        if (head || response.status == 204)
+        {
+            used = headEnd;
+        }
+        else if (length != std::string::npos)
+        {
+            used = headEnd + strtoul(response.head.c_str() + length + 16, nullptr, 10);
+            if (pending.size() < used)
+                return false;
+            response.body = pending.substr(headEnd, used - headEnd);
+        }
+        else if (response.head.find("Transfer-Encoding: chunked") != std::string::npos)
+        {
+            for (used = headEnd; ; )
+            {
+                size_t eol = pending.find("\r\n", used);
+                if (eol == std::string::npos)
+                    return false;
+                size_t size = strtoul(pending.c_str() + used, nullptr, 16);
+                if (pending.size() < eol + 2 + size + 2)
+                    return false;
+                response.body.append(pending, eol + 2, size);
+                used = eol + 2 + size + 2;
+                if (size == 0)
+                    break;
+            }
+        }
+        else
+        {
+            // to the close
+            if (!closed())
+                return false;
+            used = pending.size();
+            response.body = pending.substr(headEnd);
+        }
+        pending.erase(0, used);
+        return true;
+    }
+};
+
+static bool has(const Response_t& response, const char* header)
+{
+    return response.head.find(header) != std::string::npos;
+}
+
+static std::string postConfig(size_t len, const char* version = "HTTP/1.1")
+{
+    return std::string("POST /config ") + version + "\r\nContent-Type: application/json\r\nContent-Length: " +
+        std::to_string(len) + "\r\n\r\n" + std::string(len, 'x');
+}
+
+void test_keep_alive()
+{
+    TestClient test;
+    TEST_ASSERT_TRUE(test.connect());
+    uint32_t requests = connections.getRequestCount();
+
+    // the response without a length is chunked, and the connection kept
+    Response_t response;
+    test.send("GET /adopt HTTP/1.1\r\nHost: aqs\r\n\r\n");
+    TEST_ASSERT_TRUE(test.read(response));
+    TEST_ASSERT_EQUAL_INT(200, response.status);
+    TEST_ASSERT_TRUE(has(response, "Transfer-Encoding: chunked\r\n"));
+    TEST_ASSERT_TRUE(has(response, "Connection: keep-alive\r\n"));
+    TEST_ASSERT_FALSE(has(response, "Connection: close"));
+    TEST_ASSERT_TRUE(adoptBody() == response.body);
+
+    // one with a length as it is
+    test.send(postConfig(100));
+    TEST_ASSERT_TRUE(test.read(response));
+    TEST_ASSERT_FALSE(has(response, "Transfer-Encoding"));
+    TEST_ASSERT_TRUE(has(response, "Connection: keep-alive\r\n"));
+    TEST_ASSERT_EQUAL_STRING("{\"received\":100}", response.body.c_str());
+
+    // and no body at all for HEAD
+    test.send("HEAD /adopt HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_TRUE(test.read(response, true, true));
+    TEST_ASSERT_FALSE(has(response, "Transfer-Encoding"));
+    TEST_ASSERT_TRUE(has(response, "Connection: keep-alive\r\n"));
+
+    test.send("GET /adopt HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_TRUE(test.read(response));
+    TEST_ASSERT_EQUAL_UINT32(ADOPT_LEN, response.body.size());
+    TEST_ASSERT_FALSE(test.closed());
+    TEST_ASSERT_EQUAL_UINT32(requests + 4, connections.getRequestCount());
+    TEST_ASSERT_EQUAL_UINT32(0, overreads);
+}
+
+void test_pipelined()
+{
+    TestClient test;
+    TEST_ASSERT_TRUE(test.connect());
+
+    // three requests in one write, answered in order
+    test.send(postConfig(10) + "GET /adopt HTTP/1.1\r\n\r\n" + postConfig(20));
+    Response_t response;
+    TEST_ASSERT_TRUE(test.read(response));
+    TEST_ASSERT_EQUAL_STRING("{\"received\":10}", response.body.c_str());
+    TEST_ASSERT_TRUE(test.read(response));
+    TEST_ASSERT_EQUAL_UINT32(ADOPT_LEN, response.body.size());
+    TEST_ASSERT_TRUE(test.read(response));
+    TEST_ASSERT_EQUAL_STRING("{\"received\":20}", response.body.c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, overreads);
+}
+
+void test_closes()
+{
+    // HTTP/1.0 is closed after its response, to the end of which the body runs
+    TestClient http10;
+    TEST_ASSERT_TRUE(http10.connect());
+    http10.send("GET /adopt HTTP/1.0\r\n\r\n");
+    Response_t response;
+    TEST_ASSERT_TRUE(http10.read(response));
+    TEST_ASSERT_TRUE(has(response, "Connection: close\r\n"));
+    TEST_ASSERT_FALSE(has(response, "Transfer-Encoding"));
+    TEST_ASSERT_TRUE(adoptBody() == response.body);
+
+    // as is HTTP/1.1 asking for it
+    TestClient close;
+    TEST_ASSERT_TRUE(close.connect());
+    close.send("POST /config HTTP/1.1\r\nConnection: close\r\nContent-Length: 5\r\n\r\nxxxxx");
+    TEST_ASSERT_TRUE(close.read(response));
+    TEST_ASSERT_TRUE(has(response, "Connection: close\r\n"));
+    pump();
+    TEST_ASSERT_TRUE(close.closed());
+}
+
+void test_slow_client()
+{
+    TestClient slow, fast;
+    TEST_ASSERT_TRUE(slow.connect());
+    TEST_ASSERT_TRUE(fast.connect());
+
+    // half a request does not hold up a whole one
+    uint32_t before = handled;
+    slow.send("POST /config HTTP/1.1\r\nContent-Le");
+    fast.send(postConfig(50));
+    Response_t response;
+    TEST_ASSERT_TRUE(fast.read(response));
+    TEST_ASSERT_EQUAL_UINT32(before + 1, handled);
+
+    // and is served once the rest arrives
+    slow.send("ngth: 30\r\n\r\n" + std::string(15, 'x'));
+    pump();
+    TEST_ASSERT_EQUAL_UINT32(before + 1, handled);
+    slow.send(std::string(15, 'x'));
+    TEST_ASSERT_TRUE(slow.read(response));
+    TEST_ASSERT_EQUAL_STRING("{\"received\":30}", response.body.c_str());
+}
+
+void test_large_bodies()
+{
+    TestClient first, second;
+    TEST_ASSERT_TRUE(first.connect());
+    TEST_ASSERT_TRUE(second.connect());
+
+    // both too large for a slot, so they take turns with the body buffer
+    const size_t len = 3 * ApiConnections::SLOT_LEN;
+    std::string a = postConfig(len), b = postConfig(len + 1);
+    first.send(a.substr(0, 2000));
+    second.send(b.substr(0, 2000));
+    for (uint8_t i = 0; i < 10; i++)
+        pump();
+    second.send(b.substr(2000));
+
+    uint32_t before = handled;
+    for (uint8_t i = 0; i < 10; i++)
+        pump();
+    TEST_ASSERT_EQUAL_UINT32(before, handled);
+
+    Response_t response;
+    first.send(a.substr(2000));
+    TEST_ASSERT_TRUE(first.read(response));
+    TEST_ASSERT_EQUAL_STRING(("{\"received\":" + std::to_string(len) + "}").c_str(), response.body.c_str());
+    TEST_ASSERT_TRUE(second.read(response));
+    TEST_ASSERT_EQUAL_STRING(("{\"received\":" + std::to_string(len + 1) + "}").c_str(), response.body.c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, overreads);
+}
+
+void test_rejected()
+{
+    uint32_t rejected = connections.getRejectedCount();
+
+    TestClient tooLarge;
+    TEST_ASSERT_TRUE(tooLarge.connect());
+    tooLarge.send("POST /config HTTP/1.1\r\nContent-Length: " + std::to_string(ApiConnections::BODY_MAX_LEN + 1) + "\r\n\r\n");
+    Response_t response;
+    TEST_ASSERT_TRUE(tooLarge.read(response));
+    TEST_ASSERT_EQUAL_INT(413, response.status);
+
+    // a request that stops arriving
+    TestClient stalled;
+    TEST_ASSERT_TRUE(stalled.connect());
+    stalled.send("GET /adopt HTTP/1.1\r\n");
+    pump();
+    OXRSNative::advance(ApiConnections::REQUEST_TIMEOUT_MS);
+    TEST_ASSERT_TRUE(stalled.read(response));
+    TEST_ASSERT_EQUAL_INT(408, response.status);
+    TEST_ASSERT_EQUAL_UINT32(rejected + 2, connections.getRejectedCount());
+}
+
+void test_idle_closed()
+{
+    TestClient idle;
+    TEST_ASSERT_TRUE(idle.connect());
+    idle.send(postConfig(1));
+    Response_t response;
+    TEST_ASSERT_TRUE(idle.read(response));
+
+    pump();
+    TEST_ASSERT_FALSE(idle.closed());
+    OXRSNative::advance(ApiConnections::IDLE_TIMEOUT_MS);
+    pump();
+    TEST_ASSERT_TRUE(idle.closed());
+}
+
+// Clients each sending requests over one kept alive connection, and timing
+// each from sending it to its whole response
+static void client(bool adopt, uint32_t requests, std::vector<uint32_t>* latencies, std::atomic<uint32_t>* errors)
+{
+    TestClient test;
+    if (!test.connect())
+    {
+        (*errors)++;
+        return;
+    }
+
+    std::string request = adopt ? "GET /adopt HTTP/1.1\r\nHost: aqs\r\n\r\n" : postConfig(2000);
+    for (uint32_t i = 0; i < requests; i++)
+    {
+        uint64_t start = time_us_64();
+        test.send(request);
+        Response_t response;
+        if (!test.read(response, false) || response.status != 200 ||
+            response.body.size() != (adopt ? ADOPT_LEN : strlen("{\"received\":2000}")))
+        {
+            (*errors)++;
+            return;
+        }
+        latencies->push_back((uint32_t)(time_us_64() - start));
+    }
+}
+
+static void report(const char* name, std::vector<uint32_t>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    size_t n = latencies.size();
+
+    char message[128];
+    snprintf(message, sizeof(message), "%-8s %4u requests p50 %5" PRIu32 " us p99 %5" PRIu32 " us max %5" PRIu32 " us",
+        name, (unsigned)n, latencies[n / 2], latencies[n * 99 / 100], latencies[n - 1]);
+    TEST_MESSAGE(message);
+}
+
+void test_concurrent_latency()
+{
+    static const uint32_t REQUESTS = 200;
+
+    // a client for each slot, two loading the adopt payload, two posting
+    // config large enough to share the body buffer
+    std::vector<uint32_t> latencies[ApiConnections::SLOT_COUNT];
+    std::atomic<uint32_t> errors(0);
+    std::vector<std::thread> clients;
+    for (uint8_t i = 0; i < ApiConnections::SLOT_COUNT; i++)
+        clients.emplace_back(client, i < 2, REQUESTS, &latencies[i], &errors);
+
+    // serve until every client has finished
+    std::atomic<bool> done(false);
+    std::thread waiter([&clients, &done]() {
+        for (std::thread& t : clients)
+            t.join();
+        done = true;
+    });
+    while (!done)
+    {
+        pump();
+        std::this_thread::yield();
+    }
+    waiter.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, errors.load());
+
+    std::vector<uint32_t> adopt(latencies[0]), config(latencies[2]);
+    adopt.insert(adopt.end(), latencies[1].begin(), latencies[1].end());
+    config.insert(config.end(), latencies[3].begin(), latencies[3].end());
+    TEST_ASSERT_EQUAL_UINT32(2 * REQUESTS, adopt.size());
+    TEST_ASSERT_EQUAL_UINT32(2 * REQUESTS, config.size());
+    report("/adopt", adopt);
+    report("/config", config);
+
+    // well within a loop pass budget, even at the tail
+    TEST_ASSERT_LESS_THAN_UINT32(100000, adopt[adopt.size() * 99 / 100]);
+    TEST_ASSERT_LESS_THAN_UINT32(100000, config[config.size() * 99 / 100]);
+}
+
+int main()
+{
+    // rejected requests are logged
+    DynamicJsonDocument json(128);
+    json[OXRS_LOG::SerialLogger::LEVEL_CONFIG] = "FATAL";
+    oxrsLog.onConfig(json.as<JsonVariant>());
+
+    server.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_keep_alive);
+    RUN_TEST(test_pipelined);
+    RUN_TEST(test_closes);
+    RUN_TEST(test_slow_client);
+    RUN_TEST(test_large_bodies);
+    RUN_TEST(test_rejected);
+    RUN_TEST(test_idle_closed);
+    RUN_TEST(test_concurrent_latency);
+    return UNITY_END();
+}
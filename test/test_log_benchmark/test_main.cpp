@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+
+/*
+ * Cost of a log line through OXRS_LOG to a logger, against the String path
+ * it replaced: the message formatted into a 512 byte buffer, then prefix,
+ * level and message concatenated into a heap String for each logger.
+ */
+
+static const uint32_t ITERATIONS = 20000;
+static const char*    PREFIX     = "[OXRS_SEN5x] ";
+
+void setUp() {}
+void tearDown() {}
+
+// Logger that only counts what it is passed
+class CountingLogger : public OXRS_LOG::AbstractLogger {
+public:
+    virtual void log(const OXRS_LOG::LogEntry_t& entry) {
+        lines++;
+        bytes += entry.lineLen;
+    }
+
+    // as loggers were passed lines before
+    void log(OXRS_LOG::LogLevel_t level, const String& line) {
+        lines++;
+        bytes += line.length();
+    }
+
+    virtual void onConfig(JsonVariant json) {};
+    virtual void setConfig(JsonVariant json) {};
+
+    uint32_t lines = 0;
+    size_t   bytes = 0;
+};
+
+static CountingLogger counter;
+
+// Replaced String path, refer OXRS_LOG::logf and log before the shared buffer
+static void legacyLog(OXRS_LOG::LogLevel_t level, const char* prefix, const char* logEvent)
+{
+    String logLine(prefix);
+    logLine.concat(OXRS_LOG::levelStr[level]);
+    logLine.concat(logEvent);
+    counter.log(level, logLine);
+}
+
+static void legacyLogf(OXRS_LOG::LogLevel_t level, const char* prefix, const char* fmt, ...)
+{
+    static char buffer[MAX_BUF_LEN];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, MAX_BUF_LEN, fmt, args);
+    va_end(args);
+    legacyLog(level, prefix, buffer);
+}
+
+// lines alternate so none are collapsed as repeats
+static void logFormatted(uint32_t i)
+{
+    oxrsLog.logf(OXRS_LOG::INFO, PREFIX, "Set temperature offset: %.02f celsius", i / 100.0f);
+}
+
+static void logConstant(uint32_t i)
+{
+    oxrsLog.log(OXRS_LOG::INFO, PREFIX, (i & 1) ? "Sensor ready" : "Sensor not ready");
+}
+
+static void legacyFormatted(uint32_t i)
+{
+    legacyLogf(OXRS_LOG::INFO, PREFIX, "Set temperature offset: %.02f celsius", i / 100.0f);
+}
+
+static void legacyConstant(uint32_t i)
+{
+    legacyLog(OXRS_LOG::INFO, PREFIX, (i & 1) ? "Sensor ready" : "Sensor not ready");
+}
+
+typedef void (*line_t)(uint32_t i);
+
+typedef struct {
+    uint32_t ns;            // per line
+    uint32_t allocations;   // per line
+    size_t   bytes;         // heap peak per line, bytes above the heap in use beforehand
+} result_t;
+
+static result_t run(line_t line, const char* name)
+{
+    counter.lines = 0;
+    counter.bytes = 0;
+
+    size_t heapBefore = OXRSNative::heapUsed();
+    OXRSNative::resetHeapPeak();
+    uint32_t allocationsBefore = OXRSNative::allocations();
+    uint64_t start = time_us_64();
+
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+        line(i);
+
+    result_t result;
+    result.ns = (uint32_t)((time_us_64() - start) * 1000 / ITERATIONS);
+    result.allocations = (OXRSNative::allocations() - allocationsBefore) / ITERATIONS;
+    result.bytes = OXRSNative::heapPeak() - heapBefore;
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, counter.lines);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%-16s %5" PRIu32 " ns/line %2" PRIu32 " allocations/line %4u bytes peak heap %3u bytes/line",
+        name, result.ns, result.allocations, (unsigned)result.bytes, (unsigned)(counter.bytes / ITERATIONS));
+    TEST_MESSAGE(message);
+    return result;
+}
+
+void test_lines_match_legacy()
+{
+    size_t bytes;
+    counter.bytes = 0;
+    logFormatted(301);
+    bytes = counter.bytes;
+    counter.bytes = 0;
+    legacyFormatted(301);
+    TEST_ASSERT_EQUAL_UINT32(counter.bytes, bytes);
+    TEST_ASSERT_EQUAL_UINT32(strlen("[OXRS_SEN5x] [INFO] Set temperature offset: 3.01 celsius"), bytes);
+}
+
+void test_log_benchmark()
+{
+    result_t formatted = run(logFormatted, "logf");
+    result_t constant = run(logConstant, "log");
+    result_t legacyF = run(legacyFormatted, "legacy logf");
+    result_t legacyC = run(legacyConstant, "legacy log");
+
+    TEST_ASSERT_EQUAL_UINT32(0, formatted.allocations);
+    TEST_ASSERT_EQUAL_UINT32(0, formatted.bytes);
+    TEST_ASSERT_EQUAL_UINT32(0, constant.allocations);
+    TEST_ASSERT_EQUAL_UINT32(0, constant.bytes);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, legacyF.allocations);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, legacyC.allocations);
+}
+
+int main()
+{
+    // the Serial logger only gets what the benchmark does not log
+    DynamicJsonDocument json(128);
+    json[OXRS_LOG::SerialLogger::LEVEL_CONFIG] = "FATAL";
+    oxrsLog.onConfig(json.as<JsonVariant>());
+    oxrsLog.setLevel(OXRS_LOG::INFO);
+
+    counter.setEnable(true);
+    oxrsLog.addLogger(&counter);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_lines_match_legacy);
+    RUN_TEST(test_log_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,167 @@
+#include <unity.h>
+#include <string>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+
+/*
+ * Suppression in OXRS_LOG: the token bucket of each call site, kept per core,
+ * the keyed limit of LOGF_ERROR_KEY, and repeated lines collapsed into a
+ * summary.
+ */
+
+static const char *_LOG_PREFIX = "[LIMIT_TEST] ";
+
+void setUp() {}
+void tearDown() {}
+
+// Logger that keeps the last line it is passed
+class LastLineLogger : public OXRS_LOG::AbstractLogger {
+public:
+    virtual void log(const OXRS_LOG::LogEntry_t& entry) {
+        lines++;
+        last.assign(entry.line, entry.lineLen);
+    }
+
+    virtual void onConfig(JsonVariant json) {};
+    virtual void setConfig(JsonVariant json) {};
+
+    uint32_t    lines = 0;
+    std::string last;
+};
+
+static LastLineLogger logger;
+
+// each function is one call site, lines differ so none are repeats
+static uint32_t sequence = 0;
+
+static void logSite()
+{
+    LOGF_INFO("site %" PRIu32, sequence++);
+}
+
+static void logKeyed(uintptr_t key)
+{
+    LOGF_ERROR_KEY(key, "key %u line %" PRIu32, (unsigned)key, sequence++);
+}
+
+// Lines passed out of count calls, at the same time
+static uint32_t burst(void (*call)(), uint32_t count)
+{
+    uint32_t before = logger.lines;
+    for (uint32_t i = 0; i < count; i++)
+        call();
+    return logger.lines - before;
+}
+
+static uint32_t burstKeyed(uintptr_t key, uint32_t count)
+{
+    uint32_t before = logger.lines;
+    for (uint32_t i = 0; i < count; i++)
+        logKeyed(key);
+    return logger.lines - before;
+}
+
+void test_call_site_limit()
+{
+    uint32_t limited = oxrsLog.getRateLimitedCount();
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burst(logSite, 100));
+    TEST_ASSERT_EQUAL_UINT32(100 - LOG_LIMIT_BURST, oxrsLog.getRateLimitedCount() - limited);
+
+    // then one line a period
+    OXRSNative::advance(LOG_LIMIT_PERIOD_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, burst(logSite, 10));
+
+    // and a full burst once idle
+    OXRSNative::advance(LOG_LIMIT_BURST * LOG_LIMIT_PERIOD_MS);
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burst(logSite, 100));
+    OXRSNative::advance(LOG_LIMIT_BURST * LOG_LIMIT_PERIOD_MS);
+}
+
+void test_call_site_limit_per_core()
+{
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burst(logSite, 100));
+
+    // the other core has its own bucket
+    OXRSNative::setCore(1);
+    TEST_ASSERT_EQUAL_UINT8(1, OXRS_LOG::getCore());
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burst(logSite, 100));
+    OXRSNative::setCore(0);
+
+    OXRSNative::advance(LOG_LIMIT_BURST * LOG_LIMIT_PERIOD_MS);
+}
+
+void test_keyed_limit()
+{
+    // a flooding key does not use up the limit of the others
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burstKeyed(1, 100));
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burstKeyed(2, 100));
+    TEST_ASSERT_EQUAL_UINT32(0, burstKeyed(1, 10));
+
+    OXRSNative::advance(LOG_LIMIT_PERIOD_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, burstKeyed(1, 10));
+    TEST_ASSERT_EQUAL_UINT32(1, burstKeyed(2, 10));
+
+    OXRSNative::advance(LOG_LIMIT_BURST * LOG_LIMIT_PERIOD_MS);
+}
+
+void test_keyed_limit_evicts_least_recent()
+{
+    // key 100 is exhausted, then LOG_LIMIT_KEYS newer keys take every slot
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burstKeyed(100, 100));
+    for (uintptr_t key = 101; key <= 100 + LOG_LIMIT_KEYS; key++)
+    {
+        OXRSNative::advance(1);
+        burstKeyed(key, 1);
+    }
+
+    // so key 100 starts again with a full bucket
+    TEST_ASSERT_EQUAL_UINT32(LOG_LIMIT_BURST, burstKeyed(100, 100));
+
+    OXRSNative::advance(LOG_LIMIT_BURST * LOG_LIMIT_PERIOD_MS);
+}
+
+void test_repeats_collapsed()
+{
+    uint32_t repeated = oxrsLog.getRepeatedCount();
+    uint32_t before = logger.lines;
+
+    for (uint32_t i = 0; i < 5; i++)
+        oxrsLog.log(OXRS_LOG::WARN, _LOG_PREFIX, "Sensor not ready");
+    TEST_ASSERT_EQUAL_UINT32(1, logger.lines - before);
+    TEST_ASSERT_EQUAL_UINT32(4, oxrsLog.getRepeatedCount() - repeated);
+
+    // summarised ahead of the next line
+    oxrsLog.log(OXRS_LOG::WARN, _LOG_PREFIX, "Sensor ready");
+    TEST_ASSERT_EQUAL_UINT32(3, logger.lines - before);
+    TEST_ASSERT_EQUAL_STRING("[LIMIT_TEST] [WARN] Sensor ready", logger.last.c_str());
+
+    // or once held long enough
+    oxrsLog.log(OXRS_LOG::WARN, _LOG_PREFIX, "Sensor ready");
+    OXRSNative::advance(LOG_REPEAT_SUMMARY_MS);
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(4, logger.lines - before);
+    TEST_ASSERT_EQUAL_STRING("[LIMIT_TEST] [WARN] Last message repeated 1 times", logger.last.c_str());
+}
+
+int main()
+{
+    // the Serial logger only gets what the tests do not log
+    DynamicJsonDocument json(128);
+    json[OXRS_LOG::SerialLogger::LEVEL_CONFIG] = "FATAL";
+    oxrsLog.onConfig(json.as<JsonVariant>());
+    oxrsLog.setLevel(OXRS_LOG::DEBUG);
+
+    logger.setEnable(true);
+    oxrsLog.addLogger(&logger);
+
+    // a clear bucket for every call site
+    OXRSNative::advance(LOG_LIMIT_BURST * LOG_LIMIT_PERIOD_MS);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_call_site_limit);
+    RUN_TEST(test_call_site_limit_per_core);
+    RUN_TEST(test_keyed_limit);
+    RUN_TEST(test_keyed_limit_evicts_least_recent);
+    RUN_TEST(test_repeats_collapsed);
+    return UNITY_END();
+}
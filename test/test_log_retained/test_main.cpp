@@ -0,0 +1,212 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG_RETAINED.h>
+
+/*
+ * OXRS_LOG_RETAINED over a pair of regions that outlive it, as the retained
+ * RAM outlives a warm reboot. Each boot is a new OXRS_LOG_RETAINED.
+ */
+
+static OXRS_LOG_RETAINED::Region_t regions[2];
+
+void setUp() {}
+void tearDown() {}
+
+// RAM as found at power on
+static void powerOn()
+{
+    uint8_t* p = (uint8_t*)regions;
+    for (size_t i = 0; i < sizeof(regions); i++)
+        p[i] = (uint8_t)(i * 2654435761u >> 13);
+}
+
+static void writeLine(OXRS_LOG_RETAINED& retained, uint32_t i)
+{
+    char line[32];
+    int n = snprintf(line, sizeof(line), "line %" PRIu32, i);
+    retained.write(2, i * 10, false, line, n);
+}
+
+// Text of the previous boot's records, oldest first
+static std::vector<std::string> previous(const OXRS_LOG_RETAINED& retained)
+{
+    std::vector<std::string> lines;
+    retained.forEachPrevious([&lines](const OXRS_LOG_RETAINED::Record_t& record) {
+        lines.push_back(std::string(record.text, record.len));
+    });
+    return lines;
+}
+
+void test_power_on()
+{
+    powerOn();
+    OXRS_LOG_RETAINED retained(regions);
+    TEST_ASSERT_FALSE(retained.hasPrevious());
+    TEST_ASSERT_EQUAL_UINT32(1, retained.getBoot());
+    TEST_ASSERT_EQUAL_UINT32(0, previous(retained).size());
+}
+
+void test_replay_after_reboot()
+{
+    powerOn();
+    {
+        OXRS_LOG_RETAINED retained(regions);
+        for (uint32_t i = 0; i < 5; i++)
+            writeLine(retained, i);
+    }
+
+    OXRS_LOG_RETAINED retained(regions);
+    TEST_ASSERT_TRUE(retained.hasPrevious());
+    TEST_ASSERT_EQUAL_UINT32(2, retained.getBoot());
+
+    std::vector<std::string> lines = previous(retained);
+    TEST_ASSERT_EQUAL_UINT32(5, lines.size());
+    TEST_ASSERT_EQUAL_STRING("line 0", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("line 4", lines[4].c_str());
+
+    // and the record metadata
+    uint32_t count = 0;
+    retained.forEachPrevious([&count](const OXRS_LOG_RETAINED::Record_t& record) {
+        TEST_ASSERT_EQUAL_UINT8(2, record.level);
+        TEST_ASSERT_EQUAL_UINT8(0, record.binary);
+        TEST_ASSERT_EQUAL_UINT32(count * 10, record.timestamp_ms);
+        count++;
+    });
+}
+
+void test_wraps_to_latest()
+{
+    powerOn();
+    {
+        OXRS_LOG_RETAINED retained(regions);
+        for (uint32_t i = 0; i < 3 * LOG_RETAINED_RECORDS + 5; i++)
+            writeLine(retained, i);
+    }
+
+    OXRS_LOG_RETAINED retained(regions);
+    std::vector<std::string> lines = previous(retained);
+    TEST_ASSERT_EQUAL_UINT32(LOG_RETAINED_RECORDS, lines.size());
+    std::string oldest = "line " + std::to_string(2 * LOG_RETAINED_RECORDS + 5);
+    std::string latest = "line " + std::to_string(3 * LOG_RETAINED_RECORDS + 4);
+    TEST_ASSERT_EQUAL_STRING(oldest.c_str(), lines.front().c_str());
+    TEST_ASSERT_EQUAL_STRING(latest.c_str(), lines.back().c_str());
+}
+
+void test_torn_record_skipped()
+{
+    powerOn();
+    {
+        OXRS_LOG_RETAINED retained(regions);
+        for (uint32_t i = 0; i < 5; i++)
+            writeLine(retained, i);
+    }
+
+    // a reboot part way through writing record 2
+    for (OXRS_LOG_RETAINED::Region_t& region : regions)
+        region.records[2].text[1] ^= 0x40;
+
+    OXRS_LOG_RETAINED retained(regions);
+    std::vector<std::string> lines = previous(retained);
+    TEST_ASSERT_EQUAL_UINT32(4, lines.size());
+    TEST_ASSERT_EQUAL_STRING("line 1", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("line 3", lines[2].c_str());
+}
+
+void test_only_last_boot_kept()
+{
+    powerOn();
+    for (uint32_t boot = 0; boot < 3; boot++)
+    {
+        OXRS_LOG_RETAINED retained(regions);
+        writeLine(retained, 100 + boot);
+    }
+
+    OXRS_LOG_RETAINED retained(regions);
+    TEST_ASSERT_EQUAL_UINT32(4, retained.getBoot());
+    std::vector<std::string> lines = previous(retained);
+    TEST_ASSERT_EQUAL_UINT32(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("line 102", lines[0].c_str());
+
+    // nothing written this boot, so the next boot finds none
+    OXRS_LOG_RETAINED next(regions);
+    TEST_ASSERT_TRUE(next.hasPrevious());
+    TEST_ASSERT_EQUAL_UINT32(0, previous(next).size());
+}
+
+void test_boot_number_wraps()
+{
+    powerOn();
+    {
+        OXRS_LOG_RETAINED retained(regions);
+        writeLine(retained, 1);
+    }
+
+    // the newer region is found across the boot number wrapping
+    OXRS_LOG_RETAINED::Region_t& written = regions[0].boot == 1 ? regions[0] : regions[1];
+    OXRS_LOG_RETAINED::Region_t& other = &written == &regions[0] ? regions[1] : regions[0];
+    other = written;
+    other.boot = 0xFFFFFFFF;
+    other.check = ~(OXRS_LOG_RETAINED::REGION_MAGIC ^ other.boot);
+    written.boot = 0;
+    written.check = ~(OXRS_LOG_RETAINED::REGION_MAGIC ^ written.boot);
+    written.records[0].text[5] = '2';
+    written.records[0].checksum = 0;
+
+    OXRS_LOG_RETAINED retained(regions);
+    TEST_ASSERT_EQUAL_UINT32(1, retained.getBoot());
+}
+
+void test_truncated()
+{
+    powerOn();
+    char line[OXRS_LOG_RETAINED::TEXT_LEN + 20];
+    memset(line, 'x', sizeof(line));
+    {
+        OXRS_LOG_RETAINED retained(regions);
+        retained.write(4, 0, true, line, sizeof(line));
+    }
+
+    OXRS_LOG_RETAINED retained(regions);
+    uint32_t count = 0;
+    retained.forEachPrevious([&count](const OXRS_LOG_RETAINED::Record_t& record) {
+        TEST_ASSERT_EQUAL_UINT32(OXRS_LOG_RETAINED::TEXT_LEN, record.len);
+        TEST_ASSERT_EQUAL_UINT8(1, record.binary);
+        count++;
+    });
+    TEST_ASSERT_EQUAL_UINT32(1, count);
+}
+
+// Cost of mirroring a line, paid on every line logged
+void test_write_cost()
+{
+    static const uint32_t ITERATIONS = 200000;
+    static const char LINE[] = "[OXRS_SEN5x] [INFO] Set temperature offset: 1.50 celsius";
+
+    powerOn();
+    OXRS_LOG_RETAINED retained(regions);
+    uint64_t start = time_us_64();
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+        retained.write(2, i, false, LINE, sizeof(LINE) - 1);
+    uint32_t ns = (uint32_t)((time_us_64() - start) * 1000 / ITERATIONS);
+
+    char message[64];
+    snprintf(message, sizeof(message), "%" PRIu32 " ns/write of %u bytes", ns, (unsigned)(sizeof(LINE) - 1));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_UINT32(2000, ns);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_power_on);
+    RUN_TEST(test_replay_after_reboot);
+    RUN_TEST(test_wraps_to_latest);
+    RUN_TEST(test_torn_record_skipped);
+    RUN_TEST(test_only_last_boot_kept);
+    RUN_TEST(test_boot_number_wraps);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_write_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,127 @@
+#include <unity.h>
+#include <algorithm>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+
+/*
+ * Cost of fanning a DEBUG line out to 1, 3 and 6 loggers when only one of
+ * them wants it, the others disabled or at a higher minimum level, as with
+ * only Serial logging at DEBUG. Each logger that does not want the line
+ * should cost one compare, not a call.
+ */
+
+static const uint32_t ITERATIONS = 100000;
+static const uint8_t  ROUNDS     = 5;
+static const char*    PREFIX     = "[SINK_TEST] ";
+
+void setUp() {}
+void tearDown() {}
+
+// Logger that only counts what it is passed
+class CountingLogger : public OXRS_LOG::AbstractLogger {
+public:
+    virtual void log(const OXRS_LOG::LogEntry_t& entry) {
+        lines++;
+    }
+
+    virtual void onConfig(JsonVariant json) {};
+    virtual void setConfig(JsonVariant json) {};
+
+    uint32_t lines = 0;
+};
+
+static CountingLogger wanted;           // stands in for Serial at DEBUG
+static CountingLogger others[5];        // disabled, or at INFO and above
+
+// lines alternate so none are collapsed as repeats
+static uint32_t run(uint8_t sinks)
+{
+    wanted.lines = 0;
+    for (CountingLogger& other : others)
+        other.lines = 0;
+
+    // best of a few rounds, as the host is not idle
+    uint32_t ns = UINT32_MAX;
+    for (uint8_t round = 0; round < ROUNDS; round++)
+    {
+        uint64_t start = time_us_64();
+        for (uint32_t i = 0; i < ITERATIONS; i++)
+            oxrsLog.log(OXRS_LOG::DEBUG, PREFIX, (i & 1) ? "Sensor ready" : "Sensor not ready");
+        ns = std::min(ns, (uint32_t)((time_us_64() - start) * 1000 / ITERATIONS));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS * ITERATIONS, wanted.lines);
+    for (CountingLogger& other : others)
+        TEST_ASSERT_EQUAL_UINT32(0, other.lines);
+
+    char message[64];
+    snprintf(message, sizeof(message), "%u loggers and Serial %5" PRIu32 " ns/line", sinks, ns);
+    TEST_MESSAGE(message);
+    return ns;
+}
+
+void test_only_wanted_dispatched()
+{
+    // an INFO line does reach the loggers at INFO
+    wanted.lines = 0;
+    oxrsLog.log(OXRS_LOG::INFO, PREFIX, "Sensor started");
+    TEST_ASSERT_EQUAL_UINT32(1, wanted.lines);
+    TEST_ASSERT_EQUAL_UINT32(0, others[0].lines);
+    TEST_ASSERT_EQUAL_UINT32(1, others[1].lines);
+    TEST_ASSERT_EQUAL_UINT32(0, others[2].lines);
+    TEST_ASSERT_EQUAL_UINT32(1, others[3].lines);
+    TEST_ASSERT_EQUAL_UINT32(0, others[4].lines);
+
+    // and a disabled logger gets nothing, whatever its level
+    oxrsLog.log(OXRS_LOG::FATAL, PREFIX, "Sensor failed");
+    TEST_ASSERT_EQUAL_UINT32(0, others[0].lines);
+    TEST_ASSERT_EQUAL_UINT32(0, others[2].lines);
+    TEST_ASSERT_EQUAL_UINT32(2, others[1].lines);
+}
+
+void test_sinks_benchmark()
+{
+    // besides the Serial logger, at FATAL
+    uint32_t one = run(1);
+
+    oxrsLog.addLogger(&others[0]);
+    oxrsLog.addLogger(&others[1]);
+    uint32_t three = run(3);
+
+    oxrsLog.addLogger(&others[2]);
+    oxrsLog.addLogger(&others[3]);
+    oxrsLog.addLogger(&others[4]);
+    uint32_t six = run(6);
+
+    // five unwanted loggers cost far less than formatting the line
+    char message[64];
+    snprintf(message, sizeof(message), "%" PRId32 " ns/line for 5 more loggers", (int32_t)(six - one));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_UINT32(one * 2, six);
+    TEST_ASSERT_LESS_THAN_UINT32(one * 2, three);
+}
+
+int main()
+{
+    // the Serial logger only gets what the benchmark does not log
+    DynamicJsonDocument json(128);
+    json[OXRS_LOG::SerialLogger::LEVEL_CONFIG] = "FATAL";
+    oxrsLog.onConfig(json.as<JsonVariant>());
+    oxrsLog.setLevel(OXRS_LOG::DEBUG);
+
+    wanted.setEnable(true);
+    wanted.setMinLevel(OXRS_LOG::DEBUG);
+    oxrsLog.addLogger(&wanted);
+
+    // alternately disabled, and enabled at INFO
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        others[i].setEnable(i & 1);
+        others[i].setMinLevel(OXRS_LOG::INFO);
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_sinks_benchmark);
+    RUN_TEST(test_only_wanted_dispatched);
+    return UNITY_END();
+}
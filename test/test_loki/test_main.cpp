@@ -0,0 +1,309 @@
+#include <unity.h>
+#include <string>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+#include <WiFi.h>
+
+/*
+ * LokiLogger pushing to a stub HTTP server on the loopback interface, which
+ * the test answers by hand: one request per batch over a kept alive
+ * connection, the response read on later polls, and lines kept until it
+ * arrives.
+ */
+
+static const char* PREFIX = "[LOKI_TEST] ";
+
+static WiFiServer server(0);
+static WiFiClient lokiClient;
+static OXRS_LOG::LokiLogger loki(lokiClient);
+static WiFiClient serverClient;        // server side of the logger's connection
+
+typedef struct {
+    std::string head;
+    std::string body;
+} Request_t;
+
+void setUp() {}
+void tearDown() {}
+
+static void configure()
+{
+    char url[64];
+    snprintf(url, sizeof(url), "http://localhost:%u/loki/api/v1/push", server.port());
+
+    DynamicJsonDocument json(256);
+    json[OXRS_LOG::LokiLogger::LOKI_ENABLE]  = true;
+    json[OXRS_LOG::LokiLogger::URL_CONFIG]   = url;
+    json[OXRS_LOG::LokiLogger::BATCH_CONFIG] = 1000;
+    json[OXRS_LOG::LokiLogger::LEVEL_CONFIG] = "DEBUG";
+    loki.onConfig(json.as<JsonVariant>());
+}
+
+static void logLines(uint32_t from, uint32_t count)
+{
+    for (uint32_t i = from; i < from + count; i++)
+        oxrsLog.logf(OXRS_LOG::INFO, PREFIX, "line %" PRIu32, i);
+}
+
+// Pass the batch window, so the next pump pushes
+static void pushDue()
+{
+    OXRSNative::advance(1000);
+    oxrsLog.pump();
+}
+
+// Accept the logger's connection, if it opened a new one
+static bool acceptIfNew()
+{
+    if (!server.hasClient())
+        return false;
+    serverClient = server.accept();
+    return true;
+}
+
+// Read one request, head and Content-Length body, false if there is none
+static bool readRequest(Request_t& request)
+{
+    std::string data;
+    size_t headEnd = std::string::npos;
+    size_t length = 0;
+    for (uint32_t idle = 0; idle < 1000; idle++)
+    {
+        int c = serverClient.read();
+        if (c < 0)
+            continue;
+        idle = 0;
+        data.push_back((char)c);
+
+        if (headEnd == std::string::npos && (headEnd = data.find("\r\n\r\n")) != std::string::npos)
+        {
+            headEnd += 4;
+            size_t header = data.find("Content-Length: ");
+            if (header == std::string::npos)
+                return false;
+            length = strtoul(data.c_str() + header + 16, nullptr, 10);
+        }
+        if (headEnd != std::string::npos && data.size() == headEnd + length)
+        {
+            request.head = data.substr(0, headEnd);
+            request.body = data.substr(headEnd);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void respond(const char* response)
+{
+    serverClient.write((const uint8_t*)response, strlen(response));
+}
+
+static size_t countLines(const Request_t& request)
+{
+    DynamicJsonDocument json(16384);
+    TEST_ASSERT_FALSE(deserializeJson(json, request.body.c_str()));
+
+    size_t lines = 0;
+    for (JsonObject stream : json["streams"].as<JsonArray>())
+        lines += stream["values"].as<JsonArray>().size();
+    return lines;
+}
+
+void test_push_batch()
+{
+    configure();
+    uint32_t lookups = WiFi.getHostByNameCount();
+
+    logLines(0, 5);
+    oxrsLog.pump();
+    TEST_ASSERT_FALSE(server.hasClient());
+
+    pushDue();
+    TEST_ASSERT_TRUE(acceptIfNew());
+    Request_t request;
+    TEST_ASSERT_TRUE(readRequest(request));
+    TEST_ASSERT_EQUAL_UINT32(0, request.head.find("POST /loki/api/v1/push HTTP/1.1\r\n"));
+    TEST_ASSERT_TRUE(request.head.find("Connection: close") == std::string::npos);
+
+    // labels and nanosecond timestamps, after the logger's own "Loki enabled"
+    DynamicJsonDocument json(16384);
+    TEST_ASSERT_FALSE(deserializeJson(json, request.body.c_str()));
+    JsonObject stream = json["streams"][1];
+    TEST_ASSERT_EQUAL_STRING("OXRS_LOG", json["streams"][0]["stream"]["module"] | "");
+    TEST_ASSERT_EQUAL_STRING("aqs", stream["stream"]["device"] | "");
+    TEST_ASSERT_EQUAL_STRING("info", stream["stream"]["level"] | "");
+    TEST_ASSERT_EQUAL_STRING("LOKI_TEST", stream["stream"]["module"] | "");
+    TEST_ASSERT_EQUAL_UINT32(5, stream["values"].as<JsonArray>().size());
+    TEST_ASSERT_EQUAL_UINT32(19, strlen(stream["values"][0][0] | ""));
+    TEST_ASSERT_EQUAL_STRING("line 0", stream["values"][0][1] | "");
+
+    // nothing more is pushed while the response is outstanding
+    pushDue();
+    TEST_ASSERT_FALSE(readRequest(request));
+
+    respond("HTTP/1.1 204 No Content\r\n\r\n");
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(0, loki.getFailureCount());
+    TEST_ASSERT_EQUAL_UINT32(1, WiFi.getHostByNameCount() - lookups);
+}
+
+void test_keep_alive()
+{
+    uint32_t lookups = WiFi.getHostByNameCount();
+
+    // lines logged while a push is in flight go in the next one
+    logLines(100, 3);
+    pushDue();
+    Request_t request;
+    TEST_ASSERT_TRUE(readRequest(request));
+    TEST_ASSERT_EQUAL_UINT32(3, countLines(request));
+
+    logLines(200, 2);
+    respond("HTTP/1.1 204 No Content\r\nDate: Sat, 17 Oct 2026 00:00:00 GMT\r\n\r\n");
+    oxrsLog.pump();
+
+    pushDue();
+    TEST_ASSERT_FALSE(acceptIfNew());
+    TEST_ASSERT_TRUE(readRequest(request));
+    TEST_ASSERT_EQUAL_UINT32(2, countLines(request));
+    respond("HTTP/1.1 204 No Content\r\n\r\n");
+    oxrsLog.pump();
+
+    TEST_ASSERT_EQUAL_UINT32(0, WiFi.getHostByNameCount() - lookups);
+    TEST_ASSERT_EQUAL_UINT32(0, loki.getFailureCount());
+    TEST_ASSERT_EQUAL_UINT32(0, loki.getDroppedCount());
+}
+
+void test_retry_after_error()
+{
+    logLines(300, 4);
+    pushDue();
+    Request_t request;
+    TEST_ASSERT_TRUE(readRequest(request));
+
+    // the logger closes the connection on anything but a 204
+    respond("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(1, loki.getFailureCount());
+    TEST_ASSERT_EQUAL_INT(-1, serverClient.read());
+    TEST_ASSERT_FALSE(serverClient.connected());
+
+    // and retries the same lines after the backoff, on a new connection
+    oxrsLog.pump();
+    TEST_ASSERT_FALSE(server.hasClient());
+    OXRSNative::advance(OXRS_LOG::LokiLogger::MIN_BACKOFF_MS);
+    oxrsLog.pump();
+    TEST_ASSERT_TRUE(acceptIfNew());
+    TEST_ASSERT_TRUE(readRequest(request));
+    TEST_ASSERT_EQUAL_UINT32(4, countLines(request));
+    respond("HTTP/1.1 204 No Content\r\n\r\n");
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(0, loki.getDroppedCount());
+}
+
+void test_response_timeout()
+{
+    uint32_t failures = loki.getFailureCount();
+    uint32_t lookups = WiFi.getHostByNameCount();
+
+    logLines(400, 2);
+    pushDue();
+    Request_t request;
+    TEST_ASSERT_TRUE(readRequest(request));
+
+    // no response, the push fails, but the server took the connection so
+    // its address is kept
+    OXRSNative::advance(OXRS_LOG::LokiLogger::RESPONSE_TIMEOUT_MS);
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(failures + 1, loki.getFailureCount());
+
+    OXRSNative::advance(OXRS_LOG::LokiLogger::MIN_BACKOFF_MS);
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(0, WiFi.getHostByNameCount() - lookups);
+    TEST_ASSERT_TRUE(acceptIfNew());
+    TEST_ASSERT_TRUE(readRequest(request));
+    TEST_ASSERT_EQUAL_UINT32(2, countLines(request));
+    respond("HTTP/1.1 204 No Content\r\n\r\n");
+    oxrsLog.pump();
+}
+
+void test_rejected_lines_dropped()
+{
+    uint32_t failures = loki.getFailureCount();
+
+    logLines(500, 3);
+    pushDue();
+    Request_t request;
+    TEST_ASSERT_TRUE(readRequest(request));
+
+    // a bad request is not retried
+    respond("HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n");
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(failures + 1, loki.getFailureCount());
+    TEST_ASSERT_EQUAL_UINT32(3, loki.getDroppedCount());
+
+    pushDue();
+    TEST_ASSERT_FALSE(server.hasClient());
+}
+
+void test_unreachable_server()
+{
+    // nothing listens on port 1
+    DynamicJsonDocument json(256);
+    json[OXRS_LOG::LokiLogger::LOKI_ENABLE] = true;
+    json[OXRS_LOG::LokiLogger::URL_CONFIG]  = "http://localhost:1/loki/api/v1/push";
+    loki.onConfig(json.as<JsonVariant>());
+
+    // looked up once the network is up, not when pushing
+    uint32_t lookups = WiFi.getHostByNameCount();
+    uint32_t failures = loki.getFailureCount();
+    uint32_t dropped = loki.getDroppedCount();
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(1, WiFi.getHostByNameCount() - lookups);
+
+    // a refused connect costs no more than the connect bound
+    logLines(600, 2);
+    OXRSNative::advance(1000);
+    uint64_t start = time_us_64();
+    oxrsLog.pump();
+    uint32_t pushed_us = time_us_64() - start;
+    TEST_ASSERT_EQUAL_UINT32(failures + 1, loki.getFailureCount());
+    TEST_ASSERT_LESS_THAN_UINT32(OXRS_LOG::LokiLogger::CONNECT_TIMEOUT_MS * 1000 + 5000, pushed_us);
+
+    // the failed connect has the address looked up again, but not on
+    // every backoff retry
+    for (uint8_t retry = 0; retry < 5; retry++)
+    {
+        OXRSNative::advance(OXRS_LOG::LokiLogger::RESOLVE_RETRY_MS / 10);
+        oxrsLog.pump();
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, WiFi.getHostByNameCount() - lookups);
+    TEST_ASSERT_EQUAL_UINT32(failures + 1, loki.getFailureCount());
+
+    OXRSNative::advance(OXRS_LOG::LokiLogger::RESOLVE_RETRY_MS);
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(2, WiFi.getHostByNameCount() - lookups);
+    TEST_ASSERT_EQUAL_UINT32(failures + 2, loki.getFailureCount());
+    TEST_ASSERT_EQUAL_UINT32(dropped, loki.getDroppedCount());
+}
+
+int main()
+{
+    // the Serial logger only gets what the tests do not log
+    DynamicJsonDocument json(128);
+    json[OXRS_LOG::SerialLogger::LEVEL_CONFIG] = "FATAL";
+    oxrsLog.onConfig(json.as<JsonVariant>());
+
+    server.begin();
+    loki.setDevice("aqs");
+    oxrsLog.addLogger(&loki);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_push_batch);
+    RUN_TEST(test_keep_alive);
+    RUN_TEST(test_retry_after_error);
+    RUN_TEST(test_response_timeout);
+    RUN_TEST(test_rejected_lines_dropped);
+    RUN_TEST(test_unreachable_server);
+    return UNITY_END();
+}
@@ -0,0 +1,210 @@
+#include <unity.h>
+#include <thread>
+#include <OXRS_SPSC.h>
+#include <OXRS_RING.h>
+
+// items passed between threads, every word carries the sequence number so a
+// torn copy shows up as a mismatch
+typedef struct {
+    uint32_t seq;
+    uint32_t words[7];
+} item_t;
+
+static const uint32_t STRESS_ITEMS = 1000000;
+
+static item_t makeItem(uint32_t seq)
+{
+    item_t item;
+    item.seq = seq;
+    for (uint32_t& w : item.words)
+        w = seq * 2654435761u;
+    return item;
+}
+
+static bool intact(const item_t& item)
+{
+    for (uint32_t w : item.words)
+    {
+        if (w != item.seq * 2654435761u)
+            return false;
+    }
+    return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_spsc_fifo_order()
+{
+    OXRS_SPSC<uint32_t, 8> queue;
+    for (uint32_t i = 0; i < 5; i++)
+        TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_EQUAL_UINT32(5, queue.size());
+
+    uint32_t item = 0;
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+    TEST_ASSERT_FALSE(queue.pop(item));
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_spsc_full_counts_dropped()
+{
+    OXRS_SPSC<uint32_t, 4> queue;
+    for (uint32_t i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_FALSE(queue.push(4));
+    TEST_ASSERT_FALSE(queue.push(5));
+    TEST_ASSERT_EQUAL_UINT32(2, queue.dropped());
+
+    // the oldest items are kept
+    uint32_t item = 0;
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, item);
+    TEST_ASSERT_TRUE(queue.push(6));
+}
+
+void test_spsc_wraps()
+{
+    OXRS_SPSC<uint32_t, 4> queue;
+    uint32_t item = 0;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        TEST_ASSERT_TRUE(queue.push(i));
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, queue.dropped());
+}
+
+void test_ring_fifo_order()
+{
+    OXRS_RING<uint32_t, 8> ring;
+    for (uint32_t i = 0; i < 8; i++)
+        ring.push(i);
+    TEST_ASSERT_TRUE(ring.full());
+
+    uint32_t item = 0, lost = 0;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_TRUE(ring.pop(item, lost));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+    TEST_ASSERT_FALSE(ring.pop(item, lost));
+    TEST_ASSERT_EQUAL_UINT32(0, lost);
+}
+
+void test_ring_overwrites_oldest()
+{
+    OXRS_RING<uint32_t, 4> ring;
+    for (uint32_t i = 0; i < 10; i++)
+        ring.push(i);
+
+    // 0 to 5 were overwritten, the last 4 remain
+    uint32_t item = 0, lost = 0;
+    for (uint32_t i = 6; i < 10; i++)
+    {
+        TEST_ASSERT_TRUE(ring.pop(item, lost));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+    TEST_ASSERT_EQUAL_UINT32(6, lost);
+    TEST_ASSERT_FALSE(ring.pop(item, lost));
+}
+
+// Producer and consumer on their own threads, as on the two cores, nothing
+// may be lost, reordered or torn
+void test_spsc_two_threads()
+{
+    static OXRS_SPSC<item_t, 16> queue;
+    uint32_t full = 0;
+
+    std::thread producer([&full]() {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++)
+        {
+            item_t item = makeItem(i);
+            while (!queue.push(item))
+            {
+                full++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t received = 0, torn = 0, outOfOrder = 0;
+    item_t item;
+    while (received < STRESS_ITEMS)
+    {
+        if (!queue.pop(item))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!intact(item))
+            torn++;
+        if (item.seq != received)
+            outOfOrder++;
+        received++;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(full, queue.dropped());
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+// The producer never waits, so items may be overwritten before they are read,
+// but those read must be intact and in order, and all others counted as lost
+void test_ring_two_threads()
+{
+    static OXRS_RING<item_t, 16> ring;
+    std::atomic<bool> done(false);
+
+    std::thread producer([&done]() {
+        for (uint32_t i = 0; i < STRESS_ITEMS; i++)
+            ring.push(makeItem(i));
+        done.store(true, std::memory_order_release);
+    });
+
+    uint32_t received = 0, lost = 0, torn = 0, outOfOrder = 0;
+    int64_t previous = -1;
+    item_t item;
+    for (;;)
+    {
+        bool finished = done.load(std::memory_order_acquire);
+        while (ring.pop(item, lost))
+        {
+            if (!intact(item))
+                torn++;
+            if ((int64_t)item.seq <= previous)
+                outOfOrder++;
+            previous = item.seq;
+            received++;
+        }
+        if (finished)
+            break;
+        std::this_thread::yield();
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, received + lost);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS - 1, previous);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_spsc_fifo_order);
+    RUN_TEST(test_spsc_full_counts_dropped);
+    RUN_TEST(test_spsc_wraps);
+    RUN_TEST(test_ring_fifo_order);
+    RUN_TEST(test_ring_overwrites_oldest);
+    RUN_TEST(test_spsc_two_threads);
+    RUN_TEST(test_ring_two_threads);
+    return UNITY_END();
+}
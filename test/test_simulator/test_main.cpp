@@ -0,0 +1,239 @@
+#include <unity.h>
+#include <OXRS_NATIVE.h>
+#include <SensirionI2CSen5x.h>
+#include <SensirionCore.h>
+#include <SEN5xSimulator.h>
+
+/*
+ * SEN5xSimulator driven by the Sensirion library, as OXRS_SEN5x drives it,
+ * plus the raw command timing the non-blocking acquisition relies on.
+ */
+
+static const uint8_t  ADDRESS                  = 0x69;
+static const uint16_t CMD_READ_DATA_READY      = 0x0202;
+static const uint16_t CMD_READ_MEASURED_VALUES = 0x03C4;
+static const uint32_t STATUS_FAN_ERROR         = 1UL << 4;
+
+void setUp() {}
+void tearDown() {}
+
+static uint16_t sendCommand(SEN5xSimulator& sim, uint16_t command)
+{
+    uint8_t buffer[2];
+    SensirionI2CTxFrame txFrame = SensirionI2CTxFrame::createWithUInt16Command(command, buffer, 2);
+    return SensirionI2CCommunication::sendFrame(ADDRESS, txFrame, sim);
+}
+
+static uint16_t receiveWords(SEN5xSimulator& sim, uint16_t* words, uint8_t count)
+{
+    uint8_t buffer[48];
+    SensirionI2CRxFrame rxFrame(buffer, sizeof(buffer));
+    uint16_t error = SensirionI2CCommunication::receiveFrame(ADDRESS, count * 3, rxFrame, sim);
+    for (uint8_t i = 0; !error && i < count; i++)
+        error = rxFrame.getUInt16(words[i]);
+    return error;
+}
+
+void test_product_info()
+{
+    SEN5xSimulator sim(SEN54);
+    SensirionI2CSen5x sensor;
+    sensor.begin(sim);
+
+    unsigned char name[32];
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.getProductName(name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("SEN54", (const char*)name);
+
+    unsigned char serial[32];
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.getSerialNumber(serial, sizeof(serial)));
+    TEST_ASSERT_EQUAL_STRING("SIM0000000000001", (const char*)serial);
+}
+
+void test_measurement_cycle()
+{
+    SEN5xSimulator sim(SEN55);
+    SensirionI2CSen5x sensor;
+    sensor.begin(sim);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.deviceReset());
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.startMeasurement());
+
+    bool ready = true;
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readDataReady(ready));
+    TEST_ASSERT_FALSE(ready);
+
+    OXRSNative::advance(1000);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readDataReady(ready));
+    TEST_ASSERT_TRUE(ready);
+
+    uint16_t pm1p0, pm2p5, pm4p0, pm10p0;
+    int16_t hum, temp, voc, nox;
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readMeasuredValuesAsIntegers(pm1p0, pm2p5, pm4p0, pm10p0, hum, temp, voc, nox));
+    TEST_ASSERT_NOT_EQUAL(SEN5x_PM_UNKNOWN, pm2p5);
+    TEST_ASSERT_NOT_EQUAL(SEN5x_UNKNOWN, temp);
+
+    // gas indices are unknown for the first 10s, as on the sensor
+    TEST_ASSERT_EQUAL_INT16(SEN5x_UNKNOWN, voc);
+    TEST_ASSERT_EQUAL_INT16(SEN5x_UNKNOWN, nox);
+
+    // read clears data ready until the next measurement
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readDataReady(ready));
+    TEST_ASSERT_FALSE(ready);
+
+    OXRSNative::advance(10000);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readMeasuredValuesAsIntegers(pm1p0, pm2p5, pm4p0, pm10p0, hum, temp, voc, nox));
+    TEST_ASSERT_NOT_EQUAL(SEN5x_UNKNOWN, voc);
+    TEST_ASSERT_NOT_EQUAL(SEN5x_UNKNOWN, nox);
+}
+
+void test_model_fields()
+{
+    SEN5xSimulator sim(SEN50);
+    SensirionI2CSen5x sensor;
+    sensor.begin(sim);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.startMeasurement());
+    OXRSNative::advance(11000);
+
+    uint16_t pm1p0, pm2p5, pm4p0, pm10p0;
+    int16_t hum, temp, voc, nox;
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readMeasuredValuesAsIntegers(pm1p0, pm2p5, pm4p0, pm10p0, hum, temp, voc, nox));
+    TEST_ASSERT_NOT_EQUAL(SEN5x_PM_UNKNOWN, pm2p5);
+    TEST_ASSERT_EQUAL_INT16(SEN5x_UNKNOWN, hum);
+    TEST_ASSERT_EQUAL_INT16(SEN5x_UNKNOWN, voc);
+    TEST_ASSERT_EQUAL_INT16(SEN5x_UNKNOWN, nox);
+}
+
+void test_parameters()
+{
+    SEN5xSimulator sim(SEN55);
+    SensirionI2CSen5x sensor;
+    sensor.begin(sim);
+
+    // idle only parameters are accepted while idle and read back
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.setWarmStartParameter(1234));
+    uint16_t warmStart = 0;
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.getWarmStartParameter(warmStart));
+    TEST_ASSERT_EQUAL_UINT16(1234, warmStart);
+
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.setVocAlgorithmTuningParameters(150, 24, 24, 200, 60, 220));
+    int16_t t[6];
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.getVocAlgorithmTuningParameters(t[0], t[1], t[2], t[3], t[4], t[5]));
+    TEST_ASSERT_EQUAL_INT16(150, t[0]);
+    TEST_ASSERT_EQUAL_INT16(220, t[5]);
+
+    // and refused while measuring
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.startMeasurement());
+    TEST_ASSERT_NOT_EQUAL(0, sensor.setWarmStartParameter(1));
+    OXRSNative::advance(20);
+
+    // temperature offset is not idle only, and shifts temperature
+    uint16_t pm1p0, pm2p5, pm4p0, pm10p0;
+    int16_t hum, temp, voc, nox;
+    OXRSNative::advance(1000);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readMeasuredValuesAsIntegers(pm1p0, pm2p5, pm4p0, pm10p0, hum, temp, voc, nox));
+    int16_t before = temp;
+
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.setTemperatureOffsetParameters(400, 0, 0));     // +2°C
+    OXRSNative::advance(1000);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readMeasuredValuesAsIntegers(pm1p0, pm2p5, pm4p0, pm10p0, hum, temp, voc, nox));
+    TEST_ASSERT_INT_WITHIN(5, before + 400, temp);
+
+    // reset reverts to defaults
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.deviceReset());
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.getWarmStartParameter(warmStart));
+    TEST_ASSERT_EQUAL_UINT16(0, warmStart);
+}
+
+void test_execution_time()
+{
+    SEN5xSimulator sim(SEN55);
+    uint16_t ready;
+
+    // the response is refused until the command has executed
+    TEST_ASSERT_EQUAL_UINT16(0, sendCommand(sim, CMD_READ_DATA_READY));
+    OXRSNative::advance(19);
+    TEST_ASSERT_NOT_EQUAL(0, receiveWords(sim, &ready, 1));
+    OXRSNative::advance(1);
+    TEST_ASSERT_EQUAL_UINT16(0, receiveWords(sim, &ready, 1));
+
+    // nor is a new command accepted while one is executing
+    TEST_ASSERT_EQUAL_UINT16(0, sendCommand(sim, CMD_READ_DATA_READY));
+    TEST_ASSERT_NOT_EQUAL(0, sendCommand(sim, CMD_READ_DATA_READY));
+
+    // measured values are only readable while measuring
+    OXRSNative::advance(20);
+    TEST_ASSERT_NOT_EQUAL(0, sendCommand(sim, CMD_READ_MEASURED_VALUES));
+}
+
+void test_fault_injection()
+{
+    SEN5xSimulator sim(SEN55);
+    SensirionI2CSen5x sensor;
+    sensor.begin(sim);
+
+    uint32_t status = 0;
+    sim.failTransactions(1);
+    TEST_ASSERT_NOT_EQUAL(0, sensor.readDeviceStatus(status));
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readDeviceStatus(status));
+    TEST_ASSERT_EQUAL_UINT32(0, status);
+
+    sim.corruptReads(1);
+    TEST_ASSERT_NOT_EQUAL(0, sensor.readDeviceStatus(status));
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readDeviceStatus(status));
+
+    sim.setDeviceStatus(STATUS_FAN_ERROR);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readAndClearDeviceStatus(status));
+    TEST_ASSERT_EQUAL_UINT32(STATUS_FAN_ERROR, status);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.readDeviceStatus(status));
+    TEST_ASSERT_EQUAL_UINT32(0, status);
+}
+
+// Host time per i2c transaction, small enough next to the sensor's 20ms
+// execution times that the simulator does not distort loop() timing
+void test_transaction_latency()
+{
+    static const uint32_t ITERATIONS = 20000;
+    SEN5xSimulator sim(SEN55);
+    SensirionI2CSen5x sensor;
+    sensor.begin(sim);
+    TEST_ASSERT_EQUAL_UINT16(0, sensor.startMeasurement());
+    OXRSNative::advance(1000);
+
+    uint32_t transactions = sim.getTransactions();
+    uint64_t busy_us = 0;
+    uint16_t words[8];
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        OXRSNative::advance(20);
+        uint64_t start = time_us_64();
+        uint16_t error = sendCommand(sim, CMD_READ_MEASURED_VALUES);
+        busy_us += time_us_64() - start;
+        TEST_ASSERT_EQUAL_UINT16(0, error);
+
+        OXRSNative::advance(20);
+        start = time_us_64();
+        error = receiveWords(sim, words, 8);
+        busy_us += time_us_64() - start;
+        TEST_ASSERT_EQUAL_UINT16(0, error);
+    }
+    transactions = sim.getTransactions() - transactions;
+    TEST_ASSERT_EQUAL_UINT32(2 * ITERATIONS, transactions);
+
+    uint32_t ns = (uint32_t)(busy_us * 1000 / transactions);
+    char message[64];
+    snprintf(message, sizeof(message), "%" PRIu32 " ns/transaction", ns);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_UINT32(20000, ns);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_product_info);
+    RUN_TEST(test_measurement_cycle);
+    RUN_TEST(test_model_fields);
+    RUN_TEST(test_parameters);
+    RUN_TEST(test_execution_time);
+    RUN_TEST(test_fault_injection);
+    RUN_TEST(test_transaction_latency);
+    return UNITY_END();
+}
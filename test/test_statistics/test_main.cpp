@@ -0,0 +1,97 @@
+#include <unity.h>
+#include <math.h>
+#include <SEN5xStatistics.h>
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_window()
+{
+    SEN5xStatistics stats;
+    TEST_ASSERT_EQUAL_UINT32(0, stats.count());
+    TEST_ASSERT_EQUAL_FLOAT(0, stats.mean());
+    TEST_ASSERT_EQUAL_FLOAT(0, stats.stddev());
+}
+
+void test_min_max_last()
+{
+    SEN5xStatistics stats;
+    const int32_t samples[] = { 5, -3, 12, 7 };
+    for (int32_t s : samples)
+        stats.add(s);
+
+    TEST_ASSERT_EQUAL_UINT32(4, stats.count());
+    TEST_ASSERT_EQUAL_INT32(-3, stats.min());
+    TEST_ASSERT_EQUAL_INT32(12, stats.max());
+    TEST_ASSERT_EQUAL_INT32(7, stats.last());
+
+    stats.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, stats.count());
+    stats.add(9);
+    TEST_ASSERT_EQUAL_INT32(9, stats.min());
+    TEST_ASSERT_EQUAL_INT32(9, stats.max());
+    TEST_ASSERT_EQUAL_FLOAT(0, stats.stddev());
+}
+
+void test_mean_stddev()
+{
+    // mean 5, sample variance 32 / 7
+    SEN5xStatistics stats;
+    const int32_t samples[] = { 2, 4, 4, 4, 5, 5, 7, 9 };
+    for (int32_t s : samples)
+        stats.add(s);
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 5.0, stats.mean());
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, sqrt(32.0 / 7), stats.stddev());
+}
+
+// A day of 1Hz samples at the extremes of the sensor's range, small spread
+// around a large value and the full spread, against a double reference
+static void checkDay(int32_t base, int32_t spread)
+{
+    SEN5xStatistics stats;
+    const uint32_t n = 86400;
+    double sum = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        int32_t value = base + (int32_t)((i * 7919) % (spread + 1));
+        stats.add(value);
+        sum += value;
+    }
+    double mean = sum / n;
+
+    double m2 = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        double delta = base + (int32_t)((i * 7919) % (spread + 1)) - mean;
+        m2 += delta * delta;
+    }
+    double stddev = sqrt(m2 / (n - 1));
+
+    TEST_ASSERT_EQUAL_UINT32(n, stats.count());
+    TEST_ASSERT_FLOAT_WITHIN(fabs(mean) * 1e-6 + 1e-6, mean, stats.mean());
+    TEST_ASSERT_FLOAT_WITHIN(stddev * 1e-5 + 1e-6, stddev, stats.stddev());
+}
+
+void test_day_small_spread()
+{
+    checkDay(65000, 3);
+    checkDay(-32768, 3);
+}
+
+void test_day_full_range()
+{
+    checkDay(0, 65535);
+    checkDay(-32768, 65535);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_window);
+    RUN_TEST(test_min_max_last);
+    RUN_TEST(test_mean_stddev);
+    RUN_TEST(test_day_small_spread);
+    RUN_TEST(test_day_full_range);
+    return UNITY_END();
+}
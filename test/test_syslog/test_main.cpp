@@ -0,0 +1,199 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <OXRS_NATIVE.h>
+#include <OXRS_LOG.h>
+#include <WiFi.h>
+
+/*
+ * SysLogger sending to a UDP listener on the loopback interface: RFC 5424
+ * framing of each line, lines batched into newline separated datagrams, and
+ * the server resolved once rather than per line.
+ */
+
+static const char* PREFIX = "[SYSLOG_TEST] ";
+
+static WiFiUDP listener;
+static OXRS_LOG::SysLogger syslogger;
+
+void setUp() {}
+void tearDown() {}
+
+static void configure(uint16_t batch_ms)
+{
+    DynamicJsonDocument json(256);
+    json[OXRS_LOG::SysLogger::SYSLOG_ENABLE] = true;
+    json[OXRS_LOG::SysLogger::SERVER_CONFIG] = "localhost";
+    json[OXRS_LOG::SysLogger::PORT_CONFIG]   = listener.localPort();
+    json[OXRS_LOG::SysLogger::BATCH_CONFIG]  = batch_ms;
+    json[OXRS_LOG::SysLogger::LEVEL_CONFIG]  = "DEBUG";
+    syslogger.onConfig(json.as<JsonVariant>());
+}
+
+// Datagrams received since the last call
+static std::vector<std::string> receive()
+{
+    std::vector<std::string> datagrams;
+    while (int n = listener.parsePacket())
+    {
+        std::string datagram(n, '\0');
+        listener.read(&datagram[0], n);
+        datagrams.push_back(datagram);
+    }
+    return datagrams;
+}
+
+// Newline terminated lines of a batched datagram
+static std::vector<std::string> split(const std::string& datagram)
+{
+    std::vector<std::string> lines;
+    size_t start = 0, end;
+    while ((end = datagram.find('\n', start)) != std::string::npos)
+    {
+        lines.push_back(datagram.substr(start, end - start));
+        start = end + 1;
+    }
+    TEST_ASSERT_EQUAL_UINT32(datagram.size(), start);
+    return lines;
+}
+
+static void logLine(uint32_t i)
+{
+    oxrsLog.logf(OXRS_LOG::INFO, PREFIX, "line %" PRIu32, i);
+}
+
+void test_framing()
+{
+    configure(0);
+    receive();
+
+    oxrsLog.log(OXRS_LOG::WARN, PREFIX, "framing check");
+    std::vector<std::string> datagrams = receive();
+    TEST_ASSERT_EQUAL_UINT32(1, datagrams.size());
+
+    // <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD MSG, local0.warning
+    int year, month, day, hour, minute, second, n = 0;
+    TEST_ASSERT_EQUAL_INT(6, sscanf(datagrams[0].c_str(), "<132>1 %4d-%2d-%2dT%2d:%2d:%2dZ %n",
+        &year, &month, &day, &hour, &minute, &second, &n));
+    TEST_ASSERT_GREATER_THAN_UINT32(0, n);
+
+    std::string app(FW_SHORT_NAME);
+    for (char& c : app)
+        c = c == ' ' ? '_' : c;
+    std::string expected = "aqs-test " + app + " - - - [SYSLOG_TEST] [WARN] framing check";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), datagrams[0].c_str() + n);
+}
+
+void test_batched()
+{
+    configure(1000);
+    receive();
+    uint32_t lookups = WiFi.getHostByNameCount();
+
+    // 100 lines over 1s
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        logLine(i);
+        OXRSNative::advance(10);
+        oxrsLog.pump();
+    }
+
+    // the rest once the window has passed
+    OXRSNative::advance(1000);
+    oxrsLog.pump();
+
+    std::vector<std::string> datagrams = receive();
+    std::vector<std::string> lines;
+    for (const std::string& datagram : datagrams)
+    {
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(OXRS_LOG::SysLogger::MAX_DATAGRAM_SIZE, datagram.size());
+        for (const std::string& line : split(datagram))
+            lines.push_back(line);
+    }
+
+    // whole lines in order, in a datagram per 1KB rather than per line
+    TEST_ASSERT_EQUAL_UINT32(100, lines.size());
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        std::string suffix = "[INFO] line " + std::to_string(i);
+        TEST_ASSERT_TRUE(lines[i].size() > suffix.size());
+        TEST_ASSERT_EQUAL_STRING(suffix.c_str(), lines[i].c_str() + lines[i].size() - suffix.size());
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(10, datagrams.size());
+
+    // and the server resolved once
+    TEST_ASSERT_EQUAL_UINT32(1, WiFi.getHostByNameCount() - lookups);
+
+    char message[64];
+    snprintf(message, sizeof(message), "100 lines in %u datagrams", (unsigned)datagrams.size());
+    TEST_MESSAGE(message);
+}
+
+void test_batch_window()
+{
+    configure(500);
+    receive();
+
+    logLine(1000);
+    logLine(1001);
+    OXRSNative::advance(499);
+    oxrsLog.pump();
+    TEST_ASSERT_EQUAL_UINT32(0, receive().size());
+
+    OXRSNative::advance(1);
+    oxrsLog.pump();
+    std::vector<std::string> datagrams = receive();
+    TEST_ASSERT_EQUAL_UINT32(1, datagrams.size());
+    TEST_ASSERT_EQUAL_UINT32(2, split(datagrams[0]).size());
+}
+
+void test_unbatched_packet_rate()
+{
+    configure(0);
+    receive();
+    uint32_t lookups = WiFi.getHostByNameCount();
+
+    for (uint32_t i = 0; i < 100; i++)
+        logLine(2000 + i);
+
+    // a datagram per line, but still a single lookup
+    std::vector<std::string> datagrams = receive();
+    TEST_ASSERT_EQUAL_UINT32(100, datagrams.size());
+    TEST_ASSERT_EQUAL_UINT32(1, WiFi.getHostByNameCount() - lookups);
+}
+
+void test_resolved_on_config_change()
+{
+    configure(0);
+    receive();
+    uint32_t lookups = WiFi.getHostByNameCount();
+
+    logLine(3000);
+    logLine(3001);
+    TEST_ASSERT_EQUAL_UINT32(1, WiFi.getHostByNameCount() - lookups);
+
+    configure(0);
+    logLine(3002);
+    TEST_ASSERT_EQUAL_UINT32(2, WiFi.getHostByNameCount() - lookups);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3, receive().size());
+}
+
+int main()
+{
+    // the Serial logger only gets what the tests do not log
+    DynamicJsonDocument json(128);
+    json[OXRS_LOG::SerialLogger::LEVEL_CONFIG] = "FATAL";
+    oxrsLog.onConfig(json.as<JsonVariant>());
+
+    WiFi.setHostname("aqs test");
+    listener.begin(0);
+    oxrsLog.addLogger(&syslogger);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_framing);
+    RUN_TEST(test_batched);
+    RUN_TEST(test_batch_window);
+    RUN_TEST(test_unbatched_packet_rate);
+    RUN_TEST(test_resolved_on_config_change);
+    return UNITY_END();
+}
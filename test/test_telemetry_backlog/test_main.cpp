@@ -0,0 +1,106 @@
+#include <unity.h>
+#include <string>
+#include <OXRS_NATIVE.h>
+#include <LittleFS.h>
+#include <TelemetryBacklog.h>
+
+/*
+ * TelemetryBacklog filling the RAM ring, spilling to the segment file in
+ * order, and counting what it cannot keep or publish.
+ */
+
+static TelemetryBacklog backlog;
+static char buffer[TelemetryBacklog::MAX_PAYLOAD_LEN];
+
+void setUp() {}
+void tearDown() {}
+
+static bool pushSample(uint32_t i, size_t pad = 0)
+{
+    std::string payload = "{\"sample\":" + std::to_string(i) + ",\"pad\":\"" + std::string(pad, 'x') + "\"}";
+    return backlog.push(payload.c_str(), payload.size(), 0, i);
+}
+
+// Sample number of the oldest payload, -1 if none
+static int32_t peekSample()
+{
+    uint32_t time_s, time_ms;
+    size_t len = backlog.peek(buffer, sizeof(buffer), time_s, time_ms);
+    if (len == 0)
+        return -1;
+    TEST_ASSERT_EQUAL_UINT32(time_ms, strtoul(buffer + strlen("{\"sample\":"), nullptr, 10));
+    return time_ms;
+}
+
+static void drain()
+{
+    while (peekSample() >= 0)
+        backlog.pop();
+}
+
+void test_in_order_through_spill()
+{
+    backlog.begin();
+
+    // past the RAM ring and into the segment file
+    uint32_t count = 0;
+    while (backlog.getSpilledCount() < 10)
+        TEST_ASSERT_TRUE(pushSample(count++, 200));
+    TEST_ASSERT_EQUAL_UINT32(count, backlog.getCount());
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(i, peekSample());
+        backlog.pop();
+    }
+    TEST_ASSERT_TRUE(backlog.isEmpty());
+    TEST_ASSERT_FALSE(LittleFS.exists("/telemetry.seg"));
+    TEST_ASSERT_EQUAL_UINT32(0, backlog.getDroppedCount());
+}
+
+void test_rejected_dropped()
+{
+    uint32_t dropped = backlog.getDroppedCount();
+    pushSample(1);
+    pushSample(2);
+
+    // the head the broker will not take is dropped, and the next is up
+    TEST_ASSERT_EQUAL_INT32(1, peekSample());
+    backlog.drop();
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, backlog.getDroppedCount());
+    TEST_ASSERT_EQUAL_INT32(2, peekSample());
+
+    // only once for each peek
+    backlog.drop();
+    backlog.drop();
+    TEST_ASSERT_EQUAL_UINT32(dropped + 2, backlog.getDroppedCount());
+    TEST_ASSERT_TRUE(backlog.isEmpty());
+}
+
+void test_full_dropped()
+{
+    uint32_t dropped = backlog.getDroppedCount();
+
+    uint32_t count = 0;
+    while (pushSample(count, 500))
+        count++;
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, backlog.getDroppedCount());
+    TEST_ASSERT_FALSE(pushSample(count, 500));
+    TEST_ASSERT_EQUAL_UINT32(dropped + 2, backlog.getDroppedCount());
+
+    // too large to ever publish
+    TEST_ASSERT_FALSE(backlog.push(buffer, TelemetryBacklog::MAX_PAYLOAD_LEN + 1, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(dropped + 3, backlog.getDroppedCount());
+
+    drain();
+    TEST_ASSERT_TRUE(backlog.isEmpty());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_in_order_through_spill);
+    RUN_TEST(test_rejected_dropped);
+    RUN_TEST(test_full_dropped);
+    return UNITY_END();
+}
@@ -0,0 +1,134 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <OXRS_NATIVE.h>
+#include <OXRS_SEN5x.h>
+#include <SEN5xTelemetryEncoder.h>
+
+/*
+ * Publishing a SEN55 sample through SEN5xTelemetryEncoder, against the json
+ * path it replaced: float values rounded by round2dp() into a 4KB
+ * DynamicJsonDocument, then measured and serialised as OXRS_MQTT does.
+ */
+
+static const uint32_t ITERATIONS = 20000;
+
+static const SEN5x_telemetry_t SAMPLE = { 123, 245, 310, 402, 4512, 4701, 1005, 12 };
+
+void setUp() {}
+void tearDown() {}
+
+// Replaced json path, refer OXRS_SEN5x::telemetryAsJson before fixed point
+static double round2dp(float value)
+{
+    return (std::isnan(value)) ? 0 : (int)(value * 100 + 0.5) / 100.0;
+}
+
+static size_t publishJson(const SEN5x_telemetry_t& t, char* payload, size_t size)
+{
+    DynamicJsonDocument json(4096);
+    json["pm1p0"]  = round2dp(t.pm1p0 / 10.0f);
+    json["pm2p5"]  = round2dp(t.pm2p5 / 10.0f);
+    json["pm4p0"]  = round2dp(t.pm4p0 / 10.0f);
+    json["pm10p0"] = round2dp(t.pm10p0 / 10.0f);
+    json["hum"]    = round2dp(t.humidityPercent / 100.0f);
+    json["temp"]   = round2dp(t.tempCelsuis / 200.0f);
+    json["vox"]    = round2dp(t.vocIndex / 10.0f);
+    json["nox"]    = round2dp(t.noxIndex / 10.0f);
+
+    size_t len = measureJson(json);
+    if (len >= size)
+        return 0;
+    return serializeJson(json, payload, size);
+}
+
+static size_t publishEncoder(const SEN5x_telemetry_t& t, char* payload, size_t size)
+{
+    SEN5xTelemetryEncoder encoder(payload, size);
+    encoder.begin();
+    encoder.add("pm1p0",  t.pm1p0,  SEN5x_PM_SCALE);
+    encoder.add("pm2p5",  t.pm2p5,  SEN5x_PM_SCALE);
+    encoder.add("pm4p0",  t.pm4p0,  SEN5x_PM_SCALE);
+    encoder.add("pm10p0", t.pm10p0, SEN5x_PM_SCALE);
+    encoder.add("hum",    t.humidityPercent, SEN5x_HUMIDITY_SCALE);
+    encoder.add("temp",   t.tempCelsuis,     SEN5x_TEMPERATURE_SCALE);
+    encoder.add("vox",    t.vocIndex,        SEN5x_INDEX_SCALE);
+    encoder.add("nox",    t.noxIndex,        SEN5x_INDEX_SCALE);
+    return encoder.end();
+}
+
+typedef size_t (*publish_t)(const SEN5x_telemetry_t& t, char* payload, size_t size);
+
+typedef struct {
+    uint32_t ns;            // per publish
+    uint32_t allocations;   // per publish
+    size_t   heapPeak;      // bytes above the heap in use beforehand
+} result_t;
+
+static result_t run(publish_t publish, const char* name)
+{
+    char payload[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    SEN5x_telemetry_t t = SAMPLE;
+    size_t total = 0;
+
+    size_t heapBefore = OXRSNative::heapUsed();
+    OXRSNative::resetHeapPeak();
+    uint32_t allocationsBefore = OXRSNative::allocations();
+    uint64_t start = time_us_64();
+
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        // vary the sample so nothing is hoisted out of the loop
+        t.pm2p5 = SAMPLE.pm2p5 + (i & 0xFF);
+        total += publish(t, payload, sizeof(payload));
+    }
+
+    result_t result;
+    result.ns = (uint32_t)((time_us_64() - start) * 1000 / ITERATIONS);
+    result.allocations = (OXRSNative::allocations() - allocationsBefore) / ITERATIONS;
+    result.heapPeak = OXRSNative::heapPeak() - heapBefore;
+    TEST_ASSERT_GREATER_THAN_UINT32(0, total);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%-8s %6" PRIu32 " ns/publish %3" PRIu32 " allocations/publish %6u bytes peak heap",
+        name, result.ns, result.allocations, (unsigned)result.heapPeak);
+    TEST_MESSAGE(message);
+    return result;
+}
+
+void test_encoder_matches_json_path()
+{
+    char json[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+    char encoded[OXRS_SEN5x::TELEMETRY_MAX_SIZE];
+
+    SEN5x_telemetry_t t = SAMPLE;
+    for (int32_t i = 0; i < 2000; i++)
+    {
+        t.pm2p5           = (uint16_t)(i * 7);
+        t.humidityPercent = (int16_t)(i * 5 - 1000);
+        t.tempCelsuis     = (int16_t)(i * 3 - 2000);
+        t.vocIndex        = (int16_t)(i % 5000);
+
+        size_t len = publishJson(t, json, sizeof(json));
+        TEST_ASSERT_EQUAL_UINT32(len, publishEncoder(t, encoded, sizeof(encoded)));
+        TEST_ASSERT_EQUAL_STRING(json, encoded);
+    }
+}
+
+void test_encoder_benchmark()
+{
+    result_t json = run(publishJson, "json");
+    result_t encoder = run(publishEncoder, "encoder");
+
+    TEST_ASSERT_EQUAL_UINT32(0, encoder.allocations);
+    TEST_ASSERT_EQUAL_UINT32(0, encoder.heapPeak);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, json.allocations);
+    TEST_ASSERT_LESS_THAN_UINT32(json.ns, encoder.ns);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_encoder_matches_json_path);
+    RUN_TEST(test_encoder_benchmark);
+    return UNITY_END();
+}
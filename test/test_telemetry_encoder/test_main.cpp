@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <SEN5xTelemetryEncoder.h>
+
+void setUp() {}
+void tearDown() {}
+
+void test_encodes_flat_object()
+{
+    char buffer[128];
+    SEN5xTelemetryEncoder encoder(buffer, sizeof(buffer));
+
+    encoder.begin();
+    encoder.add("pm2p5", 123, 10);              // 12.3
+    encoder.add("temperature", 4701, 200);      // 23.505 -> 23.51
+    encoder.add("humidity", 5000, 100, "_max");
+    encoder.add("vocIndex", -5, 10);            // -0.5, truncated as the float path does
+    size_t len = encoder.end();
+
+    TEST_ASSERT_EQUAL_STRING("{\"pm2p5\":12.3,\"temperature\":23.51,\"humidity_max\":50,\"vocIndex\":-0.49}", buffer);
+    TEST_ASSERT_EQUAL_UINT32(strlen(buffer), len);
+}
+
+void test_empty_object()
+{
+    char buffer[8];
+    SEN5xTelemetryEncoder encoder(buffer, sizeof(buffer));
+
+    encoder.begin();
+    TEST_ASSERT_EQUAL_UINT32(2, encoder.end());
+    TEST_ASSERT_EQUAL_STRING("{}", buffer);
+}
+
+void test_overflow_returns_zero()
+{
+    char buffer[16];
+    SEN5xTelemetryEncoder encoder(buffer, sizeof(buffer));
+
+    encoder.begin();
+    encoder.add("temperature", 4700, 200);
+    TEST_ASSERT_EQUAL_UINT32(0, encoder.end());
+    TEST_ASSERT_EQUAL_STRING("", buffer);
+
+    // reusable after an overflow
+    encoder.begin();
+    encoder.add("t", 1, 1);
+    TEST_ASSERT_EQUAL_UINT32(7, encoder.end());
+    TEST_ASSERT_EQUAL_STRING("{\"t\":1}", buffer);
+}
+
+void test_derived_values()
+{
+    char buffer[64];
+    SEN5xTelemetryEncoder encoder(buffer, sizeof(buffer));
+
+    encoder.begin();
+    encoder.addDerived("pm1p0", 12.345f, 1, "_mean");
+    encoder.addDerived("humidity", 4567.0f, 100, "_stddev");
+    encoder.end();
+
+    TEST_ASSERT_EQUAL_STRING("{\"pm1p0_mean\":12.35,\"humidity_stddev\":45.67}", buffer);
+}
+
+void test_round2dp()
+{
+    TEST_ASSERT_EQUAL_INT32(0, SEN5xTelemetryEncoder::round2dp(0, 10));
+    TEST_ASSERT_EQUAL_INT32(1230, SEN5xTelemetryEncoder::round2dp(123, 10));
+    TEST_ASSERT_EQUAL_INT32(2351, SEN5xTelemetryEncoder::round2dp(4701, 200));
+    TEST_ASSERT_EQUAL_INT32(-49, SEN5xTelemetryEncoder::round2dp(-5, 10));     // (int)(-50 + 0.5)
+    TEST_ASSERT_EQUAL_INT32(655350, SEN5xTelemetryEncoder::round2dp(65535, 10));
+}
+
+// Float path the encoder replaced: the sensor library's float value rounded to
+// 2dp as a double, refer OXRS_SEN5x::round2dp before fixed point
+static double floatRound2dp(int32_t raw, uint16_t scale)
+{
+    float value = raw / (float)scale;
+    return (int)(value * 100 + 0.5) / 100.0;
+}
+
+// Every value the sensor can report, at each scale it reports them in
+static void checkFullRange(int32_t from, int32_t to, uint16_t scale)
+{
+    char encoded[32];
+    char json[32];
+    StaticJsonDocument<64> doc;
+    SEN5xTelemetryEncoder encoder(encoded, sizeof(encoded));
+
+    for (int32_t raw = from; raw <= to; raw++)
+    {
+        double value = floatRound2dp(raw, scale);
+
+        int32_t hundredths = SEN5xTelemetryEncoder::round2dp(raw, scale);
+        if (hundredths != (int32_t)lround(value * 100))
+        {
+            char message[64];
+            snprintf(message, sizeof(message), "round2dp(%" PRId32 ", %u)", raw, scale);
+            TEST_ASSERT_EQUAL_INT32_MESSAGE((int32_t)lround(value * 100), hundredths, message);
+        }
+
+        encoder.begin();
+        encoder.add("v", raw, scale);
+        encoder.end();
+
+        doc.clear();
+        doc["v"] = value;
+        serializeJson(doc, json, sizeof(json));
+
+        if (strcmp(json, encoded) != 0)
+            TEST_ASSERT_EQUAL_STRING(json, encoded);
+    }
+}
+
+void test_pm_full_range()
+{
+    checkFullRange(0, 65535, 10);
+}
+
+void test_humidity_full_range()
+{
+    checkFullRange(-32768, 32767, 100);
+}
+
+void test_temperature_full_range()
+{
+    checkFullRange(-32768, 32767, 200);
+}
+
+void test_index_full_range()
+{
+    checkFullRange(-32768, 32767, 10);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_encodes_flat_object);
+    RUN_TEST(test_empty_object);
+    RUN_TEST(test_overflow_returns_zero);
+    RUN_TEST(test_derived_values);
+    RUN_TEST(test_round2dp);
+    RUN_TEST(test_pm_full_range);
+    RUN_TEST(test_humidity_full_range);
+    RUN_TEST(test_temperature_full_range);
+    RUN_TEST(test_index_full_range);
+    return UNITY_END();
+}